@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/// Prevent the compiler from optimizing away a value
+template <typename T>
+inline void do_not_optimize(T const& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile char const* sink;
+    sink = reinterpret_cast<char const volatile*>(&value);
+#endif
+}
+
+/// Timings of one benchmark
+struct BenchmarkResult
+{
+    std::string name;
+    std::size_t repetitions;
+    std::size_t items;      ///< Number of items (cells, intervals, ...) processed by one repetition
+    double min_ns;
+    double median_ns;
+    double mean_ns;
+};
+
+/**
+ * Minimal benchmark suite
+ *
+ * Each benchmark is a function that is timed over several repetitions (after one warm-up run).
+ * Results are printed as a table and written as JSON to the file given by `--json <file>` (`-` for stdout).
+ * `--repetitions <n>` sets the number of repetitions.
+ */
+class BenchmarkSuite
+{
+public:
+    BenchmarkSuite(std::string name, int argc, char** argv)
+        : m_name(std::move(name))
+    {
+        for (int a = 1; a + 1 < argc; a += 2)
+        {
+            std::string const option = argv[a];
+            if (option == "--json")
+                m_json = argv[a + 1];
+            else if (option == "--repetitions")
+                m_repetitions = std::max<std::size_t>(1, std::strtoul(argv[a + 1], nullptr, 10));
+        }
+    }
+
+    /// Time fn(), processing items items per call
+    template <typename Function>
+    void run(std::string const& name, std::size_t items, Function && fn)
+    {
+        fn();
+
+        std::vector<double> times;
+        for (std::size_t r = 0; r < m_repetitions; ++r)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            fn();
+            auto const stop = std::chrono::steady_clock::now();
+            times.push_back(std::chrono::duration<double, std::nano>(stop - start).count());
+        }
+
+        std::sort(times.begin(), times.end());
+        double mean = 0.;
+        for (double t : times)
+            mean += t / static_cast<double>(times.size());
+
+        m_results.push_back({name, m_repetitions, items, times.front(), times[times.size() / 2], mean});
+        auto const& result = m_results.back();
+        std::cout << std::left << std::setw(48) << result.name << std::right
+                  << std::setw(14) << std::fixed << std::setprecision(0) << result.median_ns << " ns"
+                  << std::setw(12) << std::setprecision(3) << result.median_ns / static_cast<double>(std::max<std::size_t>(1, result.items)) << " ns/item"
+                  << std::endl;
+    }
+
+    /// Write the JSON report and return the exit code
+    int finish() const
+    {
+        if (m_json.empty())
+            return EXIT_SUCCESS;
+
+        if (m_json == "-")
+            write_json(std::cout);
+        else
+        {
+            std::ofstream file(m_json);
+            write_json(file);
+            if (!file)
+                return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+private:
+    void write_json(std::ostream & out) const
+    {
+        out << "{\n  \"suite\": \"" << m_name << "\",\n  \"benchmarks\": [";
+        for (std::size_t b = 0; b < m_results.size(); ++b)
+        {
+            auto const& r = m_results[b];
+            out << (b > 0 ? "," : "") << "\n    {"
+                << "\"name\": \"" << r.name << "\", "
+                << "\"repetitions\": " << r.repetitions << ", "
+                << "\"items\": " << r.items << ", "
+                << std::setprecision(1) << std::fixed
+                << "\"min_ns\": " << r.min_ns << ", "
+                << "\"median_ns\": " << r.median_ns << ", "
+                << "\"mean_ns\": " << r.mean_ns << ", "
+                << std::setprecision(4)
+                << "\"ns_per_item\": " << r.median_ns / static_cast<double>(std::max<std::size_t>(1, r.items))
+                << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    std::string m_name;
+    std::string m_json;
+    std::size_t m_repetitions = 10;
+    std::vector<BenchmarkResult> m_results;
+};
@@ -0,0 +1,184 @@
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "interval.hpp"
+#include "cell_set.hpp"
+#include "compressed_cell_set.hpp"
+#include "bench.hpp"
+
+/// Disk of given radius (in cells): one interval per row, slowly varying bounds
+CellSet<2> make_disk(std::size_t level, std::ptrdiff_t radius)
+{
+    CellSet<2> set(level);
+    for (std::ptrdiff_t j = -radius, w = 0; j <= radius; ++j)
+    {
+        while ((w + 1) * (w + 1) + j * j <= radius * radius)
+            ++w;
+        while (w > 0 && w * w + j * j > radius * radius)
+            --w;
+        set.push_back({j}, {-w, w + 1});
+    }
+    return set;
+}
+
+/// Rows of short intervals and gaps, with a few large gaps (eg refined spots of an adapted mesh)
+CellSet<2> make_fragmented(std::size_t level, std::ptrdiff_t rows)
+{
+    std::mt19937_64 random(42);
+    CellSet<2> set(level);
+    for (std::ptrdiff_t j = 0; j < rows; ++j)
+        for (std::ptrdiff_t i = 0, k = 0; k < 64; ++k)
+        {
+            std::ptrdiff_t const length = 1 + static_cast<std::ptrdiff_t>(random() % 8);
+            set.push_back({j}, {i, i + length});
+            i += length + 1 + static_cast<std::ptrdiff_t>(random() % 100 == 0 ? 100000 : random() % 16);
+        }
+    return set;
+}
+
+/// Unsigned values encoded by CompressedCellSet for a set (same order and transforms)
+std::vector<std::uint64_t> encoded_values(CellSet<2> const& set)
+{
+    std::vector<std::uint64_t> values;
+    std::ptrdiff_t previous_row = 0, previous_first = 0;
+    for (std::size_t r = 0; r < set.row_count(); ++r)
+    {
+        auto const [begin, end] = set.row_intervals(r);
+        values.push_back(details::zigzag_encode(set.rows[r][0] - previous_row));
+        values.push_back(static_cast<std::uint64_t>(end - begin));
+        values.push_back(details::zigzag_encode(begin->a - previous_first));
+        for (auto it = begin; it != end; ++it)
+        {
+            values.push_back(static_cast<std::uint64_t>(it->b - it->a - 1));
+            if (it + 1 != end)
+                values.push_back(static_cast<std::uint64_t>((it + 1)->a - it->b - 1));
+        }
+        previous_row = set.rows[r][0];
+        previous_first = begin->a;
+    }
+    return values;
+}
+
+/// Frame of reference bit-packing: blocks of for_block values packed with the bit width of their largest value
+constexpr std::size_t for_block = 128;
+
+struct BitPacked
+{
+    std::size_t count = 0;
+    std::vector<std::uint8_t> widths;
+    std::vector<std::uint64_t> words;
+
+    std::size_t byte_size() const noexcept { return widths.size() + words.size() * sizeof(std::uint64_t); }
+};
+
+BitPacked bit_pack(std::vector<std::uint64_t> const& values)
+{
+    BitPacked packed;
+    packed.count = values.size();
+    for (std::size_t first = 0; first < values.size(); first += for_block)
+    {
+        std::size_t const last = std::min(values.size(), first + for_block);
+        std::uint64_t max = 0;
+        for (std::size_t k = first; k < last; ++k)
+            max |= values[k];
+        unsigned width = 0;
+        while (width < 64 && (max >> width) != 0)
+            ++width;
+        packed.widths.push_back(static_cast<std::uint8_t>(width));
+
+        std::size_t const origin = packed.words.size();
+        packed.words.resize(origin + (for_block * width + 63) / 64);
+        for (std::size_t k = first, bit = 0; k < last; ++k, bit += width)
+        {
+            packed.words[origin + bit / 64] |= values[k] << (bit % 64);
+            if (bit % 64 + width > 64)
+                packed.words[origin + bit / 64 + 1] |= values[k] >> (64 - bit % 64);
+        }
+    }
+    return packed;
+}
+
+/// Sum of the bit-packed values (decoding each block as the cursor would)
+std::uint64_t bit_unpack_sum(BitPacked const& packed)
+{
+    std::uint64_t sum = 0;
+    std::uint64_t const* words = packed.words.data();
+    for (std::size_t b = 0; b < packed.widths.size(); ++b)
+    {
+        unsigned const width = packed.widths[b];
+        std::uint64_t const mask = width == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << width) - 1;
+        std::size_t const n = std::min(for_block, packed.count - b * for_block);
+        for (std::size_t k = 0, bit = 0; k < n; ++k, bit += width)
+        {
+            std::uint64_t v = words[bit / 64] >> (bit % 64);
+            if (bit % 64 + width > 64)
+                v |= words[bit / 64 + 1] << (64 - bit % 64);
+            sum += v & mask;
+        }
+        words += (for_block * width + 63) / 64;
+    }
+    return sum;
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkSuite suite("compressed", argc, argv);
+
+    std::vector<std::pair<std::string, CellSet<2>>> const sets{
+        {"disk", make_disk(14, 6000)},
+        {"fragmented", make_fragmented(20, 4096)},
+    };
+
+    for (auto const& [name, set] : sets)
+    {
+        auto const compressed = compress(set);
+        auto const values = encoded_values(set);
+        std::vector<std::uint8_t> varints;
+        for (auto v : values)
+            details::put_varint(varints, v);
+        auto const packed = bit_pack(values);
+
+        std::cout << name << ": " << set.interval_count() << " intervals, "
+                  << set.rows.size() * sizeof(set.rows[0]) + set.row_offsets.size() * sizeof(std::size_t) + set.intervals.size() * sizeof(Interval) << " bytes uncompressed, "
+                  << varints.size() << " bytes as varints, "
+                  << packed.byte_size() << " bytes bit-packed" << std::endl;
+
+        // Traversal of the intervals, uncompressed and decoded on the fly
+        suite.run("compressed/cell_set_" + name, set.interval_count(),
+            [&] {
+                std::size_t cells = 0;
+                for (std::size_t r = 0; r < set.row_count(); ++r)
+                    for (auto [it, end] = set.row_intervals(r); it != end; ++it)
+                        cells += cell_count(*it) + static_cast<std::size_t>(set.rows[r][0]);
+                do_not_optimize(cells);
+            }
+        );
+        suite.run("compressed/cursor_" + name, set.interval_count(),
+            [&] {
+                std::size_t cells = 0;
+                compressed.for_each_interval([&] (std::size_t, Interval const& interval, std::ptrdiff_t j) { cells += cell_count(interval) + static_cast<std::size_t>(j); });
+                do_not_optimize(cells);
+            }
+        );
+
+        // Decoding of the same values, as varints and bit-packed
+        suite.run("compressed/varint_decode_" + name, values.size(),
+            [&] {
+                std::uint64_t sum = 0;
+                std::uint8_t const* p = varints.data();
+                for (std::size_t k = 0; k < values.size(); ++k)
+                    sum += details::get_varint(p);
+                do_not_optimize(sum);
+            }
+        );
+        suite.run("compressed/bit_unpack_" + name, values.size(),
+            [&] { do_not_optimize(bit_unpack_sum(packed)); }
+        );
+    }
+
+    return suite.finish();
+}
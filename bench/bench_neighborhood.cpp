@@ -0,0 +1,75 @@
+#include <cstddef>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "cell_set.hpp"
+#include "balance.hpp"
+#include "packed_key.hpp"
+#include "hash_cell_set.hpp"
+#include "morton.hpp"
+#include "bench.hpp"
+
+int main(int argc, char** argv)
+{
+    BenchmarkSuite suite("neighborhood", argc, argv);
+
+    // Neighbourhood of a set of cells
+    {
+        CellSet<2> set(8);
+        for (std::ptrdiff_t j = 0; j < 256; ++j)
+            set.push_back({j}, {128 - j / 2, 128 + j / 2 + 1});
+        suite.run("neighborhood/dilate_2d_distance2", set.size(),
+            [&] { do_not_optimize(dilate(set, make_KCellND<2>().neighborhood<2>())); }
+        );
+    }
+
+    // Neighbour lookup in sparse sets
+    {
+        using Key = PackedKCellKey<3>;
+        std::vector<Key> keys;
+        for (std::ptrdiff_t k = 0; k < 64; ++k)
+            for (std::ptrdiff_t j = 0; j < 64; ++j)
+                for (std::ptrdiff_t i = 0; i < 64; i += 4)
+                    keys.push_back(Key::from_indices(6, 0b111, {i + (j + k) % 4, j, k}));
+        KCellHashSet<Key> set;
+        set.insert(keys.begin(), keys.end());
+
+        constexpr auto center = make_KCellND<3>();
+        constexpr auto stencil = center.neighborhood();
+        suite.run("neighborhood/hash_lookup_3d", keys.size(),
+            [&] {
+                std::size_t found = 0;
+                for (auto const& key : keys)
+                    for (auto const* v : set.neighbours(key, center, stencil))
+                        found += (v != nullptr);
+                do_not_optimize(found);
+            }
+        );
+
+        suite.run("neighborhood/packed_key_shift_3d", keys.size(),
+            [&] {
+                std::size_t sum = 0;
+                for (auto const& key : keys)
+                    stencil.foreach([&] (auto cell) { sum += static_cast<std::size_t>(key.shift(center, cell).value); });
+                do_not_optimize(sum);
+            }
+        );
+
+        std::vector<MortonKCellKey<3>> morton;
+        for (auto const& key : keys)
+            morton.push_back(MortonKCellKey<3>::from_khalimsky(key.level(), key.khalimsky()));
+        suite.run("neighborhood/morton_key_shift_3d", morton.size(),
+            [&] {
+                std::size_t sum = 0;
+                for (auto const& key : morton)
+                    stencil.foreach([&] (auto cell) { sum += static_cast<std::size_t>(key.shift(center, cell).value); });
+                do_not_optimize(sum);
+            }
+        );
+    }
+
+    return suite.finish();
+}
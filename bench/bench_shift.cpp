@@ -0,0 +1,117 @@
+#include <cstddef>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "interval.hpp"
+#include "khalimsky.hpp"
+#include "bench.hpp"
+
+int main(int argc, char** argv)
+{
+    BenchmarkSuite suite("shift", argc, argv);
+
+    // Scalar versus bulk Interval shifts
+    {
+        constexpr std::ptrdiff_t n = 1 << 20;
+        using Cell = KCell<true, 3, 1>;
+
+        std::vector<std::ptrdiff_t> indices(n), shifted_indices(n);
+        for (std::ptrdiff_t i = 0; i < n; ++i)
+            indices[static_cast<std::size_t>(i)] = i;
+        suite.run("interval/scalar_shift", n,
+            [&] {
+                for (std::size_t i = 0; i < indices.size(); ++i)
+                    shifted_indices[i] = Cell::shift(indices[i]);
+                do_not_optimize(shifted_indices.back());
+            }
+        );
+
+        std::vector<Interval> intervals;
+        for (std::ptrdiff_t i = 0; i < n; i += 16)
+            intervals.push_back({i, i + 8});
+        std::vector<Interval> shifted(intervals.size(), Interval{0, 0});
+        suite.run("interval/bulk_shift", n / 2,
+            [&] {
+                for (std::size_t k = 0; k < intervals.size(); ++k)
+                    shifted[k] = Cell::shift(intervals[k]);
+                do_not_optimize(shifted.back());
+            }
+        );
+    }
+
+    // Khalimsky coordinates to a coarser level, with a runtime versus a compile-time level shift
+    {
+        constexpr std::ptrdiff_t n = 1 << 20;
+        std::vector<std::ptrdiff_t> khalimsky(n), shifted(n);
+        for (std::ptrdiff_t i = 0; i < n; ++i)
+            khalimsky[static_cast<std::size_t>(i)] = i;
+        std::ptrdiff_t level_shift = -2;
+        do_not_optimize(level_shift);
+        suite.run("khalimsky/scalar_shift", n,
+            [&] {
+                for (std::size_t i = 0; i < khalimsky.size(); ++i)
+                    shifted[i] = 2 * details::shift(khalimsky[i] >> 1, 0, level_shift) + (khalimsky[i] & 1);
+                do_not_optimize(shifted.back());
+            }
+        );
+        suite.run("khalimsky/batch_shift", n,
+            [&] {
+                batch_khalimsky_shift(level_shift, khalimsky.data(), shifted.data(), khalimsky.size());
+                do_not_optimize(shifted.back());
+            }
+        );
+    }
+
+    // KCellND::shift with a lambda accessing a field
+    {
+        constexpr std::ptrdiff_t n = 1 << 20;
+        std::vector<double> u(n + 2, 1.);
+        auto field = [&u] (std::size_t, std::ptrdiff_t i) -> double& { return u[static_cast<std::size_t>(i + 1)]; };
+        using Cell = decltype(make_KCellND<1>().next<0>().get<0>());
+        suite.run("kcellnd_shift/1d", n,
+            [&] {
+                double sum = 0.;
+                for (std::ptrdiff_t i = 0; i < n; ++i)
+                    sum += Cell::shift(field, 0, i);
+                do_not_optimize(sum);
+            }
+        );
+    }
+    {
+        constexpr std::ptrdiff_t n = 1024;
+        constexpr std::ptrdiff_t stride = n + 2;
+        std::vector<double> u(stride * stride, 1.);
+        auto field = [&u] (std::size_t, std::ptrdiff_t i, std::ptrdiff_t j) -> double& { return u[static_cast<std::size_t>((i + 1) + (j + 1) * stride)]; };
+        using Cell = decltype(make_KCellND<2>().next<1>().get<0>());
+        suite.run("kcellnd_shift/2d", n * n,
+            [&] {
+                double sum = 0.;
+                for (std::ptrdiff_t j = 0; j < n; ++j)
+                    for (std::ptrdiff_t i = 0; i < n; ++i)
+                        sum += Cell::shift(field, 0, i, j);
+                do_not_optimize(sum);
+            }
+        );
+    }
+    {
+        constexpr std::ptrdiff_t n = 96;
+        constexpr std::ptrdiff_t stride = n + 2;
+        std::vector<double> u(stride * stride * stride, 1.);
+        auto field = [&u] (std::size_t, std::ptrdiff_t i, std::ptrdiff_t j, std::ptrdiff_t k) -> double& { return u[static_cast<std::size_t>((i + 1) + stride * ((j + 1) + stride * (k + 1)))]; };
+        using Cell = decltype(make_KCellND<3>().next<2>().get<0>());
+        suite.run("kcellnd_shift/3d", n * n * n,
+            [&] {
+                double sum = 0.;
+                for (std::ptrdiff_t k = 0; k < n; ++k)
+                    for (std::ptrdiff_t j = 0; j < n; ++j)
+                        for (std::ptrdiff_t i = 0; i < n; ++i)
+                            sum += Cell::shift(field, 0, i, j, k);
+                do_not_optimize(sum);
+            }
+        );
+    }
+
+    return suite.finish();
+}
@@ -0,0 +1,244 @@
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "interval.hpp"
+#include "interval_blocks.hpp"
+#include "box.hpp"
+#include "cell_set.hpp"
+#include "boundary_split.hpp"
+#include "mixed_level.hpp"
+#include "runtime_stencil.hpp"
+#include "temporal_blocking.hpp"
+#include "adaptation.hpp"
+#include "bench.hpp"
+
+int main(int argc, char** argv)
+{
+    BenchmarkSuite suite("stencil", argc, argv);
+
+    // Stencil application over large boxes
+    {
+        constexpr std::ptrdiff_t n = 1024;
+        constexpr std::ptrdiff_t stride = n + 2;
+        std::vector<double> u(stride * stride, 1.), v(stride * stride, 0.);
+        auto index = [] (std::ptrdiff_t i, std::ptrdiff_t j) { return static_cast<std::size_t>((i + 1) + (j + 1) * stride); };
+        auto field = [&] (std::size_t, std::ptrdiff_t i, std::ptrdiff_t j) -> double& { return u[index(i, j)]; };
+        constexpr auto stencil = make_KCellND<2>().neighborhood();
+
+        suite.run("stencil/neighborhood_2d_box", n * n,
+            [&] {
+                for (std::ptrdiff_t j = 0; j < n; ++j)
+                    for (std::ptrdiff_t i = 0; i < n; ++i)
+                        v[index(i, j)] = stencil.apply([&] (auto... cell) { return (cell.shift(field, 0, i, j) + ...); });
+                do_not_optimize(v[index(n / 2, n / 2)]);
+            }
+        );
+
+        auto const set = CellSet<2>::from_box(0, Box<2>{{0, 0}, {n, n}});
+        suite.run("stencil/parallel_for_each_interval_2d", n * n,
+            [&] {
+                parallel_for_each_interval(set,
+                    [&] (std::size_t, Interval const& interval, std::ptrdiff_t j)
+                    {
+                        for (auto i = interval.a; i < interval.b; ++i)
+                            v[index(i, j)] = stencil.apply([&] (auto... cell) { return (cell.shift(field, 0, i, j) + ...); });
+                    }
+                );
+                do_not_optimize(v[index(n / 2, n / 2)]);
+            }
+        );
+
+        Box<2> const domain{{0, 0}, {n, n}};
+        suite.run("stencil/split_apply_2d", n * n,
+            [&] {
+                double sum = 0.;
+                auto accumulate = [&] (std::size_t, auto i, std::ptrdiff_t j)
+                {
+                    if constexpr (std::is_same_v<decltype(i), Interval>)
+                        for (auto ii = i.a; ii < i.b; ++ii)
+                            sum += u[index(ii, j)];
+                    else
+                        sum += u[index(i, j)];
+                };
+                for (std::ptrdiff_t j = 0; j < n; ++j)
+                    split_apply(stencil, domain, accumulate, TruncateBoundary{}, 0, Interval{0, n}, j);
+                do_not_optimize(sum);
+            }
+        );
+    }
+    {
+        constexpr std::ptrdiff_t n = 96;
+        constexpr std::ptrdiff_t stride = n + 4;
+        std::vector<double> u(stride * stride * stride, 1.), v(stride * stride * stride, 0.);
+        auto index = [] (std::ptrdiff_t i, std::ptrdiff_t j, std::ptrdiff_t k) { return static_cast<std::size_t>((i + 2) + stride * ((j + 2) + stride * (k + 2))); };
+        auto field = [&] (std::size_t, std::ptrdiff_t i, std::ptrdiff_t j, std::ptrdiff_t k) -> double& { return u[index(i, j, k)]; };
+        using Stencil = decltype(make_KCellND<3>().neighborhood<2>());
+
+        suite.run("stencil/neighborhood2_3d_box", n * n * n,
+            [&] {
+                for (std::ptrdiff_t k = 0; k < n; ++k)
+                    for (std::ptrdiff_t j = 0; j < n; ++j)
+                        for (std::ptrdiff_t i = 0; i < n; ++i)
+                            v[index(i, j, k)] = Stencil::apply([&] (auto... cell) { return (cell.shift(field, 0, i, j, k) + ...); });
+                do_not_optimize(v[index(n / 2, n / 2, n / 2)]);
+            }
+        );
+    }
+
+    // Iterated Jacobi sweeps on a box much larger than the caches: naive sweeps against temporal blocking
+    {
+        constexpr std::ptrdiff_t n = 256;
+        constexpr std::ptrdiff_t stride = n + 2;
+        constexpr std::size_t n_sweeps = 8;
+        std::array<std::vector<double>, 2> buffers{std::vector<double>(stride * stride * stride, 1.), std::vector<double>(stride * stride * stride, 1.)};
+        auto index = [] (std::ptrdiff_t i, std::ptrdiff_t j, std::ptrdiff_t k) { return static_cast<std::size_t>((i + 1) + stride * ((j + 1) + stride * (k + 1))); };
+        auto kernel = [&] (std::size_t sweep, std::size_t, Interval const& interval, std::ptrdiff_t j, std::ptrdiff_t k)
+        {
+            double const* u = buffers[sweep % 2].data() + index(0, j, k);
+            double * v = buffers[(sweep + 1) % 2].data() + index(0, j, k);
+            for (auto i = interval.a; i < interval.b; ++i)
+                v[i] = (u[i] + u[i - 1] + u[i + 1] + u[i - stride] + u[i + stride] + u[i - stride * stride] + u[i + stride * stride]) / 7.;
+        };
+        Box<3> const box{{0, 0, 0}, {n, n, n}};
+        constexpr auto stencil = make_KCellND<3>().neighborhood();
+
+        suite.run("stencil/jacobi_3d_naive_sweeps", n_sweeps * n * n * n,
+            [&] {
+                for (std::size_t s = 0; s < n_sweeps; ++s)
+                    details::parallel_for_each_row(box,
+                        [&] (Interval const& interval, std::ptrdiff_t j, std::ptrdiff_t k) { kernel(s, 0, interval, j, k); },
+                        default_thread_count()
+                    );
+                do_not_optimize(buffers[n_sweeps % 2][index(n / 2, n / 2, n / 2)]);
+            }
+        );
+
+        suite.run("stencil/jacobi_3d_temporal_blocking", n_sweeps * n * n * n,
+            [&] {
+                temporal_blocking(stencil, box, 0, n_sweeps, kernel);
+                do_not_optimize(buffers[n_sweeps % 2][index(n / 2, n / 2, n / 2)]);
+            }
+        );
+    }
+
+    // Runtime stencils against the compile-time ones (the largest one needs several row kernels)
+    {
+        constexpr std::ptrdiff_t n = 96;
+        constexpr std::ptrdiff_t ghost = 3;
+        constexpr std::ptrdiff_t stride = n + 2 * ghost;
+        std::vector<double> u(stride * stride * stride, 1.), v(stride * stride * stride, 0.);
+        auto index = [] (std::ptrdiff_t i, std::ptrdiff_t j, std::ptrdiff_t k) { return static_cast<std::size_t>((i + ghost) + stride * ((j + ghost) + stride * (k + ghost))); };
+        auto field = [&] (std::size_t, std::ptrdiff_t i, std::ptrdiff_t j, std::ptrdiff_t k) -> double& { return u[index(i, j, k)]; };
+        auto output = [&] (std::size_t, std::ptrdiff_t i, std::ptrdiff_t j, std::ptrdiff_t k) -> double& { return v[index(i, j, k)]; };
+
+        auto compare = [&] (std::string const& name, auto stencil)
+        {
+            using Stencil = decltype(stencil);
+            std::array<double, Stencil::size()> weights;
+            for (std::size_t c = 0; c < weights.size(); ++c)
+                weights[c] = 1. / static_cast<double>(c + 1);
+            auto const runtime = make_runtime_stencil(stencil);
+            std::vector<double> const runtime_weights(weights.begin(), weights.end());
+
+            suite.run("stencil/mixed_level_apply_" + name, n * n * n,
+                [&] {
+                    for (std::ptrdiff_t k = 0; k < n; ++k)
+                        for (std::ptrdiff_t j = 0; j < n; ++j)
+                            mixed_level_apply(stencil, weights, field, output, 0, Interval{0, n}, j, k);
+                    do_not_optimize(v[index(n / 2, n / 2, n / 2)]);
+                }
+            );
+            suite.run("stencil/runtime_apply_" + name, n * n * n,
+                [&] {
+                    for (std::ptrdiff_t k = 0; k < n; ++k)
+                        for (std::ptrdiff_t j = 0; j < n; ++j)
+                            runtime_apply(runtime, runtime_weights, field, output, 0, Interval{0, n}, j, k);
+                    do_not_optimize(v[index(n / 2, n / 2, n / 2)]);
+                }
+            );
+        };
+
+        compare("neighborhood_3d", make_KCellND<3>().neighborhood());   // 7 cells
+        compare("neighborhood3_3d", make_KCellND<3>().neighborhood<3>()); // 63 cells
+    }
+
+    // Coarse-to-fine strided rows (restriction of the children of an interval, see KCell::up)
+    {
+        constexpr std::ptrdiff_t n = 1 << 16;
+        std::vector<double> fine(2 * n, 1.), coarse(n, 0.);
+        auto const children = KCell<true, 0, 0>::up();
+
+        suite.run("interval/strided_scalar", 2 * n,
+            [&] {
+                children.foreach(
+                    [&] (auto child)
+                    {
+                        Interval const interval = child.shift(Interval{0, n});
+                        for (auto i = interval.a; i < interval.b; i += static_cast<std::ptrdiff_t>(interval.step))
+                            coarse[static_cast<std::size_t>(i >> 1)] += 0.5 * fine[static_cast<std::size_t>(i)];
+                    }
+                );
+                do_not_optimize(coarse[n / 2]);
+            }
+        );
+
+        suite.run("interval/strided_blocks", 2 * n,
+            [&] {
+                children.foreach(
+                    [&] (auto child)
+                    {
+                        for_each_block(child.shift(Interval{0, n}),
+                            [&] (auto block)
+                            {
+                                constexpr std::size_t width = decltype(block)::size();
+                                double * out = coarse.data() + (block.first >> 1);
+                                auto const values = block.load(fine.data() + block.first);
+                                for (std::size_t k = 0; k < width; ++k)
+                                    out[k] += 0.5 * values[k];
+                            }
+                        );
+                    }
+                );
+                do_not_optimize(coarse[n / 2]);
+            }
+        );
+    }
+
+    // Macro benchmark: one adaptation step
+    {
+        auto field = [] (std::size_t level, std::ptrdiff_t i, std::ptrdiff_t j)
+        {
+            double const h = 1. / static_cast<double>(std::size_t(1) << level);
+            double const x = (static_cast<double>(i) + 0.5) * h - 0.5;
+            double const y = (static_cast<double>(j) + 0.5) * h - 0.5;
+            return std::tanh((std::sqrt(x * x + y * y) - 0.25) / 0.005);
+        };
+        std::vector<CellSet<2>> mesh;
+        for (std::size_t l = 0; l <= 6; ++l)
+            mesh.emplace_back(l);
+        mesh[6] = CellSet<2>::from_box(6, Box<2>{{0, 0}, {64, 64}});
+        AdaptationCriterion const criterion{0.05, 0.005, 3, 10};
+        for (std::size_t step = 0; step < 4; ++step)
+            mesh = adapt(mesh, make_KCellND<2>().neighborhood(), field, criterion);
+
+        std::size_t cells = 0;
+        for (auto const& set : mesh)
+            cells += set.size();
+        suite.run("adaptation/step_2d", cells,
+            [&] { do_not_optimize(adapt(mesh, make_KCellND<2>().neighborhood(), field, criterion)); }
+        );
+
+        // Same step with its temporaries allocated by new/delete instead of the arena
+        suite.run("adaptation/step_2d_without_arena", cells,
+            [&] { do_not_optimize(details::adapt_step(mesh, make_KCellND<2>().neighborhood(), field, criterion, default_thread_count())); }
+        );
+    }
+
+    return suite.finish();
+}
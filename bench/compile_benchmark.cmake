@@ -0,0 +1,61 @@
+# Compile-time cost benchmark of the template machinery
+#
+# Compiles one generated translation unit per (dimension, distance) combination and records
+# the wall time and the peak memory of the compiler in a JSON report.
+#
+# Variables (passed with -D):
+#   COMPILER        C++ compiler
+#   PROBE           compile_probe executable
+#   INCLUDE_DIR     Include directory of the library
+#   SOURCE_DIR      Directory of compile_benchmark.cpp.in
+#   WORK_DIR        Directory of the generated translation units
+#   REPORT          Path of the JSON report
+#   DIMENSIONS      List of dimensions (default 1;2;3;4)
+#   DISTANCES       List of neighbourhood distances (default 1;2;3;4)
+#   TIMEOUT         Timeout of each compilation in seconds (default 600)
+#   FLAGS           Additional compiler flags (the project flags of the build type when run by the compile_benchmarks target)
+#
+# Requires CMake 3.19 (string(JSON)).
+
+cmake_minimum_required(VERSION 3.19)
+
+if (NOT DIMENSIONS)
+  set(DIMENSIONS 1 2 3 4)
+endif ()
+if (NOT DISTANCES)
+  set(DISTANCES 1 2 3 4)
+endif ()
+if (NOT TIMEOUT)
+  set(TIMEOUT 600)
+endif ()
+separate_arguments(FLAGS)
+list(JOIN FLAGS " " FLAGS_STRING)
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+set(ENTRIES)
+
+foreach (DIMENSION ${DIMENSIONS})
+  foreach (DISTANCE ${DISTANCES})
+    set(NAME "kcellnd_d${DIMENSION}_distance${DISTANCE}")
+    configure_file(${SOURCE_DIR}/compile_benchmark.cpp.in ${WORK_DIR}/${NAME}.cpp @ONLY)
+
+    execute_process(
+      COMMAND ${PROBE} ${NAME} ${TIMEOUT} ${COMPILER} -std=c++17 ${FLAGS} -I${INCLUDE_DIR} -c ${WORK_DIR}/${NAME}.cpp -o ${WORK_DIR}/${NAME}.o
+      OUTPUT_VARIABLE ENTRY
+      OUTPUT_STRIP_TRAILING_WHITESPACE
+      ERROR_QUIET
+    )
+
+    string(JSON STATUS GET "${ENTRY}" status)
+    string(JSON WALL GET "${ENTRY}" wall_s)
+    string(JSON MEMORY GET "${ENTRY}" peak_rss_kb)
+    math(EXPR MEMORY_MB "${MEMORY} / 1024")
+    message(STATUS "${NAME}: ${STATUS}, ${WALL} s, ${MEMORY_MB} MiB")
+
+    list(APPEND ENTRIES "    ${ENTRY}")
+  endforeach ()
+endforeach ()
+
+list(JOIN ENTRIES ",\n" BODY)
+file(WRITE ${REPORT} "{\n  \"compiler\": \"${COMPILER}\",\n  \"flags\": \"${FLAGS_STRING}\",\n  \"translation_units\": [\n${BODY}\n  ]\n}\n")
+message(STATUS "Report written to ${REPORT}")
@@ -0,0 +1,67 @@
+/**
+ * Run a command (eg a compiler invocation) and report its wall time and peak memory as a JSON line
+ *
+ * Usage: compile_probe <name> <timeout_s> <command> [args...]
+ *
+ * The peak memory is the maximum resident set size of the command and its descendants (eg cc1plus).
+ * The command is killed if it runs longer than the timeout (0 for no timeout).
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(int argc, char** argv)
+{
+    if (argc < 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " <name> <timeout_s> <command> [args...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    char const* name = argv[1];
+    double const timeout = std::strtod(argv[2], nullptr);
+
+    auto const start = std::chrono::steady_clock::now();
+    pid_t const pid = fork();
+    if (pid < 0)
+        return EXIT_FAILURE;
+    if (pid == 0)
+    {
+        setpgid(0, 0); // Own process group so that the compiler subprocesses are killed on timeout
+        execvp(argv[3], argv + 3);
+        _exit(127);
+    }
+
+    int status = 0;
+    bool timed_out = false;
+    while (waitpid(pid, &status, WNOHANG) == 0)
+    {
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+        if (timeout > 0 && elapsed.count() > timeout)
+        {
+            kill(-pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            timed_out = true;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    std::chrono::duration<double> const wall = std::chrono::steady_clock::now() - start;
+
+    rusage usage{};
+    getrusage(RUSAGE_CHILDREN, &usage);
+
+    char const* result = timed_out ? "timeout" : ((WIFEXITED(status) && WEXITSTATUS(status) == 0) ? "ok" : "failed");
+    std::cout << "{\"name\": \"" << name << "\", "
+              << "\"status\": \"" << result << "\", "
+              << "\"wall_s\": " << wall.count() << ", "
+              << "\"peak_rss_kb\": " << usage.ru_maxrss << "}" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory_resource>
+#include <tuple>
+#include <vector>
+
+#include "kcells.hpp"
+#include "box.hpp"
+#include "cell_set.hpp"
+#include "balance.hpp"
+#include "arena.hpp"
+#include "parallel.hpp"
+
+/// Thresholds and level bounds of the mesh adaptation
+struct AdaptationCriterion
+{
+    double refine_threshold;    ///< Cells of indicator above are refined
+    double coarsen_threshold;   ///< Complete families of cells of indicator below are coarsened
+    std::size_t min_level;
+    std::size_t max_level;
+};
+
+/// Cells to refine and to coarsen of one level
+template <std::size_t Dim>
+struct AdaptationMarks
+{
+    CellSet<Dim> refine;
+    CellSet<Dim> coarsen;
+};
+
+/** Jump indicator of a cell: max |field(cell') - field(cell)| over the cells cell' of the stencil
+ *
+ * @param field     Called as field(level, i, outer...) (see KCell::shift)
+ */
+template <
+    typename Stencil,
+    typename Field,
+    typename... Index
+>
+double jump_indicator(Stencil stencil, Field && field, std::size_t level, Index... index)
+{
+    double const center = field(level, index...);
+    return stencil.apply(
+        [&] (auto... cell)
+        {
+            double jump = 0.;
+            ((jump = std::max(jump, std::abs(static_cast<double>(cell.shift(field, level, index...)) - center))), ...);
+            return jump;
+        }
+    );
+}
+
+namespace details
+{
+    /// Stream the marked cells of the rows [first, last[ of a set into the sets of cells to refine and to coarsen
+    template <
+        std::size_t Dim,
+        typename Stencil,
+        typename Field
+    >
+    void mark_rows(CellSet<Dim> const& set, std::size_t first, std::size_t last, Stencil stencil, Field && field, AdaptationCriterion const& criterion, AdaptationMarks<Dim> & marks)
+    {
+        bool const can_refine = set.level < criterion.max_level;
+        bool const can_coarsen = set.level > criterion.min_level;
+        for (std::size_t r = first; r < last; ++r)
+            for (std::size_t k = set.row_offsets[r]; k < set.row_offsets[r + 1]; ++k)
+                std::apply(
+                    [&] (auto... outer)
+                    {
+                        for (auto i = set.intervals[k].a; i < set.intervals[k].b; ++i)
+                        {
+                            double const indicator = jump_indicator(stencil, field, set.level, i, outer...);
+                            if (can_refine && indicator > criterion.refine_threshold)
+                                marks.refine.push_back(set.rows[r], {i, i + 1}); // Merged with the previous run
+                            else if (can_coarsen && indicator < criterion.coarsen_threshold)
+                                marks.coarsen.push_back(set.rows[r], {i, i + 1});
+                        }
+                    },
+                    set.rows[r]
+                );
+    }
+}
+
+/** Mark the cells of a level for refinement or coarsening
+ *
+ * The indicator is computed and compared to the thresholds on chunks of consecutive rows, in parallel,
+ * and the runs of marked cells are streamed into per-chunk sets that are concatenated:
+ * neither the indicator nor any dense bitmap of the level is stored, the memory following the number of marked intervals.
+ */
+template <
+    std::size_t Dim,
+    typename Stencil,
+    typename Field
+>
+AdaptationMarks<Dim> mark_cells(CellSet<Dim> const& set, Stencil stencil, Field && field, AdaptationCriterion const& criterion, std::size_t n_threads = default_thread_count())
+{
+    AdaptationMarks<Dim> result{CellSet<Dim>(set.level), CellSet<Dim>(set.level)};
+    if (set.empty())
+        return result;
+
+    // Chunks of rows, more than threads to balance the load
+    std::size_t const n_chunks = std::min(set.row_count(), 4 * std::max<std::size_t>(1, n_threads));
+    std::vector<AdaptationMarks<Dim>> parts;
+    parts.reserve(n_chunks);
+    for (std::size_t c = 0; c < n_chunks; ++c)
+        parts.push_back({CellSet<Dim>(set.level), CellSet<Dim>(set.level)});
+
+    work_stealing_for(n_chunks,
+        [&] (std::size_t c)
+        {
+            details::mark_rows(set, c * set.row_count() / n_chunks, (c + 1) * set.row_count() / n_chunks, stencil, field, criterion, parts[c]);
+        },
+        n_threads
+    );
+
+    for (auto const& part : parts)
+    {
+        details::append_rows(result.refine, part.refine);
+        details::append_rows(result.coarsen, part.coarsen);
+    }
+    return result;
+}
+
+/// Parents (one level coarser) of the cells of the set whose children are all in the set
+template <std::size_t Dim>
+CellSet<Dim> complete_families(CellSet<Dim> const& set, std::size_t n_threads = default_thread_count())
+{
+    auto const parents = coarsen(set, 1, n_threads);
+    auto const incomplete = set_difference(refine(parents, 1, n_threads), set);
+    return set_difference(parents, coarsen(incomplete, 1, n_threads));
+}
+
+namespace details
+{
+    /// Adaptation step of adapt, allocating its temporaries from the resource of the current thread
+    template <
+        std::size_t Dim,
+        typename Stencil,
+        typename Field
+    >
+    std::vector<CellSet<Dim>> adapt_step(std::vector<CellSet<Dim>> const& mesh, Stencil stencil, Field && field, AdaptationCriterion const& criterion, std::size_t n_threads)
+    {
+        static_assert(Stencil::minLevelShift() == 0 && Stencil::maxLevelShift() == 0, "Adaptation needs a stencil with no level shift");
+        std::size_t const n_levels = std::max(mesh.size(), criterion.max_level + 1);
+
+        std::vector<CellSet<Dim>> next;
+        for (std::size_t l = 0; l < n_levels; ++l)
+            next.emplace_back(l);
+
+        for (std::size_t l = 0; l < mesh.size(); ++l)
+        {
+            if (mesh[l].empty())
+                continue;
+
+            auto const marks = mark_cells(mesh[l], stencil, field, criterion, n_threads);
+            auto const families = (l > 0) ? complete_families(marks.coarsen, n_threads) : CellSet<Dim>(0);
+            auto const kept = set_difference(set_difference(mesh[l], marks.refine), refine(families, 1, n_threads));
+
+            next[l] = set_union(next[l], kept);
+            if (!marks.refine.empty())
+                next[l + 1] = set_union(next[l + 1], refine(marks.refine, 1, n_threads));
+            if (!families.empty())
+                next[l - 1] = set_union(next[l - 1], families);
+        }
+
+        balance(next, stencil, n_threads);
+
+        // Copies from the default resource: the result never refers to the resource of the step
+        std::vector<CellSet<Dim>> result;
+        for (std::size_t l = 0; l < n_levels; ++l)
+        {
+            result.emplace_back(l, std::pmr::get_default_resource());
+            result[l] = next[l];
+        }
+        return result;
+    }
+}
+
+/**
+ * One mesh adaptation step: indicator → mark → rebuild → balance
+ *
+ * Cells whose indicator exceeds the refinement threshold are replaced by their children,
+ * complete families of cells below the coarsening threshold are replaced by their parent,
+ * and the new mesh is 2:1 balanced for the stencil adjacency (see balance).
+ * All the temporaries of the step are allocated in a details::CellSetArena that doesn't outlive the call
+ * (the returned sets use the default resource).
+ *
+ * @param mesh      mesh[l] is the set of leaf cells of level l
+ * @param stencil   Stencil of the indicator and of the balance (cells of level shift 0)
+ * @param field     Called as field(level, i, outer...) on the cells of the mesh and on their stencil neighbours
+ * @return the new mesh, with max(mesh.size(), criterion.max_level + 1) levels
+ */
+template <
+    std::size_t Dim,
+    typename Stencil,
+    typename Field
+>
+std::vector<CellSet<Dim>> adapt(std::vector<CellSet<Dim>> const& mesh, Stencil stencil, Field && field, AdaptationCriterion const& criterion, std::size_t n_threads = default_thread_count())
+{
+    details::CellSetArena arena;
+    return details::adapt_step(mesh, stencil, field, criterion, n_threads);
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace details
+{
+    /// Memory resource used by default for the containers of the current thread (new/delete if no arena is active)
+    inline std::pmr::memory_resource* & thread_resource() noexcept
+    {
+        thread_local std::pmr::memory_resource* resource = std::pmr::new_delete_resource();
+        return resource;
+    }
+
+    /// Install a resource as the resource of the current thread for the lifetime of the object
+    class ScopedThreadResource
+    {
+    public:
+        explicit ScopedThreadResource(std::pmr::memory_resource* resource) noexcept
+            : m_previous(std::exchange(thread_resource(), resource))
+        {
+        }
+
+        ScopedThreadResource(ScopedThreadResource const&) = delete;
+        ScopedThreadResource & operator= (ScopedThreadResource const&) = delete;
+
+        ~ScopedThreadResource()
+        {
+            thread_resource() = m_previous;
+        }
+
+    private:
+        std::pmr::memory_resource* m_previous;
+    };
+
+    /**
+     * Thread-local bump allocation: each thread allocating from the resource gets its own monotonic buffer
+     *
+     * Deallocation does nothing and all the buffers are released at once when the resource is destroyed.
+     * Since a thread only bumps in its own buffer, the resource can be shared by threads without locking
+     * (eg a set created by the calling thread and filled by a worker). The buffer of a thread is looked up
+     * in a thread_local cache; the mutex is only taken the first time a thread allocates from the resource.
+     * In debug builds, the resource also counts the bytes allocated and not yet deallocated.
+     */
+    class ArenaResource : public std::pmr::memory_resource
+    {
+    public:
+        explicit ArenaResource(std::size_t initial_block_size)
+            : m_id(next_id())
+            , m_initial_block_size(initial_block_size)
+        {
+        }
+
+        ArenaResource(ArenaResource const&) = delete;
+        ArenaResource & operator= (ArenaResource const&) = delete;
+
+#ifndef NDEBUG
+        /// Number of bytes allocated and not yet deallocated
+        std::size_t allocated() const noexcept { return m_allocated.load(std::memory_order_relaxed); }
+#endif
+
+    private:
+        /// Buffer of the current thread for the resource of given id
+        struct CachedBuffer
+        {
+            std::uint64_t id = 0;
+            std::pmr::monotonic_buffer_resource* buffer = nullptr;
+        };
+
+        /// Unique identifier (so that a cached buffer is never used by a resource created at the same address)
+        static std::uint64_t next_id() noexcept
+        {
+            static std::atomic<std::uint64_t> id{0};
+            return ++id;
+        }
+
+        static CachedBuffer & cached_buffer() noexcept
+        {
+            thread_local CachedBuffer cache;
+            return cache;
+        }
+
+        std::pmr::monotonic_buffer_resource* thread_buffer()
+        {
+            auto & cache = cached_buffer();
+            if (cache.id != m_id)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto const id = std::this_thread::get_id();
+                auto it = std::find_if(m_buffers.begin(), m_buffers.end(), [id] (auto const& b) { return b.first == id; });
+                if (it == m_buffers.end())
+                    it = m_buffers.insert(m_buffers.end(), {id, std::make_unique<std::pmr::monotonic_buffer_resource>(m_initial_block_size)});
+                cache = {m_id, it->second.get()};
+            }
+            return cache.buffer;
+        }
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+#ifndef NDEBUG
+            m_allocated.fetch_add(bytes, std::memory_order_relaxed);
+#endif
+            return thread_buffer()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void*, [[maybe_unused]] std::size_t bytes, std::size_t) override
+        {
+#ifndef NDEBUG
+            m_allocated.fetch_sub(bytes, std::memory_order_relaxed);
+#endif
+        }
+
+        bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override
+        {
+            return this == &other;
+        }
+
+        std::uint64_t m_id;
+        std::size_t m_initial_block_size;
+        std::mutex m_mutex;
+        std::vector<std::pair<std::thread::id, std::unique_ptr<std::pmr::monotonic_buffer_resource>>> m_buffers;
+#ifndef NDEBUG
+        std::atomic<std::size_t> m_allocated{0};
+#endif
+    };
+
+    /**
+     * Arena for the temporaries of a pass (eg one mesh adaptation, see adapt)
+     *
+     * While an arena is alive, the cell sets (and their temporaries) created in the current thread,
+     * and in the worker threads of parallel_for and work_stealing_for started from it, are bump-allocated
+     * from thread-local buffers that are all released when the arena is destroyed. Arenas can be nested.
+     *
+     * The arena is private to the passes that use it: a set created in the arena must not outlive it,
+     * so the results of the pass are copied (or assigned) to sets created outside of the arena,
+     * the copy using its own resource. This is asserted in debug builds when the arena is destroyed.
+     */
+    class CellSetArena
+    {
+    public:
+        /// Arena whose thread buffers start with the given size (and grow geometrically)
+        explicit CellSetArena(std::size_t initial_block_size = std::size_t(1) << 16)
+            : m_resource(initial_block_size)
+            , m_scope(&m_resource)
+        {
+        }
+
+        CellSetArena(CellSetArena const&) = delete;
+        CellSetArena & operator= (CellSetArena const&) = delete;
+
+        ~CellSetArena()
+        {
+            assert(m_resource.allocated() == 0 && "A cell set allocated in the arena outlives it");
+        }
+
+        std::pmr::memory_resource* resource() noexcept { return &m_resource; }
+
+#ifndef NDEBUG
+        /// Number of bytes currently allocated from the arena (debug builds only)
+        std::size_t allocated() const noexcept { return m_resource.allocated(); }
+#endif
+
+    private:
+        ArenaResource m_resource;
+        ScopedThreadResource m_scope;
+    };
+}
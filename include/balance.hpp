@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "kcells.hpp"
+#include "cell_set.hpp"
+#include "parallel.hpp"
+
+/**
+ * Dilation of a set by a stencil: union of the set translated by each cell of the stencil
+ *
+ * The translated sets are built in parallel and merged by a parallel tree reduction of unions.
+ */
+template <
+    std::size_t Dim,
+    typename Stencil
+>
+CellSet<Dim> dilate(CellSet<Dim> const& set, Stencil, std::size_t n_threads = default_thread_count())
+{
+    static_assert(Stencil::kcell_size() == Dim, "Dimension mismatch between the stencil and the cell set");
+    static_assert(Stencil::minLevelShift() == 0 && Stencil::maxLevelShift() == 0, "Dilation needs a stencil with no level shift");
+
+    constexpr auto shifts = Stencil::indexShift();
+    if constexpr (shifts.size() == 0)
+        return CellSet<Dim>(set.level);
+    else
+    {
+        auto sets = details::make_sets<Dim>(shifts.size(), set.level);
+        parallel_for(0, sets.size(), [&] (std::size_t c) { sets[c] = translate(set, shifts[c]); }, n_threads);
+
+        for (std::size_t stride = 1; stride < sets.size(); stride *= 2)
+            parallel_for(0, (sets.size() + 2 * stride - 1) / (2 * stride),
+                [&] (std::size_t p)
+                {
+                    std::size_t const i = 2 * stride * p;
+                    if (i + stride < sets.size())
+                        sets[i] = set_union(sets[i], sets[i + stride]);
+                },
+                n_threads
+            );
+
+        return std::move(sets[0]);
+    }
+}
+
+/**
+ * 2:1 balance of a multi-level mesh
+ *
+ * After balancing, the cells of the mesh reached from a cell of level l through the stencil
+ * (eg face, edge or vertex adjacency) are of level l-1 or finer.
+ * Levels are processed from the finest one: the stencil neighbourhood of the cells of level l,
+ * projected on level l-1, is intersected with the coarser levels and the intersecting cells are refined
+ * (from the coarsest level so that refinements cascade). Only set operations on interval lists are used.
+ *
+ * @param mesh      mesh[l] is the set of leaf cells of level l (the leaves of all levels must not overlap)
+ * @param stencil   Adjacency stencil (cells of level shift 0)
+ */
+template <
+    std::size_t Dim,
+    typename Stencil
+>
+void balance(std::vector<CellSet<Dim>> & mesh, Stencil stencil, std::size_t n_threads = default_thread_count())
+{
+    for (std::size_t level = mesh.size(); level-- > 2;)
+    {
+        if (mesh[level].empty())
+            continue;
+
+        // Cells of level l-1 that must be covered by cells of level l-1 or finer
+        auto const required = coarsen(dilate(mesh[level], stencil, n_threads));
+
+        for (std::size_t coarse = 0; coarse + 1 < level; ++coarse)
+        {
+            if (mesh[coarse].empty())
+                continue;
+
+            auto const flagged = set_intersection(mesh[coarse], coarsen(required, level - 1 - coarse));
+            if (flagged.empty())
+                continue;
+
+            mesh[coarse] = set_difference(mesh[coarse], flagged);
+            mesh[coarse + 1] = set_union(mesh[coarse + 1], refine(flagged));
+        }
+    }
+}
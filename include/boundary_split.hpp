@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "box.hpp"
+#include "interval.hpp"
+#include "instrumentation.hpp"
+
+/// Boundary callback that removes the out-of-domain cells of the stencil
+struct TruncateBoundary
+{
+    template <typename... T>
+    constexpr void operator() (T &&...) const noexcept {}
+};
+
+namespace details
+{
+    /// Offset, at the origin level and along direction D, of the cell reached by a KCellND of non-negative level shift
+    template <
+        std::size_t D,
+        typename Cell
+    >
+    constexpr std::ptrdiff_t origin_offset() noexcept
+    {
+        using kcell = typename Cell::template kcell_type<D>;
+        return kcell::indexShift() >> kcell::levelShift();
+    }
+
+    /** Largest room (distance from the origin cell to the last domain cell) along direction D needed by a KCellND
+     *
+     *  Along an open direction, this is origin_offset. Along a closed direction, the domain also contains
+     *  the closing cell at max_corner (eg the right edge of the last face), so that one less room is needed
+     *  (in units of the origin level, a fine closed cell being inside as long as it is not after max_corner).
+     */
+    template <
+        std::size_t D,
+        typename Cell
+    >
+    constexpr std::ptrdiff_t upper_room() noexcept
+    {
+        using kcell = typename Cell::template kcell_type<D>;
+        if constexpr (kcell::isOpen())
+            return origin_offset<D, Cell>();
+        else
+            return -((-kcell::indexShift()) >> kcell::levelShift()) - 1;
+    }
+
+    /// Cells of the stencil whose offset along D is in [Lower, Upper] (Inside) or outside of it (!Inside), see upper_room
+    template <
+        std::size_t D,
+        std::ptrdiff_t Lower,
+        std::ptrdiff_t Upper,
+        bool Inside,
+        typename Stencil
+    >
+    constexpr auto filter_offset(Stencil) noexcept
+    {
+        return Stencil::apply(
+            [] (auto... cell)
+            {
+                return ([] (auto c)
+                {
+                    constexpr auto offset = origin_offset<D, decltype(c)>();
+                    constexpr auto room = upper_room<D, decltype(c)>();
+                    if constexpr ((offset >= Lower && room <= Upper) == Inside)
+                        return KCells<decltype(c)>{};
+                    else
+                        return KCells<>{};
+                }(cell) + ... + KCells<>{});
+            }
+        );
+    }
+
+    /// Call fn(integral_constant<Lower>, integral_constant<Upper>) for the runtime lower/upper rooms in [0, HL] x [0, HU]
+    template <
+        std::ptrdiff_t HL,
+        std::ptrdiff_t HU,
+        typename Function,
+        std::ptrdiff_t... L,
+        std::ptrdiff_t... U
+    >
+    void dispatch_rooms(std::ptrdiff_t lower, std::ptrdiff_t upper, Function && fn, std::integer_sequence<std::ptrdiff_t, L...>, std::integer_sequence<std::ptrdiff_t, U...>)
+    {
+        auto dispatch_upper = [&] (auto l)
+        {
+            ((upper == U ? (fn(l, std::integral_constant<std::ptrdiff_t, U>{}), true) : false) || ...);
+        };
+        ((lower == L ? (dispatch_upper(std::integral_constant<std::ptrdiff_t, L>{}), true) : false) || ...);
+    }
+
+    /// True if the cell stays in the domain along the outer directions, given the rooms of the row
+    template <
+        typename Cell,
+        std::size_t Dim
+    >
+    constexpr bool in_outer_domain(std::array<std::array<std::ptrdiff_t, Dim>, 2> const& rooms) noexcept
+    {
+        bool inside = true;
+        Cell::enumerate(
+            [&] (auto d, auto)
+            {
+                if constexpr (decltype(d)::value > 0)
+                {
+                    constexpr auto offset = origin_offset<decltype(d)::value, Cell>();
+                    constexpr auto room = upper_room<decltype(d)::value, Cell>();
+                    inside = inside && offset >= -rooms[0][d] && room <= rooms[1][d];
+                }
+            }
+        );
+        return inside;
+    }
+}
+
+/**
+ * Apply a stencil on the cells of an interval, split in interior and boundary spans of a domain
+ *
+ * Using the stencil footprint (see KCells::haloWidth), the interval is split in an interior span where
+ * the whole stencil stays in the domain and is applied without any check (stencil.shift(fn, level, interval, outer...)),
+ * and boundary spans processed cell by cell. For the boundary cells, the stencil is split at compile time,
+ * depending on the distance to the boundary along direction 0, in the cells inside the domain (passed to fn)
+ * and the cells outside (passed to bc, or removed with TruncateBoundary). Rows close to the boundary of
+ * the outer directions are processed as boundary cells with an additional (per stencil cell) test.
+ *
+ * @param domain    Domain at the given level (the cells of the interval outside of it are ignored). Along a direction
+ *                  where a stencil cell is closed, the domain includes the closing cells at max_corner.
+ * @param fn        Called as fn(level, i, outer...) where i is an Interval (interior) or an index (boundary)
+ * @param bc        Called as bc(level, i, outer...) with the (out-of-domain) indices of the removed cells
+ * @pre The stencil must not contain coarser cells (negative level shift)
+ */
+template <
+    typename Stencil,
+    std::size_t Dim,
+    typename Function,
+    typename Boundary,
+    typename... Outer
+>
+void split_apply(Stencil stencil, Box<Dim> const& domain, Function && fn, Boundary && bc, std::size_t level, Interval const& interval, Outer... outer)
+{
+    static_assert(sizeof...(Outer) + 1 == Dim, "Invalid number of indices");
+    static_assert(Stencil::minLevelShift() >= 0, "Stencils with coarser cells are not supported");
+    constexpr auto halo = Stencil::haloWidth();
+    constexpr bool truncate = std::is_same_v<std::decay_t<Boundary>, TruncateBoundary>;
+    KSPACE_COUNT(StencilDriver, Stencil, Stencil::size() * instrumentation::cell_count(interval), instrumentation::cell_count(interval), 0);
+
+    // Rooms between the row and the domain boundaries in the outer directions (clamped to the halo)
+    std::array<std::ptrdiff_t, Dim> const indices{0, static_cast<std::ptrdiff_t>(outer)...};
+    std::array<std::array<std::ptrdiff_t, Dim>, 2> rooms{};
+    bool interior_row = true;
+    for (std::size_t d = 1; d < Dim; ++d)
+    {
+        if (indices[d] < domain.min_corner[d] || indices[d] >= domain.max_corner[d])
+            return;
+        rooms[0][d] = std::min(indices[d] - domain.min_corner[d], halo[0][d]);
+        rooms[1][d] = std::min(domain.max_corner[d] - 1 - indices[d], halo[1][d]);
+        interior_row = interior_row && rooms[0][d] == halo[0][d] && rooms[1][d] == halo[1][d];
+    }
+
+    auto const boundary = [&] (std::ptrdiff_t first, std::ptrdiff_t last)
+    {
+        for (std::ptrdiff_t i = first; i < last; i += static_cast<std::ptrdiff_t>(interval.step))
+        {
+            if (i < domain.min_corner[0] || i >= domain.max_corner[0])
+                continue;
+
+            details::dispatch_rooms<halo[0][0], halo[1][0]>(
+                std::min(i - domain.min_corner[0], halo[0][0]),
+                std::min(domain.max_corner[0] - 1 - i, halo[1][0]),
+                [&] (auto lower, auto upper)
+                {
+                    constexpr auto inside = details::filter_offset<0, -decltype(lower)::value, decltype(upper)::value, true>(Stencil{});
+                    inside.foreach(
+                        [&] (auto cell)
+                        {
+                            if (interior_row || details::in_outer_domain<decltype(cell)>(rooms))
+                                cell.shift(fn, level, i, outer...);
+                            else if constexpr (!truncate)
+                                cell.shift(bc, level, i, outer...);
+                        }
+                    );
+
+                    if constexpr (!truncate)
+                    {
+                        constexpr auto outside = details::filter_offset<0, -decltype(lower)::value, decltype(upper)::value, false>(Stencil{});
+                        outside.foreach([&] (auto cell) { cell.shift(bc, level, i, outer...); });
+                    }
+                },
+                std::make_integer_sequence<std::ptrdiff_t, halo[0][0] + 1>{},
+                std::make_integer_sequence<std::ptrdiff_t, halo[1][0] + 1>{}
+            );
+        }
+    };
+
+    if (!interior_row)
+    {
+        boundary(interval.a, interval.b);
+        return;
+    }
+
+    Interval const interior = clip(interval, domain.min_corner[0] + halo[0][0], domain.max_corner[0] - halo[1][0]);
+    boundary(interval.a, interior.a);
+    if (interior.a < interior.b)
+        stencil.shift(fn, level, interior, outer...);
+    boundary(interior.b, interval.b);
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cstddef>
+#include <ostream>
+
+#include "interval.hpp"
+
+/**
+ * Axis-aligned box of cell indices at a given level
+ *
+ * Bounds are half-open like Interval: a cell of indices i belongs to the box
+ * if min_corner[d] <= i[d] < max_corner[d] for each direction d.
+ *
+ * Cells are enumerated row by row: a row is the set of cells sharing the same
+ * indices along directions 1...Dim-1 (same convention as Samurai's CellInterval).
+ *
+ * @tparam Dim  Dimension of the space
+ */
+template <
+    std::size_t Dim
+>
+struct Box
+{
+    static_assert(Dim > 0, "Box cannot be of dimension 0");
+
+    using index_type = std::ptrdiff_t;
+    using indices_type = std::array<index_type, Dim>;
+    using row_indices_type = std::array<index_type, Dim - 1>;
+
+    indices_type min_corner = {};
+    indices_type max_corner = {};
+
+    /// Dimension of the space
+    static constexpr std::size_t dimension() noexcept { return Dim; }
+
+    /// Number of cells along direction d
+    constexpr std::size_t shape(std::size_t d) const noexcept
+    {
+        return max_corner[d] > min_corner[d] ? static_cast<std::size_t>(max_corner[d] - min_corner[d]) : 0;
+    }
+
+    /// Number of cells in the box
+    constexpr std::size_t size() const noexcept
+    {
+        std::size_t s = 1;
+        for (std::size_t d = 0; d < Dim; ++d)
+            s *= shape(d);
+        return s;
+    }
+
+    constexpr bool empty() const noexcept { return size() == 0; }
+
+    /// True if the given indices lie in the box
+    constexpr bool contains(indices_type const& indices) const noexcept
+    {
+        for (std::size_t d = 0; d < Dim; ++d)
+            if (indices[d] < min_corner[d] || indices[d] >= max_corner[d])
+                return false;
+        return true;
+    }
+
+    /// Position of the given indices in a storage of the box where direction 0 varies fastest
+    constexpr std::size_t offset(indices_type const& indices) const noexcept
+    {
+        std::size_t o = 0;
+        for (std::size_t d = Dim; d-- > 0;)
+            o = o * shape(d) + static_cast<std::size_t>(indices[d] - min_corner[d]);
+        return o;
+    }
+
+    /// Range of the box along direction d
+    constexpr Interval interval(std::size_t d = 0) const noexcept
+    {
+        return {min_corner[d], max_corner[d]};
+    }
+
+    /// Number of rows (cells sharing the same indices along directions 1...Dim-1)
+    constexpr std::size_t row_count() const noexcept
+    {
+        std::size_t s = shape(0) > 0 ? 1 : 0;
+        for (std::size_t d = 1; d < Dim; ++d)
+            s *= shape(d);
+        return s;
+    }
+
+    /// Outer indices (directions 1...Dim-1) of the r-th row (direction 1 varies fastest)
+    constexpr row_indices_type row_indices(std::size_t r) const noexcept
+    {
+        row_indices_type indices{};
+        for (std::size_t d = 1; d < Dim; ++d)
+        {
+            indices[d - 1] = min_corner[d] + static_cast<index_type>(r % shape(d));
+            r /= shape(d);
+        }
+        return indices;
+    }
+
+    /// Box enlarged by lower[d] cells before and upper[d] cells after along each direction d
+    constexpr Box grow(indices_type const& lower, indices_type const& upper) const noexcept
+    {
+        Box box = *this;
+        for (std::size_t d = 0; d < Dim; ++d)
+        {
+            box.min_corner[d] -= lower[d];
+            box.max_corner[d] += upper[d];
+        }
+        return box;
+    }
+
+    /// Box enlarged by the same width in every direction (shrunk for a negative width)
+    constexpr Box grow(index_type width) const noexcept
+    {
+        indices_type w{};
+        for (std::size_t d = 0; d < Dim; ++d)
+            w[d] = width;
+        return grow(w, w);
+    }
+};
+
+/// Intersection of two boxes (possibly empty)
+template <
+    std::size_t Dim
+>
+constexpr Box<Dim> intersection(Box<Dim> const& lhs, Box<Dim> const& rhs) noexcept
+{
+    Box<Dim> box;
+    for (std::size_t d = 0; d < Dim; ++d)
+    {
+        box.min_corner[d] = std::max(lhs.min_corner[d], rhs.min_corner[d]);
+        box.max_corner[d] = std::max(box.min_corner[d], std::min(lhs.max_corner[d], rhs.max_corner[d]));
+    }
+    return box;
+}
+
+template <
+    std::size_t Dim
+>
+bool operator== (Box<Dim> const& lhs, Box<Dim> const& rhs) noexcept
+{
+    return lhs.min_corner == rhs.min_corner && lhs.max_corner == rhs.max_corner;
+}
+
+template <
+    std::size_t Dim
+>
+std::ostream & operator<< (std::ostream & out, Box<Dim> const& box)
+{
+    out << "Box{";
+    for (std::size_t d = 0; d < Dim; ++d)
+        out << box.interval(d) << ((d < Dim - 1) ? "x" : "");
+    out << "}";
+    return out;
+}
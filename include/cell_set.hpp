@@ -0,0 +1,670 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory_resource>
+#include <ostream>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "interval.hpp"
+#include "box.hpp"
+#include "parallel.hpp"
+#include "arena.hpp"
+#include "instrumentation.hpp"
+
+namespace details
+{
+    /// Ordering of the rows: last direction varies slowest (same as the storage order of a Box)
+    template <std::size_t N>
+    constexpr bool row_less(std::array<std::ptrdiff_t, N> const& lhs, std::array<std::ptrdiff_t, N> const& rhs) noexcept
+    {
+        for (std::size_t d = N; d-- > 0;)
+            if (lhs[d] != rhs[d])
+                return lhs[d] < rhs[d];
+        return false;
+    }
+}
+
+/**
+ * Set of cells at a given level, stored as sorted lists of intervals per row
+ *
+ * A row is the set of cells sharing the same indices along directions 1...Dim-1 (as in Samurai's CellInterval).
+ * Rows are sorted with the last direction varying slowest and the intervals of row r are
+ * intervals[row_offsets[r]] ... intervals[row_offsets[r + 1] - 1], sorted, disjoint and not adjacent.
+ * Only the indices are stored: the topology of the cells is given by the context (eg the field storage).
+ *
+ * Storage uses polymorphic allocators: by default, a set is allocated from the resource of the current
+ * thread (see details::CellSetArena), a copy-constructed set from the global default resource and a move-constructed
+ * set keeps the resource of the moved set.
+ *
+ * @tparam Dim  Dimension of the space
+ */
+template <
+    std::size_t Dim
+>
+struct CellSet
+{
+    static_assert(Dim > 0, "CellSet cannot be of dimension 0");
+
+    using row_indices_type = std::array<std::ptrdiff_t, Dim - 1>;
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    std::size_t level = 0;
+    std::pmr::vector<row_indices_type> rows;
+    std::pmr::vector<std::size_t> row_offsets;
+    std::pmr::vector<Interval> intervals;
+
+    CellSet() : CellSet(0) {}
+
+    explicit CellSet(std::size_t l, allocator_type alloc = details::thread_resource())
+        : level(l)
+        , rows(alloc)
+        , row_offsets(1, 0, alloc)
+        , intervals(alloc)
+    {
+    }
+
+    allocator_type get_allocator() const noexcept { return intervals.get_allocator(); }
+
+    /// Cells of a box
+    static CellSet from_box(std::size_t level, Box<Dim> const& box)
+    {
+        CellSet set(level);
+        for (std::size_t r = 0; r < box.row_count(); ++r)
+            set.push_back(box.row_indices(r), box.interval(0));
+        return set;
+    }
+
+    /// Dimension of the space
+    static constexpr std::size_t dimension() noexcept { return Dim; }
+
+    std::size_t row_count() const noexcept { return rows.size(); }
+    std::size_t interval_count() const noexcept { return intervals.size(); }
+    bool empty() const noexcept { return intervals.empty(); }
+
+    /// Number of cells
+    std::size_t size() const noexcept
+    {
+        std::size_t s = 0;
+        for (auto const& i : intervals)
+            s += cell_count(i);
+        return s;
+    }
+
+    /// Intervals of the r-th row as a [begin, end[ pair of pointers
+    std::pair<Interval const*, Interval const*> row_intervals(std::size_t r) const noexcept
+    {
+        return {intervals.data() + row_offsets[r], intervals.data() + row_offsets[r + 1]};
+    }
+
+    /// Index of the row of given outer indices (row_count() if not found)
+    std::size_t find_row(row_indices_type const& row) const noexcept
+    {
+        auto it = std::lower_bound(rows.begin(), rows.end(), row, details::row_less<Dim - 1>);
+        return (it != rows.end() && *it == row) ? static_cast<std::size_t>(it - rows.begin()) : rows.size();
+    }
+
+    /// True if the cell of given indices belongs to the set
+    bool contains(std::array<std::ptrdiff_t, Dim> const& indices) const noexcept
+    {
+        row_indices_type row;
+        std::copy(indices.begin() + 1, indices.end(), row.begin());
+        std::size_t const r = find_row(row);
+        if (r == rows.size())
+            return false;
+
+        auto [first, last] = row_intervals(r);
+        auto it = std::upper_bound(first, last, indices[0], [] (std::ptrdiff_t i, Interval const& interval) { return i < interval.b; });
+        return it != last && it->a <= indices[0];
+    }
+
+    /**
+     * Append an interval
+     *
+     * @pre the row is not before the last row and, in the same row, the interval doesn't start before the last interval ends.
+     *      Overlapping or adjacent intervals are merged.
+     */
+    void push_back(row_indices_type const& row, Interval const& interval)
+    {
+        if (interval.b <= interval.a)
+            return;
+
+        if (rows.empty() || rows.back() != row)
+        {
+            rows.push_back(row);
+            row_offsets.push_back(row_offsets.back());
+        }
+        else if (interval.a <= intervals.back().b)
+        {
+            intervals.back().b = std::max(intervals.back().b, interval.b);
+            return;
+        }
+
+        intervals.push_back({interval.a, interval.b});
+        ++row_offsets.back();
+    }
+
+    /// Remove all the cells (the level is kept)
+    void clear() noexcept
+    {
+        rows.clear();
+        row_offsets.assign(1, 0);
+        intervals.clear();
+    }
+
+    /// Call fn(level, interval, outer_indices...) for each interval
+    template <typename Function>
+    void for_each_interval(Function && fn) const
+    {
+        for (std::size_t r = 0; r < rows.size(); ++r)
+            for (std::size_t k = row_offsets[r]; k < row_offsets[r + 1]; ++k)
+                std::apply(
+                    [&] (auto... outer) { fn(level, intervals[k], outer...); },
+                    rows[r]
+                );
+    }
+};
+
+template <
+    std::size_t Dim
+>
+bool operator== (CellSet<Dim> const& lhs, CellSet<Dim> const& rhs) noexcept
+{
+    return lhs.level == rhs.level
+        && lhs.rows == rhs.rows
+        && lhs.row_offsets == rhs.row_offsets
+        && std::equal(lhs.intervals.begin(), lhs.intervals.end(), rhs.intervals.begin(), rhs.intervals.end(),
+                      [] (Interval const& a, Interval const& b) { return a.a == b.a && a.b == b.b; });
+}
+
+template <
+    std::size_t Dim
+>
+bool operator!= (CellSet<Dim> const& lhs, CellSet<Dim> const& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+template <
+    std::size_t Dim
+>
+std::ostream & operator<< (std::ostream & out, CellSet<Dim> const& set)
+{
+    out << "CellSet(level=" << set.level << "){";
+    for (std::size_t r = 0; r < set.row_count(); ++r)
+    {
+        out << (r > 0 ? ", " : "") << "(";
+        for (std::size_t d = 0; d < Dim - 1; ++d)
+            out << set.rows[r][d] << ((d < Dim - 2) ? "," : "");
+        out << "):";
+        for (std::size_t k = set.row_offsets[r]; k < set.row_offsets[r + 1]; ++k)
+            out << set.intervals[k];
+    }
+    out << "}";
+    return out;
+}
+
+/// Smallest box containing the cells of the set (empty box for an empty set)
+template <
+    std::size_t Dim
+>
+Box<Dim> bounding_box(CellSet<Dim> const& set) noexcept
+{
+    Box<Dim> box;
+    if (set.empty())
+        return box;
+
+    box.min_corner[0] = set.intervals.front().a;
+    box.max_corner[0] = set.intervals.front().b;
+    for (std::size_t r = 0; r < set.row_count(); ++r)
+    {
+        box.min_corner[0] = std::min(box.min_corner[0], set.intervals[set.row_offsets[r]].a);
+        box.max_corner[0] = std::max(box.max_corner[0], set.intervals[set.row_offsets[r + 1] - 1].b);
+    }
+    for (std::size_t d = 1; d < Dim; ++d)
+    {
+        box.min_corner[d] = set.rows.front()[d - 1];
+        box.max_corner[d] = set.rows.front()[d - 1] + 1;
+        for (auto const& row : set.rows)
+        {
+            box.min_corner[d] = std::min(box.min_corner[d], row[d - 1]);
+            box.max_corner[d] = std::max(box.max_corner[d], row[d - 1] + 1);
+        }
+    }
+    return box;
+}
+
+namespace details
+{
+    /// Portion of the intervals of a CellSet containing about the same number of cells as the other chunks
+    struct IntervalChunk
+    {
+        std::size_t first_interval; ///< First interval (partially) included
+        std::size_t first_cell;     ///< Cells skipped in the first interval
+        std::size_t cells;          ///< Number of cells
+    };
+
+    template <std::size_t Dim>
+    std::vector<IntervalChunk> make_interval_chunks(CellSet<Dim> const& set, std::size_t grain)
+    {
+        std::vector<IntervalChunk> chunks;
+        IntervalChunk current{0, 0, 0};
+        for (std::size_t k = 0; k < set.intervals.size(); ++k)
+        {
+            std::size_t remaining = cell_count(set.intervals[k]);
+            std::size_t offset = 0;
+            while (remaining > 0)
+            {
+                if (current.cells == 0)
+                    current = {k, offset, 0};
+                std::size_t const n = std::min(remaining, grain - current.cells);
+                current.cells += n;
+                offset += n;
+                remaining -= n;
+                if (current.cells == grain)
+                {
+                    chunks.push_back(current);
+                    current.cells = 0;
+                }
+            }
+        }
+        if (current.cells > 0)
+            chunks.push_back(current);
+        return chunks;
+    }
+}
+
+/**
+ * Call fn(level, interval, outer_indices...) on the cells of the set, in parallel
+ *
+ * The intervals are cut in chunks of grain cells (a long interval being split between several chunks)
+ * so that the work is balanced in number of cells and not in number of intervals.
+ * The chunks are scheduled with work stealing (see work_stealing_for).
+ *
+ * @param grain     Number of cells per chunk (0 to get about 16 chunks per thread)
+ */
+template <
+    std::size_t Dim,
+    typename Function
+>
+void parallel_for_each_interval(CellSet<Dim> const& set, Function && fn, std::size_t grain = 0, std::size_t n_threads = default_thread_count())
+{
+    if (grain == 0)
+        grain = std::max<std::size_t>(64, set.size() / (16 * std::max<std::size_t>(1, n_threads)));
+
+    // Row of each interval
+    std::vector<std::size_t> interval_rows(set.intervals.size());
+    for (std::size_t r = 0; r < set.row_count(); ++r)
+        std::fill(interval_rows.begin() + static_cast<std::ptrdiff_t>(set.row_offsets[r]), interval_rows.begin() + static_cast<std::ptrdiff_t>(set.row_offsets[r + 1]), r);
+
+    auto const chunks = details::make_interval_chunks(set, grain);
+    work_stealing_for(chunks.size(),
+        [&] (std::size_t c)
+        {
+            std::size_t k = chunks[c].first_interval;
+            std::size_t skip = chunks[c].first_cell;
+            std::size_t remaining = chunks[c].cells;
+            for (; remaining > 0; ++k, skip = 0)
+            {
+                Interval const& interval = set.intervals[k];
+                std::size_t const n = std::min(remaining, cell_count(interval) - skip);
+                Interval const part{interval.a + static_cast<std::ptrdiff_t>(skip), interval.a + static_cast<std::ptrdiff_t>(skip + n)};
+                remaining -= n;
+                std::apply(
+                    [&] (auto... outer) { fn(set.level, part, outer...); },
+                    set.rows[interval_rows[k]]
+                );
+            }
+        },
+        n_threads
+    );
+}
+
+/**
+ * Apply a stencil on the cells of the set, in parallel
+ *
+ * For each (portion of) interval, stencil.shift(fn, level, interval, outer_indices...) is called,
+ * ie fn is called with the level and indices shifted by each cell of the stencil (see KCells::shift).
+ * Chunking and scheduling are the same as the overload without stencil.
+ */
+template <
+    std::size_t Dim,
+    typename Stencil,
+    typename Function,
+    typename = std::void_t<decltype(Stencil::kcell_size())> // Avoid conflict with the overload without stencil
+>
+void parallel_for_each_interval(CellSet<Dim> const& set, Stencil stencil, Function && fn, std::size_t grain = 0, std::size_t n_threads = default_thread_count())
+{
+    static_assert(Stencil::kcell_size() == Dim, "Dimension mismatch between the stencil and the cell set");
+    parallel_for_each_interval(set,
+        [&fn, stencil] (std::size_t level, Interval const& interval, auto... outer)
+        {
+            KSPACE_COUNT(StencilDriver, Stencil, Stencil::size() * cell_count(interval), cell_count(interval), 0);
+            stencil.shift(fn, level, interval, outer...);
+        },
+        grain,
+        n_threads
+    );
+}
+
+namespace details
+{
+    /// Union of two sorted interval lists, appended to the given row of the result (a CellSet or any type with the same push_back)
+    template <std::size_t Dim, typename Result = CellSet<Dim>>
+    void row_union(Interval const* lhs, Interval const* lhs_end, Interval const* rhs, Interval const* rhs_end, Result & result, typename CellSet<Dim>::row_indices_type const& row)
+    {
+        while (lhs != lhs_end || rhs != rhs_end)
+        {
+            if (rhs == rhs_end || (lhs != lhs_end && lhs->a <= rhs->a))
+                result.push_back(row, *lhs++);
+            else
+                result.push_back(row, *rhs++);
+        }
+    }
+
+    /// Intersection of two sorted interval lists, appended to the given row of the result
+    template <std::size_t Dim, typename Result = CellSet<Dim>>
+    void row_intersection(Interval const* lhs, Interval const* lhs_end, Interval const* rhs, Interval const* rhs_end, Result & result, typename CellSet<Dim>::row_indices_type const& row)
+    {
+        while (lhs != lhs_end && rhs != rhs_end)
+        {
+            result.push_back(row, {std::max(lhs->a, rhs->a), std::min(lhs->b, rhs->b)});
+            if (lhs->b < rhs->b)
+                ++lhs;
+            else
+                ++rhs;
+        }
+    }
+
+    /// Difference of two sorted interval lists, appended to the given row of the result
+    template <std::size_t Dim, typename Result = CellSet<Dim>>
+    void row_difference(Interval const* lhs, Interval const* lhs_end, Interval const* rhs, Interval const* rhs_end, Result & result, typename CellSet<Dim>::row_indices_type const& row)
+    {
+        for (; lhs != lhs_end; ++lhs)
+        {
+            std::ptrdiff_t a = lhs->a;
+            while (rhs != rhs_end && rhs->b <= a)
+                ++rhs;
+            for (auto it = rhs; it != rhs_end && it->a < lhs->b; ++it)
+            {
+                result.push_back(row, {a, it->a});
+                a = std::max(a, it->b);
+            }
+            result.push_back(row, {a, lhs->b});
+        }
+    }
+
+    /** Apply a row operation to each row of lhs and/or rhs (in row order)
+     *
+     *  @param keep_lhs_only    true if the rows present only in lhs are processed
+     *  @param keep_rhs_only    true if the rows present only in rhs are processed
+     */
+    template <
+        std::size_t Dim,
+        typename RowOperation
+    >
+    CellSet<Dim> merge_rows(CellSet<Dim> const& lhs, CellSet<Dim> const& rhs, RowOperation && op, bool keep_lhs_only, bool keep_rhs_only)
+    {
+        assert(lhs.level == rhs.level && "Cell sets must be at the same level");
+        CellSet<Dim> result(lhs.level);
+        Interval const* none = nullptr;
+
+        std::size_t l = 0, r = 0;
+        while (l < lhs.row_count() || r < rhs.row_count())
+        {
+            if (r == rhs.row_count() || (l < lhs.row_count() && row_less(lhs.rows[l], rhs.rows[r])))
+            {
+                if (keep_lhs_only)
+                {
+                    auto [first, last] = lhs.row_intervals(l);
+                    op(first, last, none, none, result, lhs.rows[l]);
+                }
+                ++l;
+            }
+            else if (l == lhs.row_count() || row_less(rhs.rows[r], lhs.rows[l]))
+            {
+                if (keep_rhs_only)
+                {
+                    auto [first, last] = rhs.row_intervals(r);
+                    op(none, none, first, last, result, rhs.rows[r]);
+                }
+                ++r;
+            }
+            else
+            {
+                auto [lhs_first, lhs_last] = lhs.row_intervals(l);
+                auto [rhs_first, rhs_last] = rhs.row_intervals(r);
+                op(lhs_first, lhs_last, rhs_first, rhs_last, result, lhs.rows[l]);
+                ++l;
+                ++r;
+            }
+        }
+        return result;
+    }
+}
+
+/// Cells belonging to lhs or rhs (same level)
+template <std::size_t Dim>
+CellSet<Dim> set_union(CellSet<Dim> const& lhs, CellSet<Dim> const& rhs)
+{
+    return details::merge_rows(lhs, rhs, details::row_union<Dim>, true, true);
+}
+
+/// Cells belonging to lhs and rhs (same level)
+template <std::size_t Dim>
+CellSet<Dim> set_intersection(CellSet<Dim> const& lhs, CellSet<Dim> const& rhs)
+{
+    return details::merge_rows(lhs, rhs, details::row_intersection<Dim>, false, false);
+}
+
+/// Cells belonging to lhs but not to rhs (same level)
+template <std::size_t Dim>
+CellSet<Dim> set_difference(CellSet<Dim> const& lhs, CellSet<Dim> const& rhs)
+{
+    return details::merge_rows(lhs, rhs, details::row_difference<Dim>, true, false);
+}
+
+/// Cells of the set translated by the given index shift
+template <std::size_t Dim>
+CellSet<Dim> translate(CellSet<Dim> const& set, std::array<std::ptrdiff_t, Dim> const& shift)
+{
+    CellSet<Dim> result(set.level);
+    result.rows = set.rows;
+    result.row_offsets = set.row_offsets;
+    result.intervals = set.intervals;
+    for (auto & row : result.rows)
+        for (std::size_t d = 1; d < Dim; ++d)
+            row[d - 1] += shift[d];
+    for (auto & interval : result.intervals)
+        interval += shift[0];
+    return result;
+}
+
+namespace details
+{
+    /// Boundaries of the blocks of consecutive rows sharing the same last index once coarsened by levels (one block in 1D)
+    template <std::size_t Dim>
+    std::vector<std::size_t> row_blocks(CellSet<Dim> const& set, std::size_t levels)
+    {
+        std::vector<std::size_t> blocks{0};
+        if constexpr (Dim > 1)
+        {
+            for (std::size_t r = 1; r < set.row_count(); ++r)
+                if ((set.rows[r][Dim - 2] >> levels) != (set.rows[r - 1][Dim - 2] >> levels))
+                    blocks.push_back(r);
+        }
+        if (set.row_count() > 0)
+            blocks.push_back(set.row_count());
+        return blocks;
+    }
+
+    /// Append the rows of a set to another one (the rows must come after the last row of the result)
+    template <std::size_t Dim>
+    void append_rows(CellSet<Dim> & result, CellSet<Dim> const& other)
+    {
+        std::size_t const offset = result.intervals.size();
+        result.rows.insert(result.rows.end(), other.rows.begin(), other.rows.end());
+        for (std::size_t r = 1; r < other.row_offsets.size(); ++r)
+            result.row_offsets.push_back(other.row_offsets[r] + offset);
+        result.intervals.insert(result.intervals.end(), other.intervals.begin(), other.intervals.end());
+    }
+
+    /// n empty sets of given level allocated from the resource of the current thread (copies would use the default resource)
+    template <std::size_t Dim>
+    std::vector<CellSet<Dim>> make_sets(std::size_t n, std::size_t level)
+    {
+        std::vector<CellSet<Dim>> sets;
+        sets.reserve(n);
+        for (std::size_t k = 0; k < n; ++k)
+            sets.emplace_back(level);
+        return sets;
+    }
+
+    /// Apply a function to each block of rows in parallel and concatenate the resulting sets
+    template <
+        std::size_t Dim,
+        typename Function
+    >
+    CellSet<Dim> concatenate_blocks(std::size_t level, std::vector<std::size_t> const& blocks, Function && fn, std::size_t n_threads)
+    {
+        auto parts = make_sets<Dim>(blocks.size() > 0 ? blocks.size() - 1 : 0, level);
+        parallel_for(0, parts.size(), [&] (std::size_t b) { fn(blocks[b], blocks[b + 1], parts[b]); }, n_threads);
+
+        CellSet<Dim> result(level);
+        for (auto const& part : parts)
+            append_rows(result, part);
+        return result;
+    }
+
+    /** Coarsen the rows [first, last[ that share the same coarsened last index
+     *
+     *  Once coarsened, the rows form a few sorted runs (one per fine index along the outer directions)
+     *  that are merged, as are the intervals of the rows mapped to the same coarse row.
+     */
+    template <std::size_t Dim>
+    void coarsen_block(CellSet<Dim> const& set, std::size_t first, std::size_t last, std::size_t levels, CellSet<Dim> & result)
+    {
+        using row_type = typename CellSet<Dim>::row_indices_type;
+        auto coarse_row = [&set, levels] (std::size_t r)
+        {
+            row_type row = set.rows[r];
+            for (auto & i : row)
+                i >>= levels;
+            return row;
+        };
+
+        // Runs of rows whose coarsened indices are sorted
+        std::pmr::vector<std::pair<std::size_t, std::size_t>> runs(details::thread_resource());
+        for (std::size_t r = first; r < last; ++r)
+            if (r == first || row_less(coarse_row(r), coarse_row(r - 1)))
+                runs.push_back({r, r + 1});
+            else
+                runs.back().second = r + 1;
+
+        std::pmr::vector<std::pair<Interval const*, Interval const*>> sources(details::thread_resource());
+        while (true)
+        {
+            // Smallest coarse row among the runs
+            bool found = false;
+            row_type row{};
+            for (auto const& run : runs)
+                if (run.first < run.second && (!found || row_less(coarse_row(run.first), row)))
+                {
+                    row = coarse_row(run.first);
+                    found = true;
+                }
+            if (!found)
+                return;
+
+            // Rows mapped to this coarse row
+            sources.clear();
+            for (auto & run : runs)
+                for (; run.first < run.second && coarse_row(run.first) == row; ++run.first)
+                    sources.push_back(set.row_intervals(run.first));
+
+            // Merge of the sorted coarsened interval lists
+            while (true)
+            {
+                std::size_t best = sources.size();
+                for (std::size_t s = 0; s < sources.size(); ++s)
+                    if (sources[s].first != sources[s].second && (best == sources.size() || sources[s].first->a < sources[best].first->a))
+                        best = s;
+                if (best == sources.size())
+                    break;
+
+                Interval const& i = *sources[best].first++;
+                result.push_back(row, {i.a >> levels, ((i.b - 1) >> levels) + 1});
+            }
+        }
+    }
+
+    /// Refine the rows [first, last[ that share the same indices along the directions greater than d
+    template <std::size_t Dim>
+    void refine_block(CellSet<Dim> const& set, std::size_t first, std::size_t last, std::size_t d, std::size_t levels, typename CellSet<Dim>::row_indices_type & row, CellSet<Dim> & result)
+    {
+        auto const ratio = std::ptrdiff_t(1) << levels;
+        if (d == 0)
+        {
+            for (std::size_t k = set.row_offsets[first]; k < set.row_offsets[first + 1]; ++k)
+                result.push_back(row, {set.intervals[k].a * ratio, set.intervals[k].b * ratio});
+            return;
+        }
+
+        while (first < last)
+        {
+            std::ptrdiff_t const index = set.rows[first][d - 1];
+            std::size_t sub_last = first + 1;
+            while (sub_last < last && set.rows[sub_last][d - 1] == index)
+                ++sub_last;
+
+            for (std::ptrdiff_t c = 0; c < ratio; ++c)
+            {
+                row[d - 1] = index * ratio + c;
+                refine_block(set, first, sub_last, d - 1, levels, row, result);
+            }
+            first = sub_last;
+        }
+    }
+}
+
+/**
+ * Cells of level (set.level - levels) containing at least one cell of the set (see KCellND::down())
+ *
+ * As down(), this is the same operation for every topology.
+ * Rows are merged (and duplicated parents removed) by sorted merges, without sorting,
+ * and blocks of rows with different coarse last index are processed in parallel.
+ */
+template <std::size_t Dim>
+CellSet<Dim> coarsen(CellSet<Dim> const& set, std::size_t levels = 1, std::size_t n_threads = default_thread_count())
+{
+    assert(set.level >= levels && "Cannot coarsen below level 0");
+    return details::concatenate_blocks<Dim>(set.level - levels, details::row_blocks(set, levels),
+        [&set, levels] (std::size_t first, std::size_t last, CellSet<Dim> & result) { details::coarsen_block(set, first, last, levels, result); },
+        n_threads
+    );
+}
+
+/**
+ * Cells of level (set.level + levels) contained in the cells of the set (see KCellND::up())
+ *
+ * As up(), this is the same operation for every topology.
+ * The children rows are generated directly in order and blocks of rows with different last index
+ * are processed in parallel.
+ */
+template <std::size_t Dim>
+CellSet<Dim> refine(CellSet<Dim> const& set, std::size_t levels = 1, std::size_t n_threads = default_thread_count())
+{
+    return details::concatenate_blocks<Dim>(set.level + levels, details::row_blocks(set, 0),
+        [&set, levels] (std::size_t first, std::size_t last, CellSet<Dim> & result)
+        {
+            typename CellSet<Dim>::row_indices_type row{};
+            details::refine_block(set, first, last, Dim - 1, levels, row, result);
+        },
+        n_threads
+    );
+}
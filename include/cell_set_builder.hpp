@@ -0,0 +1,188 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "interval.hpp"
+#include "box.hpp"
+#include "cell_set.hpp"
+#include "packed_key.hpp"
+#include "parallel.hpp"
+
+namespace details
+{
+    /// Index of the lowest set bit (x must not be 0)
+    inline std::size_t count_trailing_zeros(std::uint64_t x) noexcept
+    {
+#if defined(__GNUC__)
+        return static_cast<std::size_t>(__builtin_ctzll(x));
+#else
+        std::size_t n = 0;
+        for (; (x & 1) == 0; x >>= 1)
+            ++n;
+        return n;
+#endif
+    }
+}
+
+/**
+ * Concurrent builder of a CellSet, as an atomic bitmap over a bounding box
+ *
+ * Cells (indices, packed keys or interval fragments) can be inserted from any thread
+ * without lock (relaxed fetch_or on the words of the bitmap). Each row of the box is padded
+ * to a whole number of words so that finalize() extracts the intervals row by row, in parallel,
+ * directly in the sorted order of a CellSet.
+ *
+ * @warning finalize() must be called once all the insertions are done and synchronized (eg threads joined).
+ *
+ * @tparam Dim  Dimension of the space
+ */
+template <
+    std::size_t Dim
+>
+class ConcurrentCellSetBuilder
+{
+public:
+    using word_type = std::uint64_t;
+    using indices_type = typename Box<Dim>::indices_type;
+    using row_indices_type = typename CellSet<Dim>::row_indices_type;
+
+    static constexpr std::size_t word_bits() noexcept { return 64; }
+
+    ConcurrentCellSetBuilder(std::size_t level, Box<Dim> const& box)
+        : m_level(level)
+        , m_box(box)
+        , m_words_per_row((box.shape(0) + word_bits() - 1) / word_bits())
+        , m_size(m_words_per_row * box.row_count())
+        , m_bits(new std::atomic<word_type>[m_size])
+    {
+        clear();
+    }
+
+    std::size_t level() const noexcept { return m_level; }
+    Box<Dim> const& box() const noexcept { return m_box; }
+
+    /// Mark a cell, returns true if it was not already marked
+    bool insert(indices_type const& indices) noexcept
+    {
+        assert(m_box.contains(indices) && "Cell outside of the builder box");
+        std::size_t const bit = static_cast<std::size_t>(indices[0] - m_box.min_corner[0]);
+        word_type const mask = word_type(1) << (bit % word_bits());
+        auto & word = m_bits[row_number(row_of(indices)) * m_words_per_row + bit / word_bits()];
+        return (word.fetch_or(mask, std::memory_order_relaxed) & mask) == 0;
+    }
+
+    /// Mark a cell given by its packed key (at the builder level)
+    template <typename Word>
+    bool insert(PackedKCellKey<Dim, Word> const& key) noexcept
+    {
+        assert(key.level() == m_level && "Packed key of another level");
+        return insert(key.indices());
+    }
+
+    /// Mark an interval fragment of a row
+    void insert(row_indices_type const& row, Interval const& interval) noexcept
+    {
+        if (interval.b <= interval.a)
+            return;
+        assert(interval.a >= m_box.min_corner[0] && interval.b <= m_box.max_corner[0] && "Interval outside of the builder box");
+
+        auto * const words = m_bits.get() + row_number(row) * m_words_per_row;
+        std::size_t const first = static_cast<std::size_t>(interval.a - m_box.min_corner[0]);
+        std::size_t const last = static_cast<std::size_t>(interval.b - m_box.min_corner[0]);
+        for (std::size_t w = first / word_bits(); w * word_bits() < last; ++w)
+        {
+            std::size_t const lo = std::max(first, w * word_bits()) - w * word_bits();
+            std::size_t const hi = std::min(last, (w + 1) * word_bits()) - w * word_bits();
+            word_type const mask = (hi == word_bits() ? ~word_type(0) : ((word_type(1) << hi) - 1)) & ~((word_type(1) << lo) - 1);
+            words[w].fetch_or(mask, std::memory_order_relaxed);
+        }
+    }
+
+    /// Unmark all the cells
+    void clear() noexcept
+    {
+        for (std::size_t w = 0; w < m_size; ++w)
+            m_bits[w].store(0, std::memory_order_relaxed);
+    }
+
+    /// Sorted interval lists of the marked cells (rows are processed in parallel)
+    CellSet<Dim> finalize(std::size_t n_threads = default_thread_count()) const
+    {
+        std::size_t const n_rows = m_box.row_count();
+        std::size_t const n_blocks = std::min(n_rows, 4 * std::max<std::size_t>(n_threads, 1));
+        std::vector<std::size_t> blocks;
+        for (std::size_t b = 0; b <= n_blocks; ++b)
+            blocks.push_back(b * n_rows / std::max<std::size_t>(n_blocks, 1));
+
+        return details::concatenate_blocks<Dim>(m_level, blocks,
+            [this] (std::size_t first, std::size_t last, CellSet<Dim> & part)
+            {
+                for (std::size_t r = first; r < last; ++r)
+                    extract_row(r, part);
+            },
+            n_threads
+        );
+    }
+
+private:
+    static row_indices_type row_of(indices_type const& indices) noexcept
+    {
+        row_indices_type row{};
+        for (std::size_t d = 1; d < Dim; ++d)
+            row[d - 1] = indices[d];
+        return row;
+    }
+
+    /// Position of a row in the box enumeration (direction 1 varies fastest)
+    std::size_t row_number(row_indices_type const& row) const noexcept
+    {
+        std::size_t r = 0;
+        for (std::size_t d = Dim; d-- > 1;)
+        {
+            assert(row[d - 1] >= m_box.min_corner[d] && row[d - 1] < m_box.max_corner[d] && "Row outside of the builder box");
+            r = r * m_box.shape(d) + static_cast<std::size_t>(row[d - 1] - m_box.min_corner[d]);
+        }
+        return r;
+    }
+
+    /// Append the runs of marked cells of the r-th row
+    void extract_row(std::size_t r, CellSet<Dim> & result) const
+    {
+        auto const row = m_box.row_indices(r);
+        auto const * const words = m_bits.get() + r * m_words_per_row;
+        bool open = false;
+        std::ptrdiff_t start = 0;
+        for (std::size_t w = 0; w < m_words_per_row; ++w)
+        {
+            word_type const bits = words[w].load(std::memory_order_relaxed);
+            std::ptrdiff_t const base = m_box.min_corner[0] + static_cast<std::ptrdiff_t>(w * word_bits());
+            std::size_t bit = 0;
+            while (bit < word_bits())
+            {
+                word_type const rest = (open ? ~bits : bits) >> bit;
+                if (rest == 0)
+                    break;
+                bit += details::count_trailing_zeros(rest);
+                if (open)
+                    result.push_back(row, {start, base + static_cast<std::ptrdiff_t>(bit)});
+                else
+                    start = base + static_cast<std::ptrdiff_t>(bit);
+                open = !open;
+            }
+        }
+        if (open)
+            result.push_back(row, {start, m_box.max_corner[0]});
+    }
+
+    std::size_t m_level;
+    Box<Dim> m_box;
+    std::size_t m_words_per_row;
+    std::size_t m_size;
+    std::unique_ptr<std::atomic<word_type>[]> m_bits;
+};
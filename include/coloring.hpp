@@ -0,0 +1,247 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "parallel.hpp"
+
+namespace details
+{
+    /// Index shift of a KCell or KCellND as an array
+    template <typename Cell>
+    constexpr auto index_shift_array() noexcept
+    {
+        if constexpr (std::is_same_v<std::decay_t<decltype(Cell::indexShift())>, std::ptrdiff_t>)
+            return std::array<std::ptrdiff_t, 1>{Cell::indexShift()};
+        else
+            return Cell::indexShift();
+    }
+
+    /// True if the given stencil entry doesn't share its colour with the center cell
+    template <
+        typename Coloring,
+        typename Center,
+        typename Cell
+    >
+    constexpr bool is_separated() noexcept
+    {
+        if constexpr (Cell::topology() != Center::topology() || Cell::levelShift() != Center::levelShift())
+            return true; // Not the same unknowns: no coupling
+        else
+        {
+            constexpr auto center_shift = index_shift_array<Center>();
+            auto shift = index_shift_array<Cell>();
+            bool is_center = true;
+            for (std::size_t d = 0; d < shift.size(); ++d)
+            {
+                shift[d] -= center_shift[d];
+                is_center = is_center && shift[d] == 0;
+            }
+            return is_center || Coloring::separates(shift);
+        }
+    }
+
+    /// First index of [a, b[ that has the given parity
+    constexpr std::ptrdiff_t first_with_parity(std::ptrdiff_t a, std::ptrdiff_t parity) noexcept
+    {
+        return a + (((parity - a) % 2) + 2) % 2;
+    }
+}
+
+/**
+ * Colouring from the parity of the cell index along each direction
+ *
+ * Two cells share the same colour iff their index difference is even along every direction,
+ * so that any stencil of radius 1 (including corners) is correctly separated, using 2^Dim colours.
+ */
+template <
+    std::size_t Dim
+>
+struct ParityColoring
+{
+    using indices_type = std::array<std::ptrdiff_t, Dim>;
+    using row_indices_type = std::array<std::ptrdiff_t, Dim - 1>;
+
+    /// Number of colours
+    static constexpr std::size_t size() noexcept { return std::size_t(1) << Dim; }
+
+    /// Colour of the cell of given indices
+    static constexpr std::size_t color(indices_type const& indices) noexcept
+    {
+        std::size_t c = 0;
+        for (std::size_t d = 0; d < Dim; ++d)
+            c |= static_cast<std::size_t>(indices[d] & 1) << d;
+        return c;
+    }
+
+    /// True if two cells separated by the given index shift have different colours
+    static constexpr bool separates(indices_type const& shift) noexcept
+    {
+        for (std::size_t d = 0; d < Dim; ++d)
+            if ((shift[d] & 1) != 0)
+                return true;
+        return false;
+    }
+
+    /// Parity of the first index of the cells of given colour in the given row (-1 if the row has no such cell)
+    static constexpr std::ptrdiff_t row_parity(std::size_t c, row_indices_type const& row) noexcept
+    {
+        for (std::size_t d = 1; d < Dim; ++d)
+            if (static_cast<std::size_t>(row[d - 1] & 1) != ((c >> d) & 1))
+                return -1;
+        return static_cast<std::ptrdiff_t>(c & 1);
+    }
+};
+
+/**
+ * Red-black colouring from the parity of the sum of the cell indices
+ *
+ * Two cells share the same colour iff the sum of their index difference is even,
+ * which is enough for star-shaped stencils of radius 1 (eg KCellND::neighborhood()).
+ */
+template <
+    std::size_t Dim
+>
+struct RedBlackColoring
+{
+    using indices_type = std::array<std::ptrdiff_t, Dim>;
+    using row_indices_type = std::array<std::ptrdiff_t, Dim - 1>;
+
+    /// Number of colours
+    static constexpr std::size_t size() noexcept { return 2; }
+
+    /// Colour of the cell of given indices
+    static constexpr std::size_t color(indices_type const& indices) noexcept
+    {
+        std::ptrdiff_t s = 0;
+        for (std::size_t d = 0; d < Dim; ++d)
+            s += indices[d];
+        return static_cast<std::size_t>(s & 1);
+    }
+
+    /// True if two cells separated by the given index shift have different colours
+    static constexpr bool separates(indices_type const& shift) noexcept
+    {
+        return color(shift) != 0;
+    }
+
+    /// Parity of the first index of the cells of given colour in the given row
+    static constexpr std::ptrdiff_t row_parity(std::size_t c, row_indices_type const& row) noexcept
+    {
+        std::ptrdiff_t s = static_cast<std::ptrdiff_t>(c);
+        for (std::size_t d = 1; d < Dim; ++d)
+            s -= row[d - 1];
+        return s & 1;
+    }
+};
+
+/** True if no entry of the stencil couples the center cell with a cell of same colour
+ *
+ * Only entries with the same topology and level as the center cell are considered
+ * since the other ones refer to different unknowns.
+ */
+template <
+    typename Coloring,
+    typename Center,
+    typename Stencil
+>
+constexpr bool is_valid_coloring() noexcept
+{
+    return Stencil::apply(
+        [] (auto... cell) { return (details::is_separated<Coloring, Center, decltype(cell)>() && ... && true); }
+    );
+}
+
+/// Coloring with the fewest colours that is valid for the given stencil around the given center cell
+template <
+    typename Center,
+    typename Stencil
+>
+constexpr auto make_coloring() noexcept
+{
+    constexpr std::size_t dim = Center::size();
+    if constexpr (is_valid_coloring<RedBlackColoring<dim>, Center, Stencil>())
+        return RedBlackColoring<dim>{};
+    else
+    {
+        static_assert(is_valid_coloring<ParityColoring<dim>, Center, Stencil>(), "The stencil couples cells of same parity: no valid colouring");
+        return ParityColoring<dim>{};
+    }
+}
+
+template <
+    typename Center,
+    typename Stencil
+>
+constexpr auto make_coloring(Center, Stencil) noexcept
+{
+    return make_coloring<Center, Stencil>();
+}
+
+/**
+ * Process the cells of a box colour by colour, the rows of a given colour being processed in parallel.
+ *
+ * For each row and colour, fn(level, interval, outer_indices...) is called where interval
+ * is an Interval of step 2 containing the cells of that colour in the row.
+ */
+template <
+    typename Coloring,
+    std::size_t Dim,
+    typename Function
+>
+void multicolor_sweep(Coloring, Box<Dim> const& box, std::size_t level, Function && fn, std::size_t n_threads = default_thread_count())
+{
+    for (std::size_t c = 0; c < Coloring::size(); ++c)
+    {
+        parallel_for(0, box.row_count(),
+            [&] (std::size_t r)
+            {
+                auto const row = box.row_indices(r);
+                std::ptrdiff_t const parity = Coloring::row_parity(c, row);
+                if (parity < 0)
+                    return;
+
+                Interval interval{details::first_with_parity(box.min_corner[0], parity), box.max_corner[0], 2};
+                if (interval.a >= interval.b)
+                    return;
+
+                std::apply(
+                    [&] (auto... outer) { fn(level, interval, outer...); },
+                    row
+                );
+            },
+            n_threads
+        );
+    }
+}
+
+/**
+ * Multicolour Gauss-Seidel like smoother
+ *
+ * The colouring is chosen at compile time from the stencil (red-black if possible, parity colouring otherwise)
+ * and it is checked that the stencil doesn't couple two cells of the same colour.
+ * Each of the n_sweeps sweeps is a multicolor_sweep with the given kernel.
+ *
+ * @param center    Cell on which the unknowns live (its topology and level are used to detect coupling)
+ * @param stencil   Stencil used by the kernel
+ * @param box       Cells to update
+ * @param fn        Kernel called as fn(level, interval, outer_indices...) (see multicolor_sweep)
+ */
+template <
+    typename Center,
+    typename Stencil,
+    std::size_t Dim,
+    typename Function
+>
+void multicolor_smooth(Center center, Stencil stencil, Box<Dim> const& box, std::size_t level, Function && fn, std::size_t n_sweeps = 1, std::size_t n_threads = default_thread_count())
+{
+    static_assert(Center::size() == Dim, "Dimension mismatch between the center cell and the box");
+    auto const coloring = make_coloring(center, stencil);
+    for (std::size_t s = 0; s < n_sweeps; ++s)
+        multicolor_sweep(coloring, box, level, fn, n_threads);
+}
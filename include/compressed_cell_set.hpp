@@ -0,0 +1,431 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "interval.hpp"
+#include "cell_set.hpp"
+#include "parallel.hpp"
+#include "instrumentation.hpp"
+
+namespace details
+{
+    /// Signed to unsigned mapping of small absolute values to small values (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...)
+    constexpr std::uint64_t zigzag_encode(std::ptrdiff_t v) noexcept
+    {
+        return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+    }
+
+    constexpr std::ptrdiff_t zigzag_decode(std::uint64_t u) noexcept
+    {
+        return static_cast<std::ptrdiff_t>(u >> 1) ^ -static_cast<std::ptrdiff_t>(u & 1);
+    }
+
+    /// Append an unsigned integer as a varint (7 bits per byte, the high bit set on all bytes but the last)
+    inline void put_varint(std::vector<std::uint8_t> & out, std::uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            out.push_back(static_cast<std::uint8_t>(v) | 0x80);
+            v >>= 7;
+        }
+        out.push_back(static_cast<std::uint8_t>(v));
+    }
+
+    /// Read a varint and move the pointer after it
+    inline std::uint64_t get_varint(std::uint8_t const*& p) noexcept
+    {
+        if (*p < 0x80) // Fast path: most deltas fit in one byte
+            return *p++;
+
+        std::uint64_t v = 0;
+        for (unsigned shift = 0; ; shift += 7)
+        {
+            std::uint8_t const byte = *p++;
+            v |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (byte < 0x80)
+                return v;
+        }
+    }
+}
+
+template <std::size_t Dim>
+class CompressedCellSetBuilder;
+
+/**
+ * Set of cells at a given level with delta + varint compressed interval lists
+ *
+ * Same content and row order as CellSet, but each row is stored as:
+ *  - the difference of its outer indices with the previous row (zigzag varints),
+ *  - its number of intervals (varint),
+ *  - the start of its first interval relatively to the start of the first interval of the previous row (zigzag varint),
+ *  - for each interval, its length minus one and the gap minus one to the next interval (varints).
+ * Rows of close bounds then take a few bytes instead of 8 * (Dim - 1) + 16 bytes per row and interval.
+ *
+ * The varints are preferred to a frame of reference bit-packing of blocks of values: most values fit in one byte,
+ * which the decoder reads with a single test, while a single large gap widens a whole bit-packed block
+ * (bench_compressed compares both encodings of the same values, in size and decoding time).
+ *
+ * The rows are decoded on the fly, one row at a time (see Cursor). Every block_rows rows, the decoder state
+ * is saved so that the decoding can start at any block (eg to process the blocks in parallel).
+ *
+ * @tparam Dim  Dimension of the space
+ */
+template <
+    std::size_t Dim
+>
+class CompressedCellSet
+{
+public:
+    using row_indices_type = typename CellSet<Dim>::row_indices_type;
+    static constexpr std::size_t block_rows = 64;
+
+    /// Decoder state at the start of a block of rows
+    struct Block
+    {
+        std::size_t offset;             ///< Position in the encoded bytes
+        row_indices_type previous_row;  ///< Outer indices of the previous row
+        std::ptrdiff_t previous_first;  ///< Start of the first interval of the previous row
+    };
+
+    /// Streaming decoder of the rows, starting at a given block
+    class Cursor
+    {
+    public:
+        explicit Cursor(CompressedCellSet const& set, std::size_t block = 0)
+            : m_rows(block < set.m_blocks.size() ? set.row_count() - block * block_rows : 0)
+        {
+            if (m_rows > 0)
+            {
+                auto const& b = set.m_blocks[block];
+                m_data = set.m_bytes.data() + b.offset;
+                m_row = b.previous_row;
+                m_first = b.previous_first;
+            }
+            next();
+        }
+
+        bool valid() const noexcept { return m_valid; }
+
+        row_indices_type const& row() const noexcept { return m_row; }
+        Interval const* begin() const noexcept { return m_intervals.data(); }
+        Interval const* end() const noexcept { return m_intervals.data() + m_intervals.size(); }
+
+        /// Decode the next row
+        void next()
+        {
+            m_valid = m_rows > 0;
+            if (!m_valid)
+                return;
+            --m_rows;
+
+            for (auto & index : m_row)
+                index += details::zigzag_decode(details::get_varint(m_data));
+            auto const n = static_cast<std::size_t>(details::get_varint(m_data));
+            m_first += details::zigzag_decode(details::get_varint(m_data));
+
+            m_intervals.resize(n);
+            std::ptrdiff_t a = m_first;
+            for (std::size_t k = 0; k < n; ++k)
+            {
+                std::ptrdiff_t const b = a + 1 + static_cast<std::ptrdiff_t>(details::get_varint(m_data));
+                m_intervals[k] = {a, b};
+                if (k + 1 < n)
+                    a = b + 1 + static_cast<std::ptrdiff_t>(details::get_varint(m_data));
+            }
+        }
+
+    private:
+        std::uint8_t const* m_data = nullptr;
+        std::size_t m_rows;
+        row_indices_type m_row{};
+        std::ptrdiff_t m_first = 0;
+        std::vector<Interval> m_intervals;
+        bool m_valid = false;
+    };
+
+    std::size_t level = 0;
+
+    CompressedCellSet() = default;
+    explicit CompressedCellSet(std::size_t l) : level(l) {}
+
+    /// Dimension of the space
+    static constexpr std::size_t dimension() noexcept { return Dim; }
+
+    std::size_t row_count() const noexcept { return m_row_count; }
+    std::size_t interval_count() const noexcept { return m_interval_count; }
+    bool empty() const noexcept { return m_interval_count == 0; }
+
+    /// Number of cells
+    std::size_t size() const noexcept { return m_cell_count; }
+
+    /// Memory footprint of the encoded rows and of the block index
+    std::size_t byte_size() const noexcept { return m_bytes.size() + m_blocks.size() * sizeof(Block); }
+
+    std::vector<Block> const& blocks() const noexcept { return m_blocks; }
+
+    /// Call fn(level, interval, outer_indices...) for each interval
+    template <typename Function>
+    void for_each_interval(Function && fn) const
+    {
+        for (Cursor cursor(*this); cursor.valid(); cursor.next())
+            for (auto const& interval : cursor)
+                std::apply(
+                    [&] (auto... outer) { fn(level, interval, outer...); },
+                    cursor.row()
+                );
+    }
+
+    /// Decoded cell set
+    CellSet<Dim> decompress() const
+    {
+        CellSet<Dim> set(level);
+        set.rows.reserve(m_row_count);
+        set.row_offsets.reserve(m_row_count + 1);
+        set.intervals.reserve(m_interval_count);
+        for (Cursor cursor(*this); cursor.valid(); cursor.next())
+        {
+            set.rows.push_back(cursor.row());
+            set.intervals.insert(set.intervals.end(), cursor.begin(), cursor.end());
+            set.row_offsets.push_back(set.intervals.size());
+        }
+        return set;
+    }
+
+private:
+    friend class CompressedCellSetBuilder<Dim>;
+
+    std::vector<std::uint8_t> m_bytes;
+    std::vector<Block> m_blocks;
+    std::size_t m_row_count = 0;
+    std::size_t m_interval_count = 0;
+    std::size_t m_cell_count = 0;
+};
+
+template <
+    std::size_t Dim
+>
+bool operator== (CompressedCellSet<Dim> const& lhs, CompressedCellSet<Dim> const& rhs)
+{
+    return lhs.level == rhs.level && lhs.decompress() == rhs.decompress();
+}
+
+template <
+    std::size_t Dim
+>
+bool operator!= (CompressedCellSet<Dim> const& lhs, CompressedCellSet<Dim> const& rhs)
+{
+    return !(lhs == rhs);
+}
+
+/**
+ * Streaming encoder of a CompressedCellSet
+ *
+ * Intervals are appended as with CellSet::push_back (same preconditions, overlapping or adjacent intervals are merged),
+ * only the intervals of the current row being kept uncompressed.
+ */
+template <
+    std::size_t Dim
+>
+class CompressedCellSetBuilder
+{
+public:
+    using row_indices_type = typename CellSet<Dim>::row_indices_type;
+
+    explicit CompressedCellSetBuilder(std::size_t level)
+        : m_set(level)
+    {
+    }
+
+    void push_back(row_indices_type const& row, Interval const& interval)
+    {
+        if (interval.b <= interval.a)
+            return;
+
+        if (m_intervals.empty() || m_row != row)
+        {
+            flush_row();
+            m_row = row;
+        }
+        else if (interval.a <= m_intervals.back().b)
+        {
+            m_intervals.back().b = std::max(m_intervals.back().b, interval.b);
+            return;
+        }
+        m_intervals.push_back({interval.a, interval.b});
+    }
+
+    /// Encode the last row and return the set (the builder is then empty)
+    CompressedCellSet<Dim> finish()
+    {
+        flush_row();
+        m_previous_row = {};
+        m_previous_first = 0;
+        return std::exchange(m_set, CompressedCellSet<Dim>(m_set.level));
+    }
+
+private:
+    void flush_row()
+    {
+        if (m_intervals.empty())
+            return;
+
+        auto & bytes = m_set.m_bytes;
+        if (m_set.m_row_count % CompressedCellSet<Dim>::block_rows == 0)
+            m_set.m_blocks.push_back({bytes.size(), m_previous_row, m_previous_first});
+
+        for (std::size_t d = 0; d < m_row.size(); ++d)
+            details::put_varint(bytes, details::zigzag_encode(m_row[d] - m_previous_row[d]));
+        details::put_varint(bytes, m_intervals.size());
+        details::put_varint(bytes, details::zigzag_encode(m_intervals.front().a - m_previous_first));
+        for (std::size_t k = 0; k < m_intervals.size(); ++k)
+        {
+            details::put_varint(bytes, static_cast<std::uint64_t>(m_intervals[k].b - m_intervals[k].a - 1));
+            if (k + 1 < m_intervals.size())
+                details::put_varint(bytes, static_cast<std::uint64_t>(m_intervals[k + 1].a - m_intervals[k].b - 1));
+            m_set.m_cell_count += cell_count(m_intervals[k]);
+        }
+
+        ++m_set.m_row_count;
+        m_set.m_interval_count += m_intervals.size();
+        m_previous_row = m_row;
+        m_previous_first = m_intervals.front().a;
+        m_intervals.clear();
+    }
+
+    CompressedCellSet<Dim> m_set;
+    row_indices_type m_row{};
+    std::vector<Interval> m_intervals;
+    row_indices_type m_previous_row{};
+    std::ptrdiff_t m_previous_first = 0;
+};
+
+/// Compressed copy of a cell set
+template <
+    std::size_t Dim
+>
+CompressedCellSet<Dim> compress(CellSet<Dim> const& set)
+{
+    CompressedCellSetBuilder<Dim> builder(set.level);
+    for (std::size_t r = 0; r < set.row_count(); ++r)
+        for (auto [it, end] = set.row_intervals(r); it != end; ++it)
+            builder.push_back(set.rows[r], *it);
+    return builder.finish();
+}
+
+namespace details
+{
+    /// Same as merge_rows, decoding the rows of both sets on the fly and encoding the result as it comes
+    template <
+        std::size_t Dim,
+        typename RowOperation
+    >
+    CompressedCellSet<Dim> merge_compressed_rows(CompressedCellSet<Dim> const& lhs, CompressedCellSet<Dim> const& rhs, RowOperation && op, bool keep_lhs_only, bool keep_rhs_only)
+    {
+        assert(lhs.level == rhs.level && "Cell sets must be at the same level");
+        CompressedCellSetBuilder<Dim> result(lhs.level);
+        Interval const* none = nullptr;
+
+        typename CompressedCellSet<Dim>::Cursor l(lhs), r(rhs);
+        while (l.valid() || r.valid())
+        {
+            if (!r.valid() || (l.valid() && row_less(l.row(), r.row())))
+            {
+                if (keep_lhs_only)
+                    op(l.begin(), l.end(), none, none, result, l.row());
+                l.next();
+            }
+            else if (!l.valid() || row_less(r.row(), l.row()))
+            {
+                if (keep_rhs_only)
+                    op(none, none, r.begin(), r.end(), result, r.row());
+                r.next();
+            }
+            else
+            {
+                op(l.begin(), l.end(), r.begin(), r.end(), result, l.row());
+                l.next();
+                r.next();
+            }
+        }
+        return result.finish();
+    }
+}
+
+/// Cells belonging to lhs or rhs (same level)
+template <std::size_t Dim>
+CompressedCellSet<Dim> set_union(CompressedCellSet<Dim> const& lhs, CompressedCellSet<Dim> const& rhs)
+{
+    return details::merge_compressed_rows(lhs, rhs, details::row_union<Dim, CompressedCellSetBuilder<Dim>>, true, true);
+}
+
+/// Cells belonging to lhs and rhs (same level)
+template <std::size_t Dim>
+CompressedCellSet<Dim> set_intersection(CompressedCellSet<Dim> const& lhs, CompressedCellSet<Dim> const& rhs)
+{
+    return details::merge_compressed_rows(lhs, rhs, details::row_intersection<Dim, CompressedCellSetBuilder<Dim>>, false, false);
+}
+
+/// Cells belonging to lhs but not to rhs (same level)
+template <std::size_t Dim>
+CompressedCellSet<Dim> set_difference(CompressedCellSet<Dim> const& lhs, CompressedCellSet<Dim> const& rhs)
+{
+    return details::merge_compressed_rows(lhs, rhs, details::row_difference<Dim, CompressedCellSetBuilder<Dim>>, true, false);
+}
+
+/**
+ * Call fn(level, interval, outer_indices...) for each interval of a compressed set, in parallel
+ *
+ * Each block of rows is decoded by one task, the tasks being scheduled with work stealing (see work_stealing_for).
+ */
+template <
+    std::size_t Dim,
+    typename Function
+>
+void parallel_for_each_interval(CompressedCellSet<Dim> const& set, Function && fn, std::size_t n_threads = default_thread_count())
+{
+    work_stealing_for(set.blocks().size(),
+        [&] (std::size_t b)
+        {
+            typename CompressedCellSet<Dim>::Cursor cursor(set, b);
+            for (std::size_t r = 0; r < CompressedCellSet<Dim>::block_rows && cursor.valid(); ++r, cursor.next())
+                for (auto const& interval : cursor)
+                    std::apply(
+                        [&] (auto... outer) { fn(set.level, interval, outer...); },
+                        cursor.row()
+                    );
+        },
+        n_threads
+    );
+}
+
+/**
+ * Apply a stencil on the cells of a compressed set, in parallel
+ *
+ * For each interval, stencil.shift(fn, level, interval, outer_indices...) is called (see KCells::shift).
+ */
+template <
+    std::size_t Dim,
+    typename Stencil,
+    typename Function,
+    typename = std::void_t<decltype(Stencil::kcell_size())> // Avoid conflict with the overload without stencil
+>
+void parallel_for_each_interval(CompressedCellSet<Dim> const& set, Stencil stencil, Function && fn, std::size_t n_threads = default_thread_count())
+{
+    static_assert(Stencil::kcell_size() == Dim, "Dimension mismatch between the stencil and the cell set");
+    parallel_for_each_interval(set,
+        [&fn, stencil] (std::size_t level, Interval const& interval, auto... outer)
+        {
+            KSPACE_COUNT(StencilDriver, Stencil, Stencil::size() * cell_count(interval), cell_count(interval), 0);
+            stencil.shift(fn, level, interval, outer...);
+        },
+        n_threads
+    );
+}
@@ -0,0 +1,357 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "kcells.hpp"
+#include "box.hpp"
+#include "parallel.hpp"
+#include "topology.hpp"
+
+/// Contiguous run of cells copied during a halo exchange
+struct HaloRun
+{
+    std::size_t source; ///< Offset in the source storage
+    std::size_t target; ///< Offset in the target storage
+    std::size_t size;   ///< Number of cells
+};
+
+/**
+ * Cells sent by one part to another one during a halo exchange
+ *
+ * The pack runs copy from the source part storage to a contiguous buffer,
+ * the unpack runs copy from this buffer to the ghost cells of the target part storage.
+ * The copy runs go directly from the source part storage to the target part storage.
+ */
+struct HaloMessage
+{
+    std::size_t source_part;
+    std::size_t target_part;
+    std::size_t size = 0; ///< Number of cells (size of the buffer)
+    std::vector<HaloRun> pack;
+    std::vector<HaloRun> unpack;
+    std::vector<HaloRun> copy;
+};
+
+/// Copy the cells of the message from the source part storage to the buffer
+template <typename T>
+void pack(HaloMessage const& message, T const* source, T* buffer) noexcept
+{
+    for (auto const& run : message.pack)
+        std::copy_n(source + run.source, run.size, buffer + run.target);
+}
+
+/// Copy the cells of the message from the buffer to the target part storage
+template <typename T>
+void unpack(HaloMessage const& message, T const* buffer, T* target) noexcept
+{
+    for (auto const& run : message.unpack)
+        std::copy_n(buffer + run.source, run.size, target + run.target);
+}
+
+/// Copy the cells of the message from the source part storage to the target part storage
+template <typename T>
+void copy(HaloMessage const& message, T const* source, T* target) noexcept
+{
+    for (auto const& run : message.copy)
+        std::copy_n(source + run.source, run.size, target + run.target);
+}
+
+template <std::size_t Dim> class Decomposition;
+
+/**
+ * Halo exchange split in two phases, so that it can overlap the update of the interior cells
+ *
+ * begin() packs the sent cells of every message into buffers that are kept between exchanges,
+ * finish() unpacks them into the ghost cells. Between both calls, the owned cells can be updated
+ * in place (eg the cells of interior_box), the ghost cells receiving the values packed by begin().
+ * When nothing is done in between, Decomposition::exchange is cheaper since it copies the cells only once.
+ */
+template <
+    std::size_t Dim,
+    typename T
+>
+class HaloExchange
+{
+public:
+    HaloExchange(Decomposition<Dim> const& decomposition, std::size_t topology)
+        : m_decomposition(decomposition)
+        , m_topology(topology)
+    {
+        std::size_t size = 0;
+        for (auto const& message : m_decomposition.messages(m_topology))
+        {
+            m_offsets.push_back(size);
+            size += message.size;
+        }
+        m_buffer.resize(size);
+    }
+
+    /// Pack the sent cells of all parts, in parallel over the messages
+    void begin(std::vector<T*> const& storages, std::size_t n_threads = default_thread_count())
+    {
+        auto const& messages = m_decomposition.messages(m_topology);
+        parallel_for(0, messages.size(),
+            [&] (std::size_t m)
+            {
+                pack(messages[m], static_cast<T const*>(storages[messages[m].source_part]), m_buffer.data() + m_offsets[m]);
+            },
+            n_threads
+        );
+    }
+
+    /// Fill the ghost cells of all parts with the cells packed by begin(), in parallel over the target parts
+    void finish(std::vector<T*> const& storages, std::size_t n_threads = default_thread_count()) const
+    {
+        auto const& messages = m_decomposition.messages(m_topology);
+        parallel_for(0, m_decomposition.size(),
+            [&] (std::size_t part)
+            {
+                for (auto m : m_decomposition.incoming(part, m_topology))
+                    unpack(messages[m], static_cast<T const*>(m_buffer.data() + m_offsets[m]), storages[part]);
+            },
+            n_threads
+        );
+    }
+
+private:
+    Decomposition<Dim> const& m_decomposition;
+    std::size_t m_topology;
+    std::vector<std::size_t> m_offsets;
+    std::vector<T> m_buffer;
+};
+
+/**
+ * Decomposition of a box of cells into a grid of sub-boxes (parts), each part storing its own cells
+ * and the ghost cells needed by a stencil, for every topology.
+ *
+ * A part owns the cells of its sub-box for every topology, except along a closed direction
+ * where the last part also owns the closing cells of the domain (eg the last vertex).
+ * The owned cells of all parts thus partition the cells of the domain for each topology.
+ *
+ * The storage of a part for a given topology is its owned box extended by the halo width of the stencil
+ * entries of this topology (see KCells::haloWidth), direction 0 varying fastest.
+ * Ghost cells outside of the domain are never exchanged (boundary conditions are up to the user).
+ *
+ * @tparam Dim  Dimension of the space
+ */
+template <
+    std::size_t Dim
+>
+class Decomposition
+{
+public:
+    using box_type = Box<Dim>;
+    using indices_type = typename box_type::indices_type;
+    using halo_type = std::array<indices_type, 2>;
+
+    static constexpr std::size_t topology_count() noexcept { return std::size_t(1) << Dim; }
+
+    /// Decomposition in a given grid of parts (parts[d] parts along direction d)
+    template <typename Stencil>
+    Decomposition(box_type const& domain, std::array<std::size_t, Dim> const& parts, Stencil)
+        : m_domain(domain)
+        , m_grid(parts)
+        , m_halos(make_halos(std::make_index_sequence<topology_count()>{}, Stencil{}))
+    {
+        static_assert(Stencil::kcell_size() == Dim, "Dimension mismatch between the stencil and the domain");
+        build();
+    }
+
+    /// Decomposition in n_parts parts, the grid being chosen to get parts as cubic as possible
+    template <typename Stencil>
+    Decomposition(box_type const& domain, std::size_t n_parts, Stencil stencil)
+        : Decomposition(domain, make_grid(domain, n_parts), stencil)
+    {
+    }
+
+    /// Number of parts
+    std::size_t size() const noexcept { return m_boxes.size(); }
+
+    /// Decomposed domain
+    box_type const& domain() const noexcept { return m_domain; }
+
+    /// Number of parts along each direction
+    std::array<std::size_t, Dim> const& grid() const noexcept { return m_grid; }
+
+    /// Sub-box of a part
+    box_type const& box(std::size_t part) const noexcept { return m_boxes[part]; }
+
+    /// Ghost layer widths (lower, upper) for the given topology
+    halo_type const& halo(std::size_t topology) const noexcept { return m_halos[topology]; }
+
+    /// Cells of given topology owned by a part
+    box_type owned_box(std::size_t part, std::size_t topology) const noexcept
+    {
+        box_type result = m_boxes[part];
+        for (std::size_t d = 0; d < Dim; ++d)
+            if (!is_open(topology, d) && result.max_corner[d] == m_domain.max_corner[d])
+                ++result.max_corner[d];
+        return result;
+    }
+
+    /// Cells of given topology stored by a part (owned and ghost cells)
+    box_type storage_box(std::size_t part, std::size_t topology) const noexcept
+    {
+        return owned_box(part, topology).grow(m_halos[topology][0], m_halos[topology][1]);
+    }
+
+    /// Owned cells of a part that don't depend on ghost cells (can be updated while halos are exchanged)
+    box_type interior_box(std::size_t part, std::size_t topology) const noexcept
+    {
+        box_type const owned = owned_box(part, topology);
+        return intersection(owned, owned.grow(negate(m_halos[topology][1]), negate(m_halos[topology][0])));
+    }
+
+    /// Messages to exchange for the given topology
+    std::vector<HaloMessage> const& messages(std::size_t topology) const noexcept { return m_messages[topology]; }
+
+    /// Incoming messages (indices in messages(topology)) of a part for the given topology
+    std::vector<std::size_t> const& incoming(std::size_t part, std::size_t topology) const noexcept { return m_incoming[topology][part]; }
+
+    /**
+     * Fill the ghost cells of all parts for the given topology, in parallel over the target parts
+     *
+     * The parts sharing the memory, the cells are copied directly from the source to the target storages.
+     * See make_exchange to overlap the exchange with the update of the interior cells.
+     *
+     * @param storages  storages[part] points to the storage of the part (see storage_box)
+     */
+    template <typename T>
+    void exchange(std::size_t topology, std::vector<T*> const& storages, std::size_t n_threads = default_thread_count()) const
+    {
+        parallel_for(0, size(),
+            [&] (std::size_t part)
+            {
+                for (auto m : m_incoming[topology][part])
+                {
+                    auto const& message = m_messages[topology][m];
+                    copy(message, static_cast<T const*>(storages[message.source_part]), storages[part]);
+                }
+            },
+            n_threads
+        );
+    }
+
+    /// Two-phase halo exchange of the given topology, its buffers being reused by each exchange (see HaloExchange)
+    template <typename T>
+    HaloExchange<Dim, T> make_exchange(std::size_t topology) const
+    {
+        return {*this, topology};
+    }
+
+private:
+    static indices_type negate(indices_type v) noexcept
+    {
+        for (auto & x : v)
+            x = -x;
+        return v;
+    }
+
+    template <typename Stencil, std::size_t... Topology>
+    static std::array<halo_type, topology_count()> make_halos(std::index_sequence<Topology...>, Stencil) noexcept
+    {
+        return {{Stencil::template withTopology<Topology>().haloWidth()...}};
+    }
+
+    /// Grid of parts: prime factors of n_parts are given, largest first, to the direction with the largest part extent
+    static std::array<std::size_t, Dim> make_grid(box_type const& domain, std::size_t n_parts) noexcept
+    {
+        std::vector<std::size_t> factors;
+        for (std::size_t f = 2; f * f <= n_parts; ++f)
+            for (; n_parts % f == 0; n_parts /= f)
+                factors.push_back(f);
+        if (n_parts > 1)
+            factors.push_back(n_parts);
+
+        std::array<std::size_t, Dim> grid;
+        grid.fill(1);
+        for (auto it = factors.rbegin(); it != factors.rend(); ++it)
+        {
+            std::size_t best = 0;
+            for (std::size_t d = 1; d < Dim; ++d)
+                if (domain.shape(d) * grid[best] > domain.shape(best) * grid[d])
+                    best = d;
+            grid[best] *= *it;
+        }
+        return grid;
+    }
+
+    void build()
+    {
+        std::size_t n_parts = 1;
+        for (auto n : m_grid)
+            n_parts *= n;
+
+        // Sub-boxes (direction 0 varying fastest in the part numbering)
+        m_boxes.resize(n_parts);
+        for (std::size_t part = 0; part < n_parts; ++part)
+        {
+            std::size_t p = part;
+            for (std::size_t d = 0; d < Dim; ++d)
+            {
+                auto const extent = static_cast<std::ptrdiff_t>(m_domain.shape(d));
+                auto const n = static_cast<std::ptrdiff_t>(m_grid[d]);
+                auto const i = static_cast<std::ptrdiff_t>(p % m_grid[d]);
+                p /= m_grid[d];
+                m_boxes[part].min_corner[d] = m_domain.min_corner[d] + i * extent / n;
+                m_boxes[part].max_corner[d] = m_domain.min_corner[d] + (i + 1) * extent / n;
+            }
+        }
+
+        // Halo messages
+        for (std::size_t topology = 0; topology < topology_count(); ++topology)
+        {
+            m_messages[topology].clear();
+            m_incoming[topology].assign(n_parts, {});
+            for (std::size_t target = 0; target < n_parts; ++target)
+            {
+                box_type const target_storage = storage_box(target, topology);
+                for (std::size_t source = 0; source < n_parts; ++source)
+                {
+                    if (source == target)
+                        continue;
+
+                    box_type const region = intersection(target_storage, owned_box(source, topology));
+                    if (region.empty())
+                        continue;
+
+                    m_incoming[topology][target].push_back(m_messages[topology].size());
+                    m_messages[topology].push_back(make_message(source, target, topology, region));
+                }
+            }
+        }
+    }
+
+    HaloMessage make_message(std::size_t source, std::size_t target, std::size_t topology, box_type const& region) const
+    {
+        box_type const source_storage = storage_box(source, topology);
+        box_type const target_storage = storage_box(target, topology);
+
+        HaloMessage message{source, target, 0, {}, {}, {}};
+        std::size_t const length = region.shape(0);
+        for (std::size_t r = 0; r < region.row_count(); ++r)
+        {
+            indices_type start;
+            start[0] = region.min_corner[0];
+            auto const row = region.row_indices(r);
+            std::copy(row.begin(), row.end(), start.begin() + 1);
+
+            message.pack.push_back({source_storage.offset(start), message.size, length});
+            message.unpack.push_back({message.size, target_storage.offset(start), length});
+            message.copy.push_back({source_storage.offset(start), target_storage.offset(start), length});
+            message.size += length;
+        }
+        return message;
+    }
+
+    box_type m_domain;
+    std::array<std::size_t, Dim> m_grid;
+    std::array<halo_type, topology_count()> m_halos;
+    std::vector<box_type> m_boxes;
+    std::array<std::vector<HaloMessage>, topology_count()> m_messages;
+    std::array<std::vector<std::vector<std::size_t>>, topology_count()> m_incoming;
+};
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "kcell_tuple.hpp"
+#include "kcells.hpp"
+#include "packed_key.hpp"
+#include "cell_set.hpp"
+
+namespace details
+{
+    /// Finalizer of splitmix64
+    constexpr std::uint64_t mix_hash(std::uint64_t x) noexcept
+    {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return x;
+    }
+
+    template <typename Word>
+    constexpr std::uint64_t hash_word(Word w) noexcept
+    {
+        if constexpr (sizeof(Word) <= sizeof(std::uint64_t))
+            return mix_hash(static_cast<std::uint64_t>(w));
+        else
+            return mix_hash(static_cast<std::uint64_t>(w) ^ mix_hash(static_cast<std::uint64_t>(w >> 64)));
+    }
+}
+
+/**
+ * Open-addressing hash map (linear probing) keyed by PackedKCellKey
+ *
+ * Intended for very sparse sets of cells (surfaces, fronts) where interval lists are wasteful.
+ * The invalid key marks the empty slots. There is no erase.
+ *
+ * @tparam Key      PackedKCellKey type
+ * @tparam Value    Mapped type (None for a set, see KCellHashSet)
+ */
+template <
+    typename Key,
+    typename Value = None
+>
+class KCellHashMap
+{
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+
+    KCellHashMap() = default;
+    explicit KCellHashMap(std::size_t n) { reserve(n); }
+
+    std::size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+    std::size_t capacity() const noexcept { return m_keys.size(); }
+
+    /// Ensure that n elements can be stored without rehashing (load factor at most 1/2)
+    void reserve(std::size_t n)
+    {
+        std::size_t capacity = 16;
+        while (capacity < 2 * n)
+            capacity *= 2;
+        if (capacity > m_keys.size())
+            rehash(capacity);
+    }
+
+    /// Insert a key (the value is not modified if the key is already present)
+    std::pair<Value*, bool> insert(Key const& key, Value const& value = Value{})
+    {
+        assert(key.is_valid() && "Invalid key");
+        if (2 * (m_size + 1) > m_keys.size())
+            rehash(m_keys.empty() ? 16 : 2 * m_keys.size());
+
+        std::size_t slot = find_slot(key);
+        if (m_keys[slot] == key)
+            return {&m_values[slot], false};
+
+        m_keys[slot] = key;
+        m_values[slot] = value;
+        ++m_size;
+        return {&m_values[slot], true};
+    }
+
+    /// Bulk insertion (memory is reserved once)
+    template <typename Iterator>
+    void insert(Iterator first, Iterator last)
+    {
+        reserve(m_size + static_cast<std::size_t>(std::distance(first, last)));
+        for (; first != last; ++first)
+            insert_impl(*first);
+    }
+
+    /// Value of the given key (nullptr if not found or invalid)
+    Value* find(Key const& key) noexcept
+    {
+        // The invalid key marks the empty slots
+        if (m_keys.empty() || !key.is_valid())
+            return nullptr;
+        std::size_t slot = find_slot(key);
+        return m_keys[slot] == key ? &m_values[slot] : nullptr;
+    }
+
+    Value const* find(Key const& key) const noexcept
+    {
+        return const_cast<KCellHashMap*>(this)->find(key);
+    }
+
+    bool contains(Key const& key) const noexcept { return find(key) != nullptr; }
+
+    /** Values of the neighbours of the cell of given key, through a stencil (nullptr when absent)
+     *
+     *  The key is the cell Center and each neighbour key is obtained by PackedKCellKey::shift,
+     *  ie a single addition for cells of same level, followed by a single probe.
+     */
+    template <
+        typename Center,
+        typename Stencil
+    >
+    auto neighbours(Key const& key, Center center, Stencil stencil) const noexcept
+    {
+        return stencil.apply(
+            [&] (auto... cell)
+            {
+                return std::array<Value const*, Stencil::size()>{find(key.shift(center, cell))...};
+            }
+        );
+    }
+
+    /// Call fn(key, value) for each element (in storage order)
+    template <typename Function>
+    void for_each(Function && fn) const
+    {
+        for (std::size_t slot = 0; slot < m_keys.size(); ++slot)
+            if (m_keys[slot].is_valid())
+                fn(m_keys[slot], m_values[slot]);
+    }
+
+    void clear() noexcept
+    {
+        std::fill(m_keys.begin(), m_keys.end(), Key::invalid());
+        m_size = 0;
+    }
+
+private:
+    template <typename T>
+    void insert_impl(T const& key) { insert(key); }
+
+    template <typename K, typename V>
+    void insert_impl(std::pair<K, V> const& element) { insert(element.first, element.second); }
+
+    std::size_t find_slot(Key const& key) const noexcept
+    {
+        std::size_t const mask = m_keys.size() - 1;
+        std::size_t slot = static_cast<std::size_t>(details::hash_word(key.value)) & mask;
+        while (m_keys[slot].is_valid() && m_keys[slot] != key)
+            slot = (slot + 1) & mask;
+        return slot;
+    }
+
+    void rehash(std::size_t capacity)
+    {
+        std::vector<Key> keys(capacity, Key::invalid());
+        std::vector<Value> values(capacity);
+        std::swap(keys, m_keys);
+        std::swap(values, m_values);
+        for (std::size_t slot = 0; slot < keys.size(); ++slot)
+            if (keys[slot].is_valid())
+            {
+                std::size_t const s = find_slot(keys[slot]);
+                m_keys[s] = keys[slot];
+                m_values[s] = std::move(values[slot]);
+            }
+    }
+
+    std::vector<Key> m_keys;
+    std::vector<Value> m_values;
+    std::size_t m_size = 0;
+};
+
+/// Hash set of cells keyed by PackedKCellKey
+template <typename Key>
+using KCellHashSet = KCellHashMap<Key, None>;
+
+/// Insert all the cells of a CellSet, of given topology, in a hash set (or map with default values)
+template <
+    typename Key,
+    typename Value,
+    std::size_t Dim
+>
+void insert_cells(KCellHashMap<Key, Value> & map, CellSet<Dim> const& set, std::size_t topology)
+{
+    std::vector<Key> keys;
+    keys.reserve(set.size());
+    set.for_each_interval(
+        [&] (std::size_t level, Interval const& interval, auto... outer)
+        {
+            for (auto i = interval.a; i < interval.b; ++i)
+                keys.push_back(Key::from_indices(level, topology, {i, outer...}));
+        }
+    );
+    map.insert(keys.begin(), keys.end());
+}
@@ -0,0 +1,305 @@
+#pragma once
+
+/**
+ * Opt-in instrumentation of the stencil hot paths
+ *
+ * Defining KSPACE_INSTRUMENTATION (before including any header of the library, eg with
+ * -DKSPACE_INSTRUMENTATION) counts, per stencil (or cell) type, topologies and kind of call:
+ * the number of calls, of applied shifts, of visited cells and of bytes returned by the shifted function.
+ * Otherwise KSPACE_COUNT expands to nothing and the hot paths are unchanged.
+ *
+ * Counters are thread-local (no atomics on the hot path) and merged when reported:
+ * reports must be done when the counting threads are done (eg at program end, see report_at_exit).
+ */
+
+#if defined(KSPACE_INSTRUMENTATION)
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+
+#include "interval.hpp"
+
+namespace instrumentation
+{
+    struct Counters
+    {
+        std::uint64_t calls = 0;
+        std::uint64_t shifts = 0;
+        std::uint64_t cells = 0;
+        std::uint64_t bytes = 0;
+    };
+
+    /// Counted entity: kind of call (eg "KCells::shift"), type and topologies (bit t set if topology t is used)
+    struct Entry
+    {
+        std::string kind;
+        std::string type;
+        std::uint64_t topologies;
+    };
+
+    /// Registry of the entries and of the thread-local counter tables
+    class Registry
+    {
+    public:
+        std::size_t add_entry(Entry entry)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_entries.push_back(std::move(entry));
+            return m_entries.size() - 1;
+        }
+
+        void attach(std::shared_ptr<std::vector<Counters>> const& table)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tables.push_back(table);
+        }
+
+        /// Counters of each entry, summed over the threads
+        std::vector<std::pair<Entry, Counters>> totals() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::vector<std::pair<Entry, Counters>> result;
+            for (auto const& entry : m_entries)
+                result.push_back({entry, Counters{}});
+            for (auto const& table : m_tables)
+                for (std::size_t id = 0; id < table->size() && id < result.size(); ++id)
+                {
+                    auto & c = result[id].second;
+                    c.calls += (*table)[id].calls;
+                    c.shifts += (*table)[id].shifts;
+                    c.cells += (*table)[id].cells;
+                    c.bytes += (*table)[id].bytes;
+                }
+            return result;
+        }
+
+        void reset()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto const& table : m_tables)
+                table->assign(table->size(), Counters{});
+        }
+
+    private:
+        mutable std::mutex m_mutex;
+        std::vector<Entry> m_entries;
+        std::vector<std::shared_ptr<std::vector<Counters>>> m_tables;
+    };
+
+    inline Registry & registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    /// Counters of the current thread (kept alive by the registry after the thread exits)
+    inline std::vector<Counters> & thread_counters()
+    {
+        thread_local std::shared_ptr<std::vector<Counters>> table = []
+        {
+            auto t = std::make_shared<std::vector<Counters>>();
+            registry().attach(t);
+            return t;
+        }();
+        return *table;
+    }
+
+    template <typename T>
+    std::string type_name()
+    {
+#if defined(__GNUC__)
+        int status = 0;
+        std::unique_ptr<char, void (*)(void*)> name(abi::__cxa_demangle(typeid(T).name(), nullptr, nullptr, &status), std::free);
+        if (status == 0)
+            return name.get();
+#endif
+        return typeid(T).name();
+    }
+
+    template <typename T, typename = void>
+    struct has_topology : std::false_type {};
+
+    template <typename T>
+    struct has_topology<T, std::void_t<decltype(T::topology())>> : std::true_type {};
+
+    template <typename T, typename = void>
+    struct has_topologies : std::false_type {};
+
+    template <typename T>
+    struct has_topologies<T, std::void_t<decltype(T::topologies())>> : std::true_type {};
+
+    /// Topologies used by a KCellND or a KCells (none if only known at runtime)
+    template <typename T>
+    std::uint64_t topologies()
+    {
+        if constexpr (has_topology<T>::value)
+            return std::uint64_t(1) << T::topology();
+        else if constexpr (!has_topologies<T>::value)
+            return 0;
+        else
+        {
+            std::uint64_t mask = 0;
+            auto const used = T::topologies();
+            for (std::size_t t = 0; t < used.size(); ++t)
+                mask |= static_cast<std::uint64_t>(used[t]) << t;
+            return mask;
+        }
+    }
+
+    /// Identifier of the entry of given kind and type (registered on first use)
+    template <typename Kind, typename T>
+    std::size_t entry_id()
+    {
+        static std::size_t const id = registry().add_entry({Kind::name(), type_name<T>(), topologies<T>()});
+        return id;
+    }
+
+    /// Number of cells of an index or of an interval
+    template <typename Index>
+    std::uint64_t cell_count(Index const& i) noexcept
+    {
+        if constexpr (std::is_same_v<std::decay_t<Index>, Interval>)
+            return ::cell_count(i);
+        else
+            return 1;
+    }
+
+    /// Bytes of the value returned by a shifted function (0 for void)
+    template <typename Result>
+    constexpr std::uint64_t value_bytes() noexcept
+    {
+        if constexpr (std::is_void_v<Result>)
+            return 0;
+        else
+            return sizeof(std::decay_t<Result>);
+    }
+
+    /// Count one call of kind Kind on type T, applying shifts cells shifts on cells cells
+    template <typename Kind, typename T>
+    void count(std::uint64_t shifts, std::uint64_t cells, std::uint64_t bytes)
+    {
+        std::size_t const id = entry_id<Kind, T>();
+        auto & table = thread_counters();
+        if (id >= table.size())
+            table.resize(id + 1);
+        auto & c = table[id];
+        ++c.calls;
+        c.shifts += shifts;
+        c.cells += cells;
+        c.bytes += bytes;
+    }
+
+    inline std::string topologies_as_string(std::uint64_t mask)
+    {
+        std::string s;
+        for (std::size_t t = 0; mask >> t; ++t)
+            if ((mask >> t) & 1)
+                s += (s.empty() ? "" : ",") + std::to_string(t);
+        return s;
+    }
+
+    inline std::string json_escape(std::string const& s)
+    {
+        std::string r;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                r += '\\';
+            r += c;
+        }
+        return r;
+    }
+
+    /// Table of the counters (entries never called are skipped)
+    inline void report(std::ostream & out)
+    {
+        out << std::left << std::setw(24) << "kind" << std::setw(12) << "topologies"
+            << std::right << std::setw(14) << "calls" << std::setw(14) << "shifts"
+            << std::setw(14) << "cells" << std::setw(16) << "bytes" << "  type" << std::endl;
+        for (auto const& [entry, c] : registry().totals())
+            if (c.calls > 0)
+                out << std::left << std::setw(24) << entry.kind << std::setw(12) << topologies_as_string(entry.topologies)
+                    << std::right << std::setw(14) << c.calls << std::setw(14) << c.shifts
+                    << std::setw(14) << c.cells << std::setw(16) << c.bytes << "  " << entry.type << std::endl;
+    }
+
+    /// JSON array of the counters (entries never called are skipped)
+    inline void write_json(std::ostream & out)
+    {
+        out << "[";
+        bool first = true;
+        for (auto const& [entry, c] : registry().totals())
+            if (c.calls > 0)
+            {
+                out << (first ? "" : ",") << "\n  {\"kind\": \"" << json_escape(entry.kind) << "\", "
+                    << "\"type\": \"" << json_escape(entry.type) << "\", "
+                    << "\"topologies\": [" << topologies_as_string(entry.topologies) << "], "
+                    << "\"calls\": " << c.calls << ", \"shifts\": " << c.shifts << ", "
+                    << "\"cells\": " << c.cells << ", \"bytes\": " << c.bytes << "}";
+                first = false;
+            }
+        out << "\n]\n";
+    }
+
+    inline std::string & exit_report_path()
+    {
+        static std::string path;
+        return path;
+    }
+
+    /** Report the counters at program end
+     *
+     *  @param path     Output file (JSON if it ends with .json, table otherwise), empty for the standard error
+     */
+    inline void report_at_exit(std::string path = {})
+    {
+        registry();
+        exit_report_path() = std::move(path);
+        std::atexit([]
+        {
+            auto const& p = exit_report_path();
+            if (p.empty())
+                report(std::cerr);
+            else
+            {
+                std::ofstream file(p);
+                if (p.size() >= 5 && p.compare(p.size() - 5, 5, ".json") == 0)
+                    write_json(file);
+                else
+                    report(file);
+            }
+        });
+    }
+
+    struct KCellsShift { static char const* name() noexcept { return "KCells::shift"; } };
+    struct KCellNDShift { static char const* name() noexcept { return "KCellND::shift"; } };
+    struct StencilDriver { static char const* name() noexcept { return "stencil driver"; } };
+}
+
+/** Count a call of kind Kind (instrumentation::KCellsShift, ...) on the stencil or cell type T
+ *  applying shifts shifts on cells cells and returning bytes bytes (not evaluated if disabled)
+ */
+#define KSPACE_COUNT(Kind, T, shifts, cells, bytes) \
+    ::instrumentation::count<::instrumentation::Kind, T>((shifts), (cells), (bytes))
+
+#else
+
+#define KSPACE_COUNT(Kind, T, shifts, cells, bytes) static_cast<void>(0)
+
+#endif
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 #include <ostream>
 
@@ -10,8 +11,10 @@ struct Interval
 
     Interval& operator<<= (std::size_t s) noexcept
     {
-        a <<= s;
-        b = ((b - 1) << s) + 1; // FIXME: not the same as in Samurai => need to add a dedicated operation that match the level change used for KSpace
+        // Multiplication since left-shifting negative bounds is undefined
+        std::ptrdiff_t const factor = std::ptrdiff_t(1) << s;
+        a *= factor;
+        b = (b - 1) * factor + 1; // FIXME: not the same as in Samurai => need to add a dedicated operation that match the level change used for KSpace
         step <<= s;
         return *this;
     }
@@ -28,6 +31,12 @@ struct Interval
     Interval& operator+= (std::ptrdiff_t v) noexcept { a += v; b += v; return *this; }
 };
 
+/// Number of cells of an interval, taking its step into account
+constexpr std::size_t cell_count(Interval const& i) noexcept
+{
+    return i.b > i.a ? static_cast<std::size_t>((i.b - i.a + static_cast<std::ptrdiff_t>(i.step) - 1) / static_cast<std::ptrdiff_t>(i.step)) : 0;
+}
+
 inline Interval operator<< (Interval i, std::size_t s) noexcept
 {
     i <<= s;
@@ -46,8 +55,23 @@ inline Interval operator+ (Interval i, std::ptrdiff_t v) noexcept
     return i;
 }
 
-std::ostream & operator<< (std::ostream & out, Interval const& i)
+inline std::ostream & operator<< (std::ostream & out, Interval const& i)
 {
     out << "[" << i.a << "," << i.b << "[:" << i.step;
     return out;
 }
+
+/** Cells of the interval lying in [lower, upper[, with the same step and alignment
+ *
+ *  Both bounds of the result are aligned on the interval step (the result may be empty),
+ *  so that the cells of the interval are [a, result.a[, result and [result.b, b[.
+ */
+inline Interval clip(Interval const& i, std::ptrdiff_t lower, std::ptrdiff_t upper) noexcept
+{
+    auto const step = static_cast<std::ptrdiff_t>(i.step);
+    auto const align = [&i, step] (std::ptrdiff_t bound) { return i.a + (std::max(bound, i.a) - i.a + step - 1) / step * step; };
+    std::ptrdiff_t const end = align(i.b);
+    std::ptrdiff_t const first = std::min(align(lower), end);
+    std::ptrdiff_t const last = std::max(first, std::min(align(upper), end));
+    return {first, last, i.step};
+}
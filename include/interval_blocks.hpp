@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+#include "interval.hpp"
+
+/**
+ * Block of Width indices first, first + stride, ..., first + (Width - 1) * stride of an interval
+ *
+ * The stride is known at compile time for contiguous blocks (stride 1), so that loops over a block
+ * of constant size vectorize as plain loads and stores, the other blocks being accessed by strided loads (gathers).
+ *
+ * @tparam Width        Number of indices
+ * @tparam Contiguous   True if the stride is 1
+ */
+template <
+    std::size_t Width,
+    bool Contiguous
+>
+struct IndexBlock
+{
+    std::ptrdiff_t first;
+    std::ptrdiff_t step;
+
+    static constexpr std::size_t size() noexcept { return Width; }
+    static constexpr bool contiguous() noexcept { return Contiguous; }
+
+    constexpr std::ptrdiff_t stride() const noexcept { return Contiguous ? 1 : step; }
+    constexpr std::ptrdiff_t operator[] (std::size_t k) const noexcept { return first + static_cast<std::ptrdiff_t>(k) * stride(); }
+
+    /// Indices of the block
+    constexpr std::array<std::ptrdiff_t, Width> indices() const noexcept
+    {
+        std::array<std::ptrdiff_t, Width> result{};
+        for (std::size_t k = 0; k < Width; ++k)
+            result[k] = (*this)[k];
+        return result;
+    }
+
+    /// Values of the block from the storage of a row, p pointing to the value of index first
+    template <typename T>
+    std::array<T, Width> load(T const* p) const noexcept
+    {
+        std::array<T, Width> result;
+        for (std::size_t k = 0; k < Width; ++k)
+            result[k] = p[static_cast<std::ptrdiff_t>(k) * stride()];
+        return result;
+    }
+
+    /// Write the values of the block to the storage of a row, p pointing to the value of index first
+    template <typename T>
+    void store(T * p, std::array<T, Width> const& values) const noexcept
+    {
+        for (std::size_t k = 0; k < Width; ++k)
+            p[static_cast<std::ptrdiff_t>(k) * stride()] = values[k];
+    }
+};
+
+/// Default number of indices per block (eg 8 doubles fill an AVX-512 register)
+constexpr std::size_t default_block_width = 8;
+
+namespace details
+{
+    template <
+        std::size_t Width,
+        bool Contiguous,
+        typename Function
+    >
+    void for_each_block(std::ptrdiff_t first, std::ptrdiff_t step, std::size_t n, Function && fn)
+    {
+        std::ptrdiff_t const stride = static_cast<std::ptrdiff_t>(Width) * step;
+        std::ptrdiff_t const blocks_end = first + static_cast<std::ptrdiff_t>(n / Width) * stride;
+        std::ptrdiff_t const end = first + static_cast<std::ptrdiff_t>(n) * step;
+        for (; first != blocks_end; first += stride)
+            fn(IndexBlock<Width, Contiguous>{first, step});
+        for (; first != end; first += step)
+            fn(IndexBlock<1, Contiguous>{first, step});
+    }
+}
+
+/**
+ * Call fn(block) for each block of indices of the interval, in increasing order
+ *
+ * The indices are grouped in blocks of Width indices (see IndexBlock), the remaining ones being
+ * passed in blocks of one index, so that fn is only called with blocks of size known at compile time.
+ * The intervals of step 1 get contiguous blocks: with Step = 1, the interval step is known
+ * to be 1 at compile time and only the contiguous blocks are instantiated.
+ *
+ * Strided intervals come for example from the shift of an interval to a finer level (see KCell::up).
+ *
+ * @tparam Width    Number of indices per block
+ * @tparam Step     Step of the interval if known at compile time (1), 0 otherwise
+ */
+template <
+    std::size_t Width = default_block_width,
+    std::ptrdiff_t Step = 0,
+    typename Function
+>
+void for_each_block(Interval const& interval, Function && fn)
+{
+    static_assert(Width > 0, "Blocks cannot be empty");
+    static_assert(Step == 0 || Step == 1, "Only the unit step can be known at compile time");
+    std::size_t const n = cell_count(interval);
+
+    if constexpr (Step == 1)
+    {
+        assert(interval.step == 1 && "Interval step is not 1");
+        details::for_each_block<Width, true>(interval.a, 1, n, fn);
+    }
+    else if (interval.step == 1)
+        details::for_each_block<Width, true>(interval.a, 1, n, fn);
+    else
+        details::for_each_block<Width, false>(interval.a, static_cast<std::ptrdiff_t>(interval.step), n, fn);
+}
@@ -19,10 +19,19 @@ namespace details
     template <typename T>
     constexpr auto bitwise_shift(T && i, std::ptrdiff_t shift) noexcept
     {
-        if (shift >= 0)
+        using value_type = std::decay_t<T>;
+        if constexpr (std::is_integral_v<value_type>)
+        {
+            // Left shift of a negative integer is undefined behavior
+            if (shift >= 0)
+                return static_cast<value_type>(i * (value_type(1) << shift));
+            else
+                return static_cast<value_type>(i >> -shift);
+        }
+        else if (shift >= 0)
             return std::forward<T>(i) << shift;
         else
-            return std::forward<T>(i) >> -shift;     
+            return std::forward<T>(i) >> -shift;
     }
 
     /// Shift level and position of one index or interval
@@ -40,7 +49,9 @@ namespace details
     >
     constexpr auto shift(T i) noexcept
     {
-        if constexpr (LevelShift > 0)
+        if constexpr (LevelShift > 0 && std::is_integral_v<T>)
+            i *= T(1) << LevelShift; // Left shift of a negative integer is not a constant expression
+        else if constexpr (LevelShift > 0)
             i <<= LevelShift;
         else if constexpr (LevelShift < 0)
             i >>= -LevelShift;
@@ -157,7 +168,7 @@ struct KCell
     {
         if constexpr (Levels < 0)
             return down<-Levels>();
-        if constexpr (Levels == 0)
+        else if constexpr (Levels == 0)
             return KCells<KCell>{};
         else if constexpr (Levels == 1)
             return KCells<
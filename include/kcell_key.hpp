@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "kcell.hpp"
+#include "kcellnd.hpp"
+
+/**
+ * Encoding independent parts of the cell keys (see PackedKCellKey and MortonKCellKey)
+ *
+ * A key type Key provides indices(), level() and Key::from_indices(level, topology, indices).
+ */
+namespace details
+{
+    /// Khalimsky coordinates of the cell of given topology and indices
+    template <std::size_t Dim>
+    constexpr std::array<std::ptrdiff_t, Dim> khalimsky_from_indices(std::size_t topology, std::array<std::ptrdiff_t, Dim> indices) noexcept
+    {
+        for (std::size_t d = 0; d < Dim; ++d)
+            indices[d] = 2 * indices[d] + static_cast<std::ptrdiff_t>((topology >> d) & 1);
+        return indices;
+    }
+
+    /// Indices of a cell (in the index space of its topology) from its Khalimsky coordinates
+    template <std::size_t Dim>
+    constexpr std::array<std::ptrdiff_t, Dim> indices_from_khalimsky(std::array<std::ptrdiff_t, Dim> khalimsky) noexcept
+    {
+        for (auto & x : khalimsky)
+            x >>= 1;
+        return khalimsky;
+    }
+
+    /// Khalimsky move from a cell of type Center to the cell of type Cell (same level shift)
+    template <
+        typename Center,
+        typename Cell
+    >
+    constexpr auto khalimsky_delta() noexcept
+    {
+        static_assert(Center::levelShift() == Cell::levelShift(), "Khalimsky delta is only defined for cells of same level");
+        constexpr std::size_t dim = Center::size();
+        using khalimsky_type = std::array<std::ptrdiff_t, dim>;
+        constexpr auto from = Center::apply([] (auto... c) { return khalimsky_type{c.khalimsky()...}; });
+        constexpr auto to = Cell::apply([] (auto... c) { return khalimsky_type{c.khalimsky()...}; });
+        khalimsky_type shift{};
+        for (std::size_t d = 0; d < dim; ++d)
+            shift[d] = to[d] - from[d];
+        return shift;
+    }
+
+    /**
+     * Indices of the origin cell of a stencil from the indices of its cell Center (inverse of Center::shift)
+     *
+     * For a coarser Center (negative level shift), the origin is the first descendant of the cell.
+     */
+    template <
+        typename Center,
+        std::size_t Dim
+    >
+    constexpr std::array<std::ptrdiff_t, Dim> origin_indices(std::array<std::ptrdiff_t, Dim> indices) noexcept
+    {
+        constexpr auto center_shift = Center::indexShift();
+        constexpr std::ptrdiff_t level_shift = Center::levelShift();
+        for (std::size_t d = 0; d < Dim; ++d)
+        {
+            indices[d] -= center_shift[d];
+            if constexpr (level_shift > 0)
+                indices[d] >>= level_shift;
+            else if constexpr (level_shift < 0)
+                indices[d] *= std::ptrdiff_t(1) << -level_shift;
+        }
+        return indices;
+    }
+
+    /// Key of the cell Cell when the given key is the cell Center, by unpacking the indices (any level shifts)
+    template <
+        typename Center,
+        typename Cell,
+        typename Key
+    >
+    constexpr Key shift_key(Key const& key) noexcept
+    {
+        auto const origin = origin_indices<Center>(key.indices());
+        auto const origin_level = static_cast<std::ptrdiff_t>(key.level()) - Center::levelShift();
+        return Key::from_indices(static_cast<std::size_t>(origin_level + Cell::levelShift()), Cell::topology(), Cell::shift(origin));
+    }
+}
@@ -190,6 +190,27 @@ struct KCellND : KCellTuple<T...>
         return KCellND::template get<0>().levelShift();
     }
 
+    /// Minimal index shift per direction of the footprint (the cell itself)
+    static constexpr auto minIndexShift() noexcept { return KCells<KCellND>::minIndexShift(); }
+
+    /// Maximal index shift per direction of the footprint (the cell itself)
+    static constexpr auto maxIndexShift() noexcept { return KCells<KCellND>::maxIndexShift(); }
+
+    /// Minimal level shift of the footprint
+    static constexpr std::ptrdiff_t minLevelShift() noexcept { return levelShift(); }
+
+    /// Maximal level shift of the footprint
+    static constexpr std::ptrdiff_t maxLevelShift() noexcept { return levelShift(); }
+
+    /// Topologies touched by the footprint (only the cell's topology)
+    static constexpr auto topologies() noexcept { return KCells<KCellND>::topologies(); }
+
+    /// Number of cells in the footprint
+    static constexpr std::size_t footprintSize() noexcept { return 1; }
+
+    /// Ghost layer widths needed to reach this cell (see KCells::haloWidth)
+    static constexpr auto haloWidth() noexcept { return KCells<KCellND>::haloWidth(); }
+
     /// Topology along a given direction
     template <
         std::size_t I
@@ -420,13 +441,13 @@ struct KCellND : KCellTuple<T...>
     static constexpr decltype(auto) shift(Function && fn, std::size_t level, Index && ... index)
     {
         auto indices = shift(std::forward<Index>(index)...);
-        return std::apply(
-            [&fn, level] (auto... idx) -> decltype(auto)
-            {
-                return std::forward<Function>(fn)(level + levelShift(), idx...);
-            },
-            indices
-        );
+        auto call = [&fn, level] (auto... idx) -> decltype(auto)
+        {
+            return std::forward<Function>(fn)(level + levelShift(), idx...);
+        };
+        KSPACE_COUNT(KCellNDShift, KCellND, (instrumentation::cell_count(index) * ... * 1), (instrumentation::cell_count(index) * ... * 1),
+                     (instrumentation::cell_count(index) * ... * 1) * instrumentation::value_bytes<decltype(std::apply(call, indices))>());
+        return std::apply(call, indices);
     }
 
     template <
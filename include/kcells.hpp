@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <cstdlib>
 #include <tuple>
 #include <utility>
@@ -8,6 +9,7 @@
 #include <type_traits>
 
 #include "kcell_tuple.hpp"
+#include "instrumentation.hpp"
 
 // Forward declaration
 template <typename... T>
@@ -59,6 +61,16 @@ namespace details
         return details::subtraction_helper(lhs, rhs, KCells<V...>{});
     }
 
+    template <
+        typename... T,
+        std::size_t... I
+    >
+    constexpr auto group_by_level(KCells<T...>, std::index_sequence<I...>) noexcept
+    {
+        constexpr auto levels = KCells<T...>::distinctLevelShifts();
+        return std::make_tuple(KCells<T...>::template withLevelShift<levels[I]>()...);
+    }
+
     /// make_tuple while keeping lvalue references (eg to make assignment work)
     /// but converting rvalue ref to value unlike std::forward_as_tuple.
     template <typename... Args>
@@ -95,6 +107,159 @@ struct KCells : KCellTuple<T...>
         );
     }
 
+    /// Returns the level shift of each cell
+    static constexpr auto levelShifts() noexcept
+    {
+        return std::array<std::ptrdiff_t, sizeof...(T)>{T::levelShift()...};
+    }
+
+    /// Minimal index shift per direction over all cells (0 if empty)
+    static constexpr auto minIndexShift() noexcept
+    {
+        std::array<std::ptrdiff_t, KCells::kcell_size()> result{};
+        auto const shifts = indexShift();
+        for (std::size_t c = 0; c < shifts.size(); ++c)
+            for (std::size_t d = 0; d < result.size(); ++d)
+                result[d] = (c == 0 || shifts[c][d] < result[d]) ? shifts[c][d] : result[d];
+        return result;
+    }
+
+    /// Maximal index shift per direction over all cells (0 if empty)
+    static constexpr auto maxIndexShift() noexcept
+    {
+        std::array<std::ptrdiff_t, KCells::kcell_size()> result{};
+        auto const shifts = indexShift();
+        for (std::size_t c = 0; c < shifts.size(); ++c)
+            for (std::size_t d = 0; d < result.size(); ++d)
+                result[d] = (c == 0 || shifts[c][d] > result[d]) ? shifts[c][d] : result[d];
+        return result;
+    }
+
+    /// Minimal level shift over all cells (0 if empty)
+    static constexpr std::ptrdiff_t minLevelShift() noexcept
+    {
+        std::ptrdiff_t result = 0;
+        auto const shifts = levelShifts();
+        for (std::size_t c = 0; c < shifts.size(); ++c)
+            result = (c == 0 || shifts[c] < result) ? shifts[c] : result;
+        return result;
+    }
+
+    /// Maximal level shift over all cells (0 if empty)
+    static constexpr std::ptrdiff_t maxLevelShift() noexcept
+    {
+        std::ptrdiff_t result = 0;
+        auto const shifts = levelShifts();
+        for (std::size_t c = 0; c < shifts.size(); ++c)
+            result = (c == 0 || shifts[c] > result) ? shifts[c] : result;
+        return result;
+    }
+
+    /// Topologies touched by the cells: the t-th element is true if a cell has topology t
+    static constexpr auto topologies() noexcept
+    {
+        std::array<bool, (std::size_t(1) << KCells::kcell_size())> result{};
+        for (auto t : std::array<std::size_t, sizeof...(T)>{T::topology()...})
+            result[t] = true;
+        return result;
+    }
+
+    /// Cells of given topology (keeps the order)
+    template <
+        std::size_t Topology
+    >
+    static constexpr auto withTopology() noexcept
+    {
+        return KCells::apply(
+            [] (auto... cell) { return (std::conditional_t<decltype(cell)::topology() == Topology, KCells<decltype(cell)>, KCells<>>{} + ... + KCells<>{}); }
+        );
+    }
+
+    /// Cells of given level shift (keeps the order)
+    template <
+        std::ptrdiff_t LevelShift
+    >
+    static constexpr auto withLevelShift() noexcept
+    {
+        return KCells::apply(
+            [] (auto... cell) { return (std::conditional_t<decltype(cell)::levelShift() == LevelShift, KCells<decltype(cell)>, KCells<>>{} + ... + KCells<>{}); }
+        );
+    }
+
+    /// Number of distinct level shifts
+    static constexpr std::size_t levelCount() noexcept
+    {
+        auto const shifts = levelShifts();
+        std::size_t count = 0;
+        for (std::size_t c = 0; c < shifts.size(); ++c)
+        {
+            bool first = true;
+            for (std::size_t p = 0; p < c; ++p)
+                first = first && shifts[p] != shifts[c];
+            count += first ? 1 : 0;
+        }
+        return count;
+    }
+
+    /// Distinct level shifts in increasing order
+    static constexpr auto distinctLevelShifts() noexcept
+    {
+        std::array<std::ptrdiff_t, levelCount()> result{};
+        auto const shifts = levelShifts();
+        for (std::size_t l = 0; l < result.size(); ++l)
+        {
+            // Smallest level shift greater than the previous one
+            bool found = false;
+            for (auto s : shifts)
+                if ((l == 0 || s > result[l - 1]) && (!found || s < result[l]))
+                {
+                    result[l] = s;
+                    found = true;
+                }
+        }
+        return result;
+    }
+
+    /// Tuple of KCells grouping the cells by level shift (in increasing order), keeping the order within a group
+    static constexpr auto group_by_level() noexcept
+    {
+        return details::group_by_level(KCells{}, std::make_index_sequence<levelCount()>{});
+    }
+
+    /// Number of distinct cells
+    static constexpr std::size_t footprintSize() noexcept
+    {
+        return unique().size();
+    }
+
+    /** Number of cells, at the level of the origin cell, needed before (first) and after (second) the origin cell
+     *  along each direction to contain the whole footprint (eg ghost layer widths).
+     *
+     *  A cell at a finer level lies in the origin level cell of index (index_shift >> level_shift),
+     *  a cell at a coarser level covers 2^(-level_shift) cells of the origin level.
+     */
+    static constexpr auto haloWidth() noexcept
+    {
+        std::array<std::array<std::ptrdiff_t, KCells::kcell_size()>, 2> result{};
+        auto const index_shifts = indexShift();
+        auto const level_shifts = levelShifts();
+        for (std::size_t c = 0; c < index_shifts.size(); ++c)
+            for (std::size_t d = 0; d < KCells::kcell_size(); ++d)
+            {
+                std::ptrdiff_t lower = index_shifts[c][d] >> (level_shifts[c] > 0 ? level_shifts[c] : 0);
+                std::ptrdiff_t upper = lower;
+                if (level_shifts[c] < 0)
+                {
+                    std::ptrdiff_t const ratio = std::ptrdiff_t(1) << -level_shifts[c];
+                    lower = index_shifts[c][d] * ratio - (ratio - 1);
+                    upper = index_shifts[c][d] * ratio + (ratio - 1);
+                }
+                result[0][d] = (-lower > result[0][d]) ? -lower : result[0][d];
+                result[1][d] = (upper > result[1][d]) ? upper : result[1][d];
+            }
+        return result;
+    }
+
     template <std::ptrdiff_t Steps = 1>
     static constexpr auto next() noexcept
     {
@@ -235,6 +400,7 @@ struct KCells : KCellTuple<T...>
     >
     static constexpr auto shift(Function && fn, std::size_t level, Index && ... i)
     {
+        KSPACE_COUNT(KCellsShift, KCells, sizeof...(T) * (instrumentation::cell_count(i) * ... * 1), (instrumentation::cell_count(i) * ... * 1), 0);
         return KCells::apply(
             [&fn, &level, &i...] (auto... cell)
             {
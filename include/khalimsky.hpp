@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+#include "kcell.hpp"
+#include "topology.hpp"
+
+/**
+ * Batch conversions of cell coordinates across levels
+ *
+ * The level shift (and the index shift) are template parameters, so that the direction of the bitwise shift
+ * is resolved at compile time and each kernel is a branch-free loop over contiguous arrays that the compiler vectorizes.
+ * Coordinates of several directions are stored contiguously per cell (array of structures), or in
+ * separate arrays when calling the one dimensional kernels per direction.
+ *
+ * A cell of index i and topology open (1) or closed (0) along a direction has the Khalimsky coordinate 2 * i + open.
+ * Changing the level of LevelShift maps a cell to its first descendant (LevelShift > 0, see KCell::up)
+ * or to its ancestor (LevelShift < 0, see KCell::down) with the same topology.
+ */
+
+/// out[k] = (in[k] << LevelShift) + IndexShift for k in [0, n[ (see KCell::shift)
+template <
+    std::ptrdiff_t IndexShift,
+    std::ptrdiff_t LevelShift
+>
+void batch_shift(std::ptrdiff_t const* in, std::ptrdiff_t * out, std::size_t n) noexcept
+{
+    for (std::size_t k = 0; k < n; ++k)
+        out[k] = details::shift<IndexShift, LevelShift>(in[k]);
+}
+
+/// Khalimsky coordinates of any topology changed of LevelShift levels, for k in [0, n[
+template <
+    std::ptrdiff_t LevelShift
+>
+void batch_khalimsky_shift(std::ptrdiff_t const* in, std::ptrdiff_t * out, std::size_t n) noexcept
+{
+    for (std::size_t k = 0; k < n; ++k)
+        out[k] = 2 * details::shift<0, LevelShift>(in[k] >> 1) + (in[k] & 1);
+}
+
+/**
+ * Khalimsky coordinates of n cells of given topology from their indices at a level shifted of LevelShift
+ *
+ * @param topology  Topology of the cells
+ * @param indices   Indices of the cells (Dim per cell)
+ * @param khalimsky Khalimsky coordinates (Dim per cell)
+ */
+template <
+    std::size_t Dim,
+    std::ptrdiff_t LevelShift = 0
+>
+void batch_to_khalimsky(std::size_t topology, std::ptrdiff_t const* indices, std::ptrdiff_t * khalimsky, std::size_t n) noexcept
+{
+    std::array<std::ptrdiff_t, Dim> open{};
+    for (std::size_t d = 0; d < Dim; ++d)
+        open[d] = is_open(topology, d) ? 1 : 0;
+
+    for (std::size_t k = 0; k < n; ++k)
+        for (std::size_t d = 0; d < Dim; ++d)
+            khalimsky[Dim * k + d] = 2 * details::shift<0, LevelShift>(indices[Dim * k + d]) + open[d];
+}
+
+/// Indices of n cells from their Khalimsky coordinates (Dim per cell) at a level shifted of LevelShift (the topology is lost)
+template <
+    std::size_t Dim,
+    std::ptrdiff_t LevelShift = 0
+>
+void batch_from_khalimsky(std::ptrdiff_t const* khalimsky, std::ptrdiff_t * indices, std::size_t n) noexcept
+{
+    for (std::size_t k = 0; k < Dim * n; ++k)
+        indices[k] = details::shift<0, LevelShift>(khalimsky[k] >> 1);
+}
+
+namespace details
+{
+    /// Largest level shift of the pre-instantiated kernels
+    constexpr std::ptrdiff_t max_batch_level_shift = 16;
+
+    using batch_kernel = void (*)(std::ptrdiff_t const*, std::ptrdiff_t *, std::size_t) noexcept;
+
+    template <
+        std::size_t... I
+    >
+    constexpr auto make_batch_khalimsky_shifts(std::index_sequence<I...>) noexcept
+    {
+        return std::array<batch_kernel, sizeof...(I)>{&batch_khalimsky_shift<static_cast<std::ptrdiff_t>(I) - max_batch_level_shift>...};
+    }
+
+    /// Kernels of level shift -max_batch_level_shift to max_batch_level_shift
+    inline constexpr auto batch_khalimsky_shifts = make_batch_khalimsky_shifts(std::make_index_sequence<2 * max_batch_level_shift + 1>{});
+}
+
+/**
+ * Khalimsky coordinates of any topology changed of a level shift known at runtime
+ *
+ * Dispatches to the kernel of the level shift when |level_shift| <= details::max_batch_level_shift,
+ * the direction of the shift being otherwise tested once for the whole batch.
+ */
+inline void batch_khalimsky_shift(std::ptrdiff_t level_shift, std::ptrdiff_t const* in, std::ptrdiff_t * out, std::size_t n) noexcept
+{
+    if (level_shift >= -details::max_batch_level_shift && level_shift <= details::max_batch_level_shift)
+        details::batch_khalimsky_shifts[static_cast<std::size_t>(level_shift + details::max_batch_level_shift)](in, out, n);
+    else if (level_shift > 0)
+        for (std::size_t k = 0; k < n; ++k)
+            out[k] = 2 * ((in[k] >> 1) * (std::ptrdiff_t(1) << level_shift)) + (in[k] & 1);
+    else
+        for (std::size_t k = 0; k < n; ++k)
+            out[k] = 2 * ((in[k] >> 1) >> -level_shift) + (in[k] & 1);
+}
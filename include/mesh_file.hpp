@@ -0,0 +1,502 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "interval.hpp"
+#include "cell_set.hpp"
+
+/**
+ * Binary mesh files: cell sets of several levels and fields, readable without copy through mmap
+ *
+ * Layout (native endianness, every section aligned on mesh_file::alignment bytes):
+ *  - header (see mesh_file::Header),
+ *  - per level: the outer indices of the rows, the row offsets (row_count + 1 entries) and the intervals,
+ *    stored as in CellSet so that a mapped level is used in place (see CellSetView),
+ *  - per field: its values,
+ *  - the level table (mesh_file::LevelRecord) and the field table (mesh_file::FieldRecord).
+ */
+namespace mesh_file
+{
+    constexpr std::size_t alignment = 64;
+    constexpr std::uint32_t version = 1;
+    constexpr std::uint32_t endianness = 0x01020304;
+    constexpr char magic[8] = {'K', 'S', 'P', 'A', 'C', 'E', 'M', 'F'};
+    constexpr std::size_t max_name_size = 31;
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t endianness;
+        std::uint32_t dimension;
+        std::uint32_t interval_size;
+        std::uint64_t level_count;
+        std::uint64_t field_count;
+        std::uint64_t level_table;  ///< Offset of the level table
+        std::uint64_t field_table;  ///< Offset of the field table
+        std::uint64_t file_size;
+    };
+
+    struct LevelRecord
+    {
+        std::uint64_t level;
+        std::uint64_t row_count;
+        std::uint64_t interval_count;
+        std::uint64_t cell_count;
+        std::uint64_t rows;         ///< Offset of the outer indices
+        std::uint64_t row_offsets;  ///< Offset of the row offsets
+        std::uint64_t intervals;    ///< Offset of the intervals
+        std::uint64_t reserved;
+    };
+
+    struct FieldRecord
+    {
+        char name[max_name_size + 1];
+        std::uint64_t level;
+        std::uint64_t topology;
+        std::uint64_t value_size;
+        std::uint64_t count;
+        std::uint64_t data;         ///< Offset of the values
+        std::uint64_t reserved[7];
+    };
+
+    static_assert(sizeof(Header) == alignment && sizeof(LevelRecord) == alignment && sizeof(FieldRecord) == 2 * alignment, "Unexpected record padding");
+    static_assert(sizeof(std::size_t) == sizeof(std::uint64_t), "Row offsets are stored as 64 bits integers");
+    static_assert(std::is_trivially_copyable_v<Interval>, "Intervals are stored as is");
+
+    constexpr std::uint64_t align(std::uint64_t offset) noexcept
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+}
+
+/**
+ * Read-only view of a cell set stored elsewhere (eg in a mapped mesh file), with the same layout as CellSet
+ *
+ * @tparam Dim  Dimension of the space
+ */
+template <
+    std::size_t Dim
+>
+struct CellSetView
+{
+    using row_indices_type = typename CellSet<Dim>::row_indices_type;
+
+    std::size_t level = 0;
+    row_indices_type const* rows = nullptr;
+    std::size_t const* row_offsets = nullptr;   ///< row_count() + 1 offsets in intervals
+    Interval const* intervals = nullptr;
+    std::size_t n_rows = 0;
+
+    std::size_t row_count() const noexcept { return n_rows; }
+    std::size_t interval_count() const noexcept { return n_rows == 0 ? 0 : row_offsets[n_rows] - row_offsets[0]; }
+    bool empty() const noexcept { return interval_count() == 0; }
+
+    /// Number of cells
+    std::size_t size() const noexcept
+    {
+        std::size_t s = 0;
+        for (std::size_t k = row_offsets[0]; k < row_offsets[n_rows]; ++k)
+            s += cell_count(intervals[k]);
+        return s;
+    }
+
+    /// Intervals of the r-th row as a [begin, end[ pair of pointers
+    std::pair<Interval const*, Interval const*> row_intervals(std::size_t r) const noexcept
+    {
+        return {intervals + row_offsets[r], intervals + row_offsets[r + 1]};
+    }
+
+    /// Rows [first, last[ (without copy)
+    CellSetView row_range(std::size_t first, std::size_t last) const noexcept
+    {
+        assert(first <= last && last <= n_rows && "Invalid row range");
+        return {level, rows + first, row_offsets + first, intervals, last - first};
+    }
+
+    /// Index of the first row not before the given outer indices (row_count() if none)
+    std::size_t lower_row(row_indices_type const& row) const noexcept
+    {
+        return static_cast<std::size_t>(std::lower_bound(rows, rows + n_rows, row, details::row_less<Dim - 1>) - rows);
+    }
+
+    /// Copy of the cells into a CellSet
+    CellSet<Dim> to_cell_set() const
+    {
+        CellSet<Dim> set(level);
+        set.rows.assign(rows, rows + n_rows);
+        set.intervals.assign(intervals + row_offsets[0], intervals + row_offsets[n_rows]);
+        set.row_offsets.resize(n_rows + 1);
+        for (std::size_t r = 0; r <= n_rows; ++r)
+            set.row_offsets[r] = row_offsets[r] - row_offsets[0];
+        return set;
+    }
+};
+
+/// Read-only view of the values of a field stored in a mesh file
+template <
+    typename T
+>
+struct FieldView
+{
+    std::size_t level = 0;
+    std::size_t topology = 0;
+    T const* data = nullptr;
+    std::size_t count = 0;
+
+    T const* begin() const noexcept { return data; }
+    T const* end() const noexcept { return data + count; }
+    std::size_t size() const noexcept { return count; }
+    T const& operator[] (std::size_t i) const noexcept { return data[i]; }
+};
+
+/**
+ * Streaming writer of a mesh file
+ *
+ * Levels and fields are written in call order as they come, the tables and the header when closing.
+ *
+ * @tparam Dim  Dimension of the space
+ */
+template <
+    std::size_t Dim
+>
+class MeshFileWriter
+{
+public:
+    explicit MeshFileWriter(std::string const& path)
+        : m_file(path, std::ios::binary | std::ios::trunc)
+    {
+        if (!m_file)
+            throw std::runtime_error("Cannot open mesh file " + path);
+        mesh_file::Header header{};
+        write(&header, sizeof(header));
+    }
+
+    MeshFileWriter(MeshFileWriter const&) = delete;
+    MeshFileWriter& operator= (MeshFileWriter const&) = delete;
+
+    ~MeshFileWriter()
+    {
+        if (m_file.is_open())
+        {
+            try { close(); }
+            catch (...) {}
+        }
+    }
+
+    /// Append the cells of a level
+    void write_level(CellSet<Dim> const& set)
+    {
+        mesh_file::LevelRecord record{};
+        record.level = set.level;
+        record.row_count = set.row_count();
+        record.interval_count = set.interval_count();
+        record.cell_count = set.size();
+        record.rows = write_section(set.rows.data(), set.rows.size() * sizeof(*set.rows.data()));
+        record.row_offsets = write_section(set.row_offsets.data(), set.row_offsets.size() * sizeof(std::size_t));
+        record.intervals = write_section(set.intervals.data(), set.intervals.size() * sizeof(Interval));
+        m_levels.push_back(record);
+    }
+
+    /// Append the values of a field (eg one value per cell of a level, in the cell set order)
+    template <
+        typename T
+    >
+    void write_field(std::string const& name, std::size_t level, std::size_t topology, T const* data, std::size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Field values are stored as is");
+        if (name.size() > mesh_file::max_name_size)
+            throw std::invalid_argument("Field name too long: " + name);
+
+        mesh_file::FieldRecord record{};
+        std::copy(name.begin(), name.end(), record.name);
+        record.level = level;
+        record.topology = topology;
+        record.value_size = sizeof(T);
+        record.count = count;
+        record.data = write_section(data, count * sizeof(T));
+        m_fields.push_back(record);
+    }
+
+    template <
+        typename T
+    >
+    void write_field(std::string const& name, std::size_t level, std::size_t topology, std::vector<T> const& values)
+    {
+        write_field(name, level, topology, values.data(), values.size());
+    }
+
+    /// Write the tables and the header
+    void close()
+    {
+        mesh_file::Header header{};
+        std::copy(std::begin(mesh_file::magic), std::end(mesh_file::magic), header.magic);
+        header.version = mesh_file::version;
+        header.endianness = mesh_file::endianness;
+        header.dimension = Dim;
+        header.interval_size = sizeof(Interval);
+        header.level_count = m_levels.size();
+        header.field_count = m_fields.size();
+        header.level_table = write_section(m_levels.data(), m_levels.size() * sizeof(mesh_file::LevelRecord));
+        header.field_table = write_section(m_fields.data(), m_fields.size() * sizeof(mesh_file::FieldRecord));
+        header.file_size = m_offset;
+
+        m_file.seekp(0);
+        m_file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        m_file.close();
+        if (!m_file)
+            throw std::runtime_error("Cannot write mesh file");
+    }
+
+private:
+    void write(void const* data, std::size_t size)
+    {
+        m_file.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+        if (!m_file)
+            throw std::runtime_error("Cannot write mesh file");
+        m_offset += size;
+    }
+
+    /// Write a section at the next aligned offset and return its offset
+    std::uint64_t write_section(void const* data, std::size_t size)
+    {
+        static constexpr char padding[mesh_file::alignment] = {};
+        write(padding, mesh_file::align(m_offset) - m_offset);
+        std::uint64_t const offset = m_offset;
+        if (size > 0)
+            write(data, size);
+        return offset;
+    }
+
+    std::ofstream m_file;
+    std::uint64_t m_offset = 0;
+    std::vector<mesh_file::LevelRecord> m_levels;
+    std::vector<mesh_file::FieldRecord> m_fields;
+};
+
+/// Write the levels of a mesh (mesh[l] is a cell set of level l)
+template <
+    std::size_t Dim
+>
+void save_mesh(std::string const& path, std::vector<CellSet<Dim>> const& mesh)
+{
+    MeshFileWriter<Dim> writer(path);
+    for (auto const& set : mesh)
+        writer.write_level(set);
+    writer.close();
+}
+
+/**
+ * Mesh file mapped in memory
+ *
+ * Opening only checks the header, the tables and the row offsets of the levels: the pages of the intervals
+ * or of a field are read by the system when first accessed, so that a restart can start computing on the first levels right away.
+ *
+ * @tparam Dim  Dimension of the space
+ */
+template <
+    std::size_t Dim
+>
+class MappedMeshFile
+{
+public:
+    explicit MappedMeshFile(std::string const& path)
+    {
+        int const fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open mesh file " + path);
+
+        struct stat info{};
+        if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(mesh_file::Header))
+        {
+            ::close(fd);
+            throw std::runtime_error("Invalid mesh file " + path);
+        }
+
+        m_size = static_cast<std::size_t>(info.st_size);
+        void * data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+            throw std::runtime_error("Cannot map mesh file " + path);
+        m_data = static_cast<std::byte const*>(data);
+
+        try { check(path); }
+        catch (...)
+        {
+            unmap();
+            throw;
+        }
+    }
+
+    MappedMeshFile(MappedMeshFile && other) noexcept
+        : m_data(std::exchange(other.m_data, nullptr))
+        , m_size(std::exchange(other.m_size, 0))
+    {
+    }
+
+    MappedMeshFile& operator= (MappedMeshFile && other) noexcept
+    {
+        if (this != &other)
+        {
+            unmap();
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+        }
+        return *this;
+    }
+
+    MappedMeshFile(MappedMeshFile const&) = delete;
+    MappedMeshFile& operator= (MappedMeshFile const&) = delete;
+
+    ~MappedMeshFile() { unmap(); }
+
+    mesh_file::Header const& header() const noexcept { return *at<mesh_file::Header>(0); }
+
+    std::size_t level_count() const noexcept { return header().level_count; }
+    std::size_t field_count() const noexcept { return header().field_count; }
+
+    mesh_file::LevelRecord const& level_record(std::size_t k) const noexcept { return at<mesh_file::LevelRecord>(header().level_table)[k]; }
+    mesh_file::FieldRecord const& field_record(std::size_t k) const noexcept { return at<mesh_file::FieldRecord>(header().field_table)[k]; }
+
+    /// Cells of the k-th level, without copy
+    CellSetView<Dim> level(std::size_t k) const noexcept
+    {
+        auto const& r = level_record(k);
+        return {
+            r.level,
+            at<typename CellSet<Dim>::row_indices_type>(r.rows),
+            at<std::size_t>(r.row_offsets),
+            at<Interval>(r.intervals),
+            r.row_count
+        };
+    }
+
+    /// Levels copied into cell sets
+    std::vector<CellSet<Dim>> load_mesh() const
+    {
+        std::vector<CellSet<Dim>> mesh;
+        for (std::size_t k = 0; k < level_count(); ++k)
+            mesh.push_back(level(k).to_cell_set());
+        return mesh;
+    }
+
+    /// Index of the field of given name, level and topology (field_count() if not found)
+    std::size_t find_field(std::string const& name, std::size_t level, std::size_t topology) const noexcept
+    {
+        for (std::size_t k = 0; k < field_count(); ++k)
+        {
+            auto const& r = field_record(k);
+            if (name == r.name && r.level == level && r.topology == topology)
+                return k;
+        }
+        return field_count();
+    }
+
+    /// Values of the k-th field, without copy
+    template <
+        typename T
+    >
+    FieldView<T> field(std::size_t k) const
+    {
+        auto const& r = field_record(k);
+        if (r.value_size != sizeof(T))
+            throw std::runtime_error(std::string("Invalid value type for field ") + r.name);
+        return {r.level, r.topology, at<T>(r.data), r.count};
+    }
+
+    /// Ask the system to read the pages of the k-th level ahead
+    void prefetch_level(std::size_t k) const noexcept
+    {
+        auto const& r = level_record(k);
+        advise(r.rows, r.row_count * sizeof(typename CellSet<Dim>::row_indices_type));
+        advise(r.row_offsets, (r.row_count + 1) * sizeof(std::size_t));
+        advise(r.intervals, r.interval_count * sizeof(Interval));
+    }
+
+private:
+    template <typename T>
+    T const* at(std::uint64_t offset) const noexcept
+    {
+        return reinterpret_cast<T const*>(m_data + offset);
+    }
+
+    void advise(std::uint64_t offset, std::size_t size) const noexcept
+    {
+        auto const page = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+        std::uint64_t const first = offset / page * page;
+        ::madvise(const_cast<std::byte *>(m_data + first), offset + size - first, MADV_WILLNEED);
+    }
+
+    /// True if count elements of given size starting at offset lie in the file (without overflowing count * size)
+    bool in_file(std::uint64_t offset, std::uint64_t count, std::uint64_t size) const noexcept
+    {
+        return offset % mesh_file::alignment == 0
+            && offset <= m_size
+            && (size == 0 || count <= (m_size - offset) / size);
+    }
+
+    void check(std::string const& path) const
+    {
+        auto const& h = header();
+        if (!std::equal(std::begin(mesh_file::magic), std::end(mesh_file::magic), h.magic)
+            || h.version != mesh_file::version
+            || h.endianness != mesh_file::endianness
+            || h.file_size != m_size)
+            throw std::runtime_error("Invalid mesh file " + path);
+        if (h.dimension != Dim || h.interval_size != sizeof(Interval))
+            throw std::runtime_error("Incompatible mesh file " + path);
+        if (!in_file(h.level_table, h.level_count, sizeof(mesh_file::LevelRecord))
+            || !in_file(h.field_table, h.field_count, sizeof(mesh_file::FieldRecord)))
+            throw std::runtime_error("Corrupted mesh file " + path);
+
+        for (std::size_t k = 0; k < level_count(); ++k)
+        {
+            auto const& r = level_record(k);
+            // row_count < m_size is checked first so that row_count + 1 doesn't overflow
+            if (r.row_count >= m_size
+                || !in_file(r.rows, r.row_count, sizeof(typename CellSet<Dim>::row_indices_type))
+                || !in_file(r.row_offsets, r.row_count + 1, sizeof(std::size_t))
+                || !in_file(r.intervals, r.interval_count, sizeof(Interval)))
+                throw std::runtime_error("Corrupted mesh file " + path);
+
+            // The views index the intervals with the row offsets
+            auto const offsets = at<std::size_t>(r.row_offsets);
+            if (offsets[0] != 0
+                || offsets[r.row_count] != r.interval_count
+                || !std::is_sorted(offsets, offsets + r.row_count + 1))
+                throw std::runtime_error("Corrupted mesh file " + path);
+        }
+        for (std::size_t k = 0; k < field_count(); ++k)
+        {
+            auto const& r = field_record(k);
+            if (r.name[mesh_file::max_name_size] != '\0' || !in_file(r.data, r.count, r.value_size))
+                throw std::runtime_error("Corrupted mesh file " + path);
+        }
+    }
+
+    void unmap() noexcept
+    {
+        if (m_data != nullptr)
+            ::munmap(const_cast<std::byte *>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    std::byte const* m_data = nullptr;
+    std::size_t m_size = 0;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "interval.hpp"
+#include "multilevel.hpp"
+
+namespace details
+{
+    /// Indices in the stencil of the cells of the given group (cells of same level shift, in stencil order)
+    template <
+        typename Stencil,
+        typename Group
+    >
+    constexpr auto group_indices() noexcept
+    {
+        std::array<std::size_t, Group::size()> result{};
+        constexpr auto shifts = Stencil::levelShifts();
+        std::size_t k = 0;
+        for (std::size_t c = 0; c < shifts.size(); ++c)
+            if (Group::size() > 0 && shifts[c] == Group::template kcell_type<0>::levelShift())
+                result[k++] = c;
+        return result;
+    }
+
+    /// Position in the row of the cell at a relative level shift, for the i-th cell of a row starting at a
+    template <
+        std::ptrdiff_t LevelShift
+    >
+    constexpr std::ptrdiff_t level_offset(std::ptrdiff_t a, std::ptrdiff_t i) noexcept
+    {
+        if constexpr (LevelShift >= 0)
+            return i << LevelShift;
+        else
+            return ((a + i) >> -LevelShift) - (a >> -LevelShift);
+    }
+
+    /// Accumulate (or assign) the weighted values of a group of cells of same level shift on a whole row
+    template <
+        bool Assign,
+        typename Stencil,
+        typename Group,
+        typename T,
+        std::size_t N,
+        typename Field,
+        typename Value,
+        std::size_t M
+    >
+    void apply_level_group(Group group, std::array<T, N> const& weights, Field && field, Value * out, std::size_t level, Interval const& interval, std::array<std::ptrdiff_t, M> const& outer)
+    {
+        constexpr std::size_t n_cells = Group::size();
+        if constexpr (n_cells > 0)
+        {
+            constexpr std::ptrdiff_t level_shift = Group::template kcell_type<0>::levelShift();
+            constexpr auto indices = group_indices<Stencil, Group>();
+
+            std::array<Value const*, n_cells> const rows = group.apply(
+                [&] (auto... cell) { return std::array<Value const*, n_cells>{cell_pointer(cell, field, level, interval.a, outer)...}; }
+            );
+            std::array<T, n_cells> w{};
+            for (std::size_t c = 0; c < n_cells; ++c)
+                w[c] = weights[indices[c]];
+
+            std::ptrdiff_t const n = interval.b - interval.a;
+            for (std::ptrdiff_t i = 0; i < n; ++i)
+            {
+                std::ptrdiff_t const j = level_offset<level_shift>(interval.a, i);
+                Value sum = Assign ? Value(0) : out[i];
+                for (std::size_t c = 0; c < n_cells; ++c)
+                    sum += w[c] * rows[c][j];
+                out[i] = sum;
+            }
+        }
+    }
+}
+
+/**
+ * Weighted sum of a mixed-level stencil on a whole row: out(level, i, outer...) = sum_c weights[c] * field(cell c of the stencil)
+ *
+ * The cells of the stencil are grouped by level shift at compile time (see KCells::group_by_level) and the row
+ * is computed in one pass per level, so that the data of each level is accessed in one batch
+ * (strided reads for finer levels, repeated reads for coarser levels).
+ *
+ * @param stencil   Stencil (cells of possibly different level shifts)
+ * @param weights   Weight of each cell of the stencil (in stencil order)
+ * @param field     Storage accessor called as field(level, i, outer...) that returns a reference,
+ *                  cells of consecutive first index being contiguous in memory
+ * @param output    Output accessor (same requirements), written at the given level
+ * @param level     Level of the computed cells
+ * @param interval  Computed cells (step 1)
+ * @param outer     Outer indices
+ */
+template <
+    typename Stencil,
+    typename T,
+    std::size_t N,
+    typename Field,
+    typename Output,
+    typename... Outer
+>
+void mixed_level_apply(Stencil, std::array<T, N> const& weights, Field && field, Output && output, std::size_t level, Interval const& interval, Outer... outer)
+{
+    static_assert(Stencil::size() == N, "One weight per stencil cell is needed");
+    static_assert(Stencil::kcell_size() == sizeof...(Outer) + 1, "Invalid number of indices");
+    using value_type = std::decay_t<decltype(output(level, interval.a, outer...))>;
+
+    if (interval.b <= interval.a)
+        return;
+
+    std::array<std::ptrdiff_t, sizeof...(Outer)> const outer_indices{outer...};
+    value_type * out = &output(level, interval.a, outer...);
+    std::apply(
+        [&] (auto first, auto... others)
+        {
+            details::apply_level_group<true, Stencil>(first, weights, field, out, level, interval, outer_indices);
+            (details::apply_level_group<false, Stencil>(others, weights, field, out, level, interval, outer_indices), ...);
+        },
+        Stencil::group_by_level()
+    );
+}
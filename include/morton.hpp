@@ -0,0 +1,369 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "kcell.hpp"
+#include "kcellnd.hpp"
+#include "kcell_key.hpp"
+#include "cell_set.hpp"
+
+namespace details
+{
+    /// Portable (and constexpr) parallel bits deposit: scatter the low bits of x to the set bits of mask
+    constexpr std::uint64_t deposit_bits(std::uint64_t x, std::uint64_t mask) noexcept
+    {
+        std::uint64_t r = 0;
+        for (std::uint64_t bit = 1; mask != 0; bit <<= 1)
+        {
+            if (x & bit)
+                r |= mask & (~mask + 1);
+            mask &= mask - 1;
+        }
+        return r;
+    }
+
+    /// Portable (and constexpr) parallel bits extract: gather the bits of x at the set bits of mask
+    constexpr std::uint64_t extract_bits(std::uint64_t x, std::uint64_t mask) noexcept
+    {
+        std::uint64_t r = 0;
+        for (std::uint64_t bit = 1; mask != 0; bit <<= 1)
+        {
+            if (x & mask & (~mask + 1))
+                r |= bit;
+            mask &= mask - 1;
+        }
+        return r;
+    }
+
+    /// Bits deposit using BMI2 pdep when available
+    inline std::uint64_t pdep(std::uint64_t x, std::uint64_t mask) noexcept
+    {
+#if defined(__BMI2__)
+        return _pdep_u64(x, mask);
+#else
+        return deposit_bits(x, mask);
+#endif
+    }
+
+    /// Bits extract using BMI2 pext when available
+    inline std::uint64_t pext(std::uint64_t x, std::uint64_t mask) noexcept
+    {
+#if defined(__BMI2__)
+        return _pext_u64(x, mask);
+#else
+        return extract_bits(x, mask);
+#endif
+    }
+}
+
+/// Mask of the bits of the direction d in a Morton code of Bits bits per direction
+template <std::size_t Dim, std::size_t Bits = 64 / Dim>
+constexpr std::uint64_t morton_mask(std::size_t d) noexcept
+{
+    std::uint64_t mask = 0;
+    for (std::size_t b = 0; b < Bits; ++b)
+        mask |= std::uint64_t(1) << (b * Dim + d);
+    return mask;
+}
+
+/// Morton (Z-order) code of unsigned coordinates (bit b of direction d at position b * Dim + d)
+template <std::size_t Dim>
+inline std::uint64_t morton_encode(std::array<std::uint64_t, Dim> const& coords) noexcept
+{
+    std::uint64_t code = 0;
+    for (std::size_t d = 0; d < Dim; ++d)
+        code |= details::pdep(coords[d], morton_mask<Dim>(d));
+    return code;
+}
+
+/// Coordinates from a Morton code
+template <std::size_t Dim>
+inline std::array<std::uint64_t, Dim> morton_decode(std::uint64_t code) noexcept
+{
+    std::array<std::uint64_t, Dim> coords{};
+    for (std::size_t d = 0; d < Dim; ++d)
+        coords[d] = details::pext(code, morton_mask<Dim>(d));
+    return coords;
+}
+
+/** Addition of a dilated integer to the bits of the direction of given mask (other bits are kept)
+ *
+ *  Filling the holes with ones makes the carries jump over the bits of the other directions.
+ */
+constexpr std::uint64_t dilated_add(std::uint64_t code, std::uint64_t dilated, std::uint64_t mask) noexcept
+{
+    return (((code | ~mask) + dilated) & mask) | (code & ~mask);
+}
+
+/**
+ * Khalimsky coordinates and level of a cell as a Morton code
+ *
+ * Layout: the biased Khalimsky coordinates are interleaved on the coordinate_bits() * Dim
+ * lower bits, the level is stored in the level_bits() upper bits.
+ * Sorting the keys gives the cells level by level, in Z-order.
+ * Same level moves are done in Morton space using dilated integer additions.
+ */
+template <std::size_t Dim>
+struct MortonKCellKey
+{
+    using khalimsky_type = std::array<std::ptrdiff_t, Dim>;
+    using delta_type = std::array<std::uint64_t, Dim>;
+
+    static constexpr std::size_t level_bits() noexcept { return 6; }
+    static constexpr std::size_t coordinate_bits() noexcept { return (64 - level_bits()) / Dim; }
+    static constexpr std::ptrdiff_t bias() noexcept { return std::ptrdiff_t(1) << (coordinate_bits() - 1); }
+    static constexpr std::size_t level_shift() noexcept { return 64 - level_bits(); }
+    static constexpr std::size_t max_level() noexcept { return (std::size_t(1) << level_bits()) - 2; }
+
+    /// Masks of the bits of each direction
+    static constexpr std::array<std::uint64_t, Dim> masks() noexcept
+    {
+        std::array<std::uint64_t, Dim> m{};
+        for (std::size_t d = 0; d < Dim; ++d)
+            m[d] = morton_mask<Dim, coordinate_bits()>(d);
+        return m;
+    }
+
+    static constexpr std::uint64_t mask(std::size_t d) noexcept { return masks()[d]; }
+
+    std::uint64_t value = ~std::uint64_t(0);
+
+    static MortonKCellKey from_khalimsky(std::size_t level, khalimsky_type const& khalimsky) noexcept
+    {
+        assert(level <= max_level() && "Level out of range");
+        std::uint64_t v = static_cast<std::uint64_t>(level) << level_shift();
+        for (std::size_t d = 0; d < Dim; ++d)
+        {
+            assert(khalimsky[d] >= -bias() && khalimsky[d] < bias() && "Khalimsky coordinate out of range");
+            v |= details::pdep(static_cast<std::uint64_t>(khalimsky[d] + bias()), mask(d));
+        }
+        return {v};
+    }
+
+    static MortonKCellKey from_indices(std::size_t level, std::size_t topology, khalimsky_type const& indices) noexcept
+    {
+        return from_khalimsky(level, details::khalimsky_from_indices(topology, indices));
+    }
+
+    constexpr bool is_valid() const noexcept { return value != ~std::uint64_t(0); }
+
+    constexpr std::size_t level() const noexcept { return static_cast<std::size_t>(value >> level_shift()); }
+
+    std::ptrdiff_t khalimsky(std::size_t d) const noexcept
+    {
+        return static_cast<std::ptrdiff_t>(details::pext(value, mask(d))) - bias();
+    }
+
+    khalimsky_type khalimsky() const noexcept
+    {
+        khalimsky_type k{};
+        for (std::size_t d = 0; d < Dim; ++d)
+            k[d] = khalimsky(d);
+        return k;
+    }
+
+    /// Topology of the cell (the lowest bits of the code are the parities of the coordinates)
+    constexpr std::size_t topology() const noexcept
+    {
+        return static_cast<std::size_t>(value & ((std::uint64_t(1) << Dim) - 1));
+    }
+
+    khalimsky_type indices() const noexcept
+    {
+        return details::indices_from_khalimsky(khalimsky());
+    }
+
+    /// Dilated integers of a Khalimsky shift (two's complement restricted to each direction bits)
+    static constexpr delta_type delta(khalimsky_type const& shift) noexcept
+    {
+        delta_type dilated{};
+        for (std::size_t d = 0; d < Dim; ++d)
+            dilated[d] = details::deposit_bits(static_cast<std::uint64_t>(shift[d]), mask(d));
+        return dilated;
+    }
+
+    /// Dilated move from a cell of type Center to the cell of type Cell (same level shift)
+    template <
+        typename Center,
+        typename Cell
+    >
+    static constexpr delta_type delta() noexcept
+    {
+        return delta(details::khalimsky_delta<Center, Cell>());
+    }
+
+    /// Key moved by a dilated delta
+    constexpr MortonKCellKey operator+ (delta_type const& dilated) const noexcept
+    {
+        constexpr auto m = masks();
+        std::uint64_t v = value;
+        for (std::size_t d = 0; d < Dim; ++d)
+            v = dilated_add(v, dilated[d], m[d]);
+        return {v};
+    }
+
+    /// Key of the cell Cell when the current key is the cell Center (see PackedKCellKey::shift)
+    template <
+        typename Center,
+        typename Cell
+    >
+    MortonKCellKey shift(Center, Cell) const noexcept
+    {
+        if constexpr (Center::levelShift() == Cell::levelShift())
+        {
+            constexpr auto dilated = delta<Center, Cell>();
+            return *this + dilated;
+        }
+        else
+            return details::shift_key<Center, Cell>(*this);
+    }
+};
+
+template <std::size_t Dim>
+constexpr bool operator== (MortonKCellKey<Dim> const& lhs, MortonKCellKey<Dim> const& rhs) noexcept
+{
+    return lhs.value == rhs.value;
+}
+
+template <std::size_t Dim>
+constexpr bool operator!= (MortonKCellKey<Dim> const& lhs, MortonKCellKey<Dim> const& rhs) noexcept
+{
+    return lhs.value != rhs.value;
+}
+
+template <std::size_t Dim>
+constexpr bool operator< (MortonKCellKey<Dim> const& lhs, MortonKCellKey<Dim> const& rhs) noexcept
+{
+    return lhs.value < rhs.value;
+}
+
+template <std::size_t Dim>
+std::ostream & operator<< (std::ostream & out, MortonKCellKey<Dim> const& key)
+{
+    out << "MortonKCellKey(level=" << key.level() << ", khalimsky=(";
+    for (std::size_t d = 0; d < Dim; ++d)
+        out << key.khalimsky(d) << ((d < Dim - 1) ? "," : "");
+    out << "))";
+    return out;
+}
+
+/// Default number of bits per direction of the blocks of for_each_morton_block (blocks of 8^Dim cells)
+constexpr std::size_t morton_block_bits = 3;
+
+/**
+ * Call fn(first, last) for each non-empty Morton block of the cells of given topology of a CellSet, in Morton order
+ *
+ * A block gathers the cells of the same level whose Morton keys only differ by their Dim * block_bits lower bits,
+ * ie an aligned cube of 2^block_bits cells per direction in the Khalimsky index space.
+ * The keys [first, last[ of a block are sorted, so that only the block codes and the cells inside
+ * a block are sorted (the cells are bucketed by block in linear time).
+ */
+template <
+    std::size_t Dim,
+    typename Function
+>
+void for_each_morton_block(CellSet<Dim> const& set, std::size_t topology, Function && fn, std::size_t block_bits = morton_block_bits)
+{
+    using key_type = MortonKCellKey<Dim>;
+    std::size_t const block_shift = std::min<std::size_t>(Dim * block_bits, key_type::level_shift());
+
+    // Keys and their block, blocks being numbered in order of appearance
+    std::vector<key_type> keys;
+    std::vector<std::size_t> key_block;
+    std::vector<std::uint64_t> codes;
+    std::unordered_map<std::uint64_t, std::size_t> block_index;
+    keys.reserve(set.size());
+    key_block.reserve(set.size());
+    set.for_each_interval(
+        [&] (std::size_t level, Interval const& interval, auto... outer)
+        {
+            // Consecutive cells of a row mostly share their block: the map is only searched when the block changes
+            std::uint64_t last_code = 0;
+            std::size_t last_block = std::size_t(-1);
+            for (auto i = interval.a; i < interval.b; i += static_cast<std::ptrdiff_t>(interval.step))
+            {
+                auto const key = key_type::from_indices(level, topology, {i, outer...});
+                std::uint64_t const code = key.value >> block_shift;
+                if (last_block == std::size_t(-1) || code != last_code)
+                {
+                    auto const it = block_index.try_emplace(code, codes.size()).first;
+                    if (it->second == codes.size())
+                        codes.push_back(code);
+                    last_code = code;
+                    last_block = it->second;
+                }
+                keys.push_back(key);
+                key_block.push_back(last_block);
+            }
+        }
+    );
+
+    // Rank of each block in Morton order
+    std::vector<std::size_t> order(codes.size());
+    for (std::size_t b = 0; b < order.size(); ++b)
+        order[b] = b;
+    std::sort(order.begin(), order.end(), [&codes] (std::size_t l, std::size_t r) { return codes[l] < codes[r]; });
+    std::vector<std::size_t> rank(codes.size());
+    for (std::size_t r = 0; r < order.size(); ++r)
+        rank[order[r]] = r;
+
+    // Counting sort of the keys by block rank
+    std::vector<std::size_t> offsets(codes.size() + 1, 0);
+    for (auto b : key_block)
+        ++offsets[rank[b] + 1];
+    for (std::size_t r = 0; r < codes.size(); ++r)
+        offsets[r + 1] += offsets[r];
+    std::vector<key_type> sorted(keys.size());
+    {
+        std::vector<std::size_t> position(offsets.begin(), offsets.end() - 1);
+        for (std::size_t k = 0; k < keys.size(); ++k)
+            sorted[position[rank[key_block[k]]]++] = keys[k];
+    }
+
+    for (std::size_t r = 0; r < codes.size(); ++r)
+    {
+        auto const first = sorted.begin() + static_cast<std::ptrdiff_t>(offsets[r]);
+        auto const last = sorted.begin() + static_cast<std::ptrdiff_t>(offsets[r + 1]);
+        std::sort(first, last);
+        fn(first, last);
+    }
+}
+
+/// Cells of given topology of a CellSet, sorted in Morton order
+template <std::size_t Dim>
+std::vector<MortonKCellKey<Dim>> morton_order(CellSet<Dim> const& set, std::size_t topology)
+{
+    std::vector<MortonKCellKey<Dim>> keys;
+    keys.reserve(set.size());
+    for_each_morton_block(set, topology,
+        [&keys] (auto first, auto last) { keys.insert(keys.end(), first, last); }
+    );
+    return keys;
+}
+
+/// Call fn(level, indices) for each cell of given topology of a CellSet, in Morton order (see for_each_morton_block)
+template <
+    std::size_t Dim,
+    typename Function
+>
+void for_each_cell_morton(CellSet<Dim> const& set, std::size_t topology, Function && fn)
+{
+    for_each_morton_block(set, topology,
+        [&fn] (auto first, auto last)
+        {
+            for (; first != last; ++first)
+                fn(first->level(), first->indices());
+        }
+    );
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "interval.hpp"
+#include "topology.hpp"
+
+namespace details
+{
+    /// Number of coarse cells processed at once by prediction (size of its temporary rows)
+    constexpr std::size_t prediction_chunk_size = 256;
+
+    /// True if the child lies on the cell along the closed directions of the cell (even child index)
+    template <
+        typename Cell,
+        typename Child
+    >
+    constexpr bool is_coplanar_child() noexcept
+    {
+        constexpr auto cell_shift = Cell::indexShift();
+        constexpr auto child_shift = Child::indexShift();
+        for (std::size_t d = 0; d < cell_shift.size(); ++d)
+            if (!is_open(Cell::topology(), d) && child_shift[d] != 2 * cell_shift[d])
+                return false;
+        return true;
+    }
+
+    /// Children of the cell (from up()) that lie on the cell along its closed directions
+    template <
+        typename Cell
+    >
+    constexpr auto coplanar_children() noexcept
+    {
+        return Cell::up().apply(
+            [] (auto... child)
+            {
+                return (std::conditional_t<is_coplanar_child<Cell, decltype(child)>(), KCells<decltype(child)>, KCells<>>{} + ... + KCells<>{});
+            }
+        );
+    }
+
+    /** Weights of the coarse neighbours -1, 0 and 1 to predict a child of given parity along one direction
+     *
+     *  Open direction: second order centered interpolation of cell averages,
+     *  closed direction: injection for the even child and linear interpolation for the odd one.
+     */
+    constexpr std::array<double, 3> prediction_weights(bool open, std::ptrdiff_t parity) noexcept
+    {
+        if (open)
+            return parity == 0 ? std::array<double, 3>{1. / 8., 1., -1. / 8.} : std::array<double, 3>{-1. / 8., 1., 1. / 8.};
+        else
+            return parity == 0 ? std::array<double, 3>{0., 1., 0.} : std::array<double, 3>{0., 0.5, 0.5};
+    }
+
+    /// Pointer to the storage of cell (level, i, outer...) shifted by the given cell
+    template <
+        typename Cell,
+        typename Field,
+        std::size_t N
+    >
+    auto cell_pointer(Cell, Field && field, std::size_t level, std::ptrdiff_t i, std::array<std::ptrdiff_t, N> const& outer)
+    {
+        return std::apply(
+            [&] (auto... o) { return &Cell::shift(field, level, i, o...); },
+            outer
+        );
+    }
+}
+
+/**
+ * Restriction of the children (level + 1) of an interval of cells (level) of given topology
+ *
+ * Each coarse cell is the average of its children (see KCellND::up()) that lie on it along its closed directions,
+ * eg the 2^(Dim-1) coplanar children for a face, or the only coincident child for a vertex.
+ * Each coarse row is computed in one pass from contiguous reads of the children rows.
+ *
+ * @param cell      Cell giving the topology of the restricted cells
+ * @param field     Storage accessor called as field(level, i, outer...) that returns a reference,
+ *                  cells of consecutive first index being contiguous in memory
+ * @param level     Coarse level
+ * @param interval  Coarse cells to compute (step 1)
+ * @param outer     Coarse outer indices
+ */
+template <
+    typename Cell,
+    typename Field,
+    typename... Outer
+>
+void restriction(Cell cell, Field && field, std::size_t level, Interval const& interval, Outer... outer)
+{
+    static_assert(sizeof...(Outer) + 1 == Cell::size(), "Invalid number of indices");
+    using value_type = std::decay_t<decltype(field(level, interval.a, outer...))>;
+
+    constexpr auto children = details::coplanar_children<Cell>();
+    constexpr std::size_t n_children = children.size();
+    if (interval.b <= interval.a)
+        return;
+    auto const n = static_cast<std::size_t>(interval.b - interval.a);
+
+    std::array<std::ptrdiff_t, sizeof...(Outer)> const outer_indices{outer...};
+    value_type * coarse = details::cell_pointer(cell, field, level, interval.a, outer_indices);
+    auto const fine = children.apply(
+        [&] (auto... child)
+        {
+            return std::array<value_type const*, n_children>{details::cell_pointer(child, field, level, interval.a, outer_indices)...};
+        }
+    );
+
+    constexpr value_type weight = value_type(1) / static_cast<value_type>(n_children);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        value_type sum = 0;
+        for (std::size_t c = 0; c < n_children; ++c)
+            sum += fine[c][2 * i];
+        coarse[i] = weight * sum;
+    }
+}
+
+/**
+ * Prediction of the children (level + 1) of an interval of cells (level) of given topology
+ *
+ * Each child (see KCellND::up()) is interpolated from the parent and its neighbours by a tensor product
+ * of one dimensional operators depending on the topology (see details::prediction_weights).
+ * The coarse rows are first combined along the outer directions into a temporary row on the stack that is then
+ * interpolated along the first direction, so that each fine row is written in one pass.
+ * The restriction of the predicted values gives back the coarse values.
+ *
+ * @pre     The coarse neighbours (index -1 and +1 along open directions, +1 along closed directions) must be available.
+ * @param cell      Cell giving the topology of the predicted cells
+ * @param field     Storage accessor called as field(level, i, outer...) that returns a reference,
+ *                  cells of consecutive first index being contiguous in memory
+ * @param level     Coarse level
+ * @param interval  Coarse cells whose children are computed (step 1)
+ * @param outer     Coarse outer indices
+ */
+template <
+    typename Cell,
+    typename Field,
+    typename... Outer
+>
+void prediction(Cell cell, Field && field, std::size_t level, Interval const& interval, Outer... outer)
+{
+    constexpr std::size_t dim = Cell::size();
+    static_assert(sizeof...(Outer) + 1 == dim, "Invalid number of indices");
+    using value_type = std::decay_t<decltype(field(level, interval.a, outer...))>;
+
+    if (interval.b <= interval.a)
+        return;
+    auto const n = static_cast<std::size_t>(interval.b - interval.a);
+    std::array<std::ptrdiff_t, dim - 1> const outer_indices{outer...};
+    constexpr auto cell_shift = Cell::indexShift();
+    constexpr bool open_x = is_open(Cell::topology(), 0);
+    constexpr std::ptrdiff_t lower = open_x ? -1 : 0;
+
+    // Coarse rows combined along the outer directions, for each parity of the children along the outer directions,
+    // stored on the stack for chunks of at most details::prediction_chunk_size coarse cells
+    constexpr std::size_t n_parities = std::size_t(1) << (dim - 1);
+    constexpr std::size_t n_offsets = [] { std::size_t s = 1; for (std::size_t d = 1; d < dim; ++d) s *= 3; return s; }();
+    constexpr std::size_t chunk_size = details::prediction_chunk_size;
+    std::array<std::array<value_type, chunk_size + 2>, n_parities> rows;
+
+    for (std::size_t first = 0; first < n; first += chunk_size)
+    {
+        std::size_t const m = std::min(chunk_size, n - first);
+        std::ptrdiff_t const a = interval.a + static_cast<std::ptrdiff_t>(first);
+
+        for (std::size_t parity = 0; parity < n_parities; ++parity)
+        {
+            auto & row = rows[parity];
+            std::fill_n(row.begin(), m + 2, value_type(0));
+            for (std::size_t o = 0; o < n_offsets; ++o)
+            {
+                double w = 1.;
+                auto indices = outer_indices;
+                for (std::size_t d = 1, r = o; d < dim; ++d, r /= 3)
+                {
+                    auto const offset = static_cast<std::ptrdiff_t>(r % 3) - 1;
+                    w *= details::prediction_weights(is_open(Cell::topology(), d), static_cast<std::ptrdiff_t>((parity >> (d - 1)) & 1))[static_cast<std::size_t>(offset + 1)];
+                    indices[d - 1] += offset;
+                }
+                if (w == 0.)
+                    continue;
+
+                value_type const* coarse = details::cell_pointer(cell, field, level, a, indices);
+                auto const weight = static_cast<value_type>(w);
+                for (std::ptrdiff_t i = lower; i <= static_cast<std::ptrdiff_t>(m); ++i)
+                    row[static_cast<std::size_t>(i + 1)] += weight * coarse[i];
+            }
+        }
+
+        // Interpolation along the first direction
+        Cell::up().foreach(
+            [&] (auto child)
+            {
+                constexpr auto child_shift = decltype(child)::indexShift();
+                std::size_t parity = 0;
+                for (std::size_t d = 1; d < dim; ++d)
+                    parity |= static_cast<std::size_t>(child_shift[d] - 2 * cell_shift[d]) << (d - 1);
+                constexpr auto w = details::prediction_weights(open_x, child_shift[0] - 2 * Cell::indexShift()[0]);
+
+                value_type const* row = rows[parity].data() + 1;
+                value_type * fine = details::cell_pointer(child, field, level, a, outer_indices);
+                for (std::size_t i = 0; i < m; ++i)
+                {
+                    value_type v = static_cast<value_type>(w[1]) * row[i] + static_cast<value_type>(w[2]) * row[i + 1];
+                    if constexpr (open_x)
+                        v += static_cast<value_type>(w[0]) * row[static_cast<std::ptrdiff_t>(i) - 1];
+                    fine[2 * i] = v;
+                }
+            }
+        );
+    }
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+
+#include "kcell.hpp"
+#include "kcellnd.hpp"
+#include "kcell_key.hpp"
+
+#if defined(__SIZEOF_INT128__)
+/// 128 bits word for PackedKCellKey
+__extension__ typedef unsigned __int128 uint128_type;
+#endif
+
+/**
+ * Khalimsky coordinates and level of a cell packed in one unsigned integer
+ *
+ * Layout (from the least significant bits): Dim coordinates of coordinate_bits() bits each,
+ * stored with a bias (offset binary), then the level on level_bits() bits.
+ * The bias is even so that the parity of each field is the parity of the Khalimsky coordinate (ie the topology).
+ *
+ * Since the fields don't overflow, moving a cell at the same level is a single addition of a packed delta,
+ * negative shifts wrapping around as in two's complement.
+ *
+ * @tparam Dim  Dimension of the space
+ * @tparam Word Unsigned integer type (std::uint64_t or 128 bits integer)
+ */
+template <
+    std::size_t Dim,
+    typename Word = std::uint64_t
+>
+struct PackedKCellKey
+{
+    using word_type = Word;
+    using khalimsky_type = std::array<std::ptrdiff_t, Dim>;
+
+    static constexpr std::size_t level_bits() noexcept { return 6; }
+    static constexpr std::size_t coordinate_bits() noexcept { return (8 * sizeof(Word) - level_bits()) / Dim; }
+    static constexpr std::ptrdiff_t bias() noexcept { return std::ptrdiff_t(1) << (coordinate_bits() - 1); }
+    static constexpr word_type coordinate_mask() noexcept { return (word_type(1) << coordinate_bits()) - 1; }
+
+    /// Largest level (the level with all bits set is reserved for invalid keys)
+    static constexpr std::size_t max_level() noexcept { return (std::size_t(1) << level_bits()) - 2; }
+
+    static_assert(coordinate_bits() >= 4 && coordinate_bits() < 64, "Unsupported word size for this dimension");
+
+    word_type value = ~word_type(0);
+
+    /// Key from the Khalimsky coordinates of a cell
+    static constexpr PackedKCellKey from_khalimsky(std::size_t level, khalimsky_type const& khalimsky) noexcept
+    {
+        assert(level <= max_level() && "Level out of range");
+        word_type v = static_cast<word_type>(level) << (Dim * coordinate_bits());
+        for (std::size_t d = 0; d < Dim; ++d)
+        {
+            assert(khalimsky[d] >= -bias() && khalimsky[d] < bias() && "Khalimsky coordinate out of range");
+            v |= static_cast<word_type>(khalimsky[d] + bias()) << (d * coordinate_bits());
+        }
+        return {v};
+    }
+
+    /// Key from the indices of a cell of given topology
+    static constexpr PackedKCellKey from_indices(std::size_t level, std::size_t topology, khalimsky_type const& indices) noexcept
+    {
+        return from_khalimsky(level, details::khalimsky_from_indices(topology, indices));
+    }
+
+    /// Invalid key
+    static constexpr PackedKCellKey invalid() noexcept { return {}; }
+
+    constexpr bool is_valid() const noexcept { return value != ~word_type(0); }
+
+    constexpr std::size_t level() const noexcept
+    {
+        return static_cast<std::size_t>(value >> (Dim * coordinate_bits()));
+    }
+
+    constexpr std::ptrdiff_t khalimsky(std::size_t d) const noexcept
+    {
+        return static_cast<std::ptrdiff_t>((value >> (d * coordinate_bits())) & coordinate_mask()) - bias();
+    }
+
+    constexpr khalimsky_type khalimsky() const noexcept
+    {
+        khalimsky_type k{};
+        for (std::size_t d = 0; d < Dim; ++d)
+            k[d] = khalimsky(d);
+        return k;
+    }
+
+    /// Topology of the cell (bit d set if open along direction d)
+    constexpr std::size_t topology() const noexcept
+    {
+        std::size_t t = 0;
+        for (std::size_t d = 0; d < Dim; ++d)
+            t |= static_cast<std::size_t>((value >> (d * coordinate_bits())) & 1) << d;
+        return t;
+    }
+
+    /// Indices of the cell (in the index space of its topology)
+    constexpr khalimsky_type indices() const noexcept
+    {
+        return details::indices_from_khalimsky(khalimsky());
+    }
+
+    /// Packed value of a move of the given Khalimsky shift (at the same level)
+    static constexpr word_type delta(khalimsky_type const& shift) noexcept
+    {
+        word_type v = 0;
+        for (std::size_t d = 0; d < Dim; ++d)
+            v += static_cast<word_type>(shift[d]) << (d * coordinate_bits());
+        return v;
+    }
+
+    /// Packed move from a cell of type Center to the cell of type Cell (same level shift)
+    template <
+        typename Center,
+        typename Cell
+    >
+    static constexpr word_type delta() noexcept
+    {
+        return delta(details::khalimsky_delta<Center, Cell>());
+    }
+
+    /// True if the given Khalimsky shift keeps all the coordinates in range (ie the packed delta doesn't carry between fields)
+    constexpr bool can_move(khalimsky_type const& shift) const noexcept
+    {
+        for (std::size_t d = 0; d < Dim; ++d)
+        {
+            std::ptrdiff_t const k = khalimsky(d) + shift[d];
+            if (k < -bias() || k >= bias())
+                return false;
+        }
+        return true;
+    }
+
+    /// Key moved by a packed delta
+    constexpr PackedKCellKey operator+ (word_type d) const noexcept { return {value + d}; }
+
+    /** Key of the cell Cell when the current key is the cell Center
+     *
+     *  For cells of same level shift, this is a single addition of a constant without unpacking.
+     *  Otherwise, the indices of the origin cell are recovered by inverting Center::shift,
+     *  shifted by Cell::shift and packed again (see details::shift_key).
+     */
+    template <
+        typename Center,
+        typename Cell
+    >
+    constexpr PackedKCellKey shift(Center, Cell) const noexcept
+    {
+        if constexpr (Center::levelShift() == Cell::levelShift())
+        {
+            assert(can_move(details::khalimsky_delta<Center, Cell>()) && "Khalimsky coordinate out of range");
+            return *this + delta<Center, Cell>();
+        }
+        else
+            return details::shift_key<Center, Cell>(*this);
+    }
+};
+
+template <std::size_t Dim, typename Word>
+constexpr bool operator== (PackedKCellKey<Dim, Word> const& lhs, PackedKCellKey<Dim, Word> const& rhs) noexcept
+{
+    return lhs.value == rhs.value;
+}
+
+template <std::size_t Dim, typename Word>
+constexpr bool operator!= (PackedKCellKey<Dim, Word> const& lhs, PackedKCellKey<Dim, Word> const& rhs) noexcept
+{
+    return lhs.value != rhs.value;
+}
+
+template <std::size_t Dim, typename Word>
+std::ostream & operator<< (std::ostream & out, PackedKCellKey<Dim, Word> const& key)
+{
+    out << "PackedKCellKey(level=" << key.level() << ", khalimsky=(";
+    for (std::size_t d = 0; d < Dim; ++d)
+        out << key.khalimsky(d) << ((d < Dim - 1) ? "," : "");
+    out << "))";
+    return out;
+}
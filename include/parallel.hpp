@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "arena.hpp"
+
+/// Number of threads used by default by the parallel drivers
+inline std::size_t default_thread_count() noexcept
+{
+    return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+}
+
+/**
+ * Call fn(i) for each i in [begin, end[ using n_threads threads
+ *
+ * The range is split in contiguous chunks of (almost) equal size, one per thread.
+ * The calling thread processes the first chunk.
+ * The workers allocate from the memory resource of the calling thread (see details::CellSetArena).
+ */
+template <
+    typename Function
+>
+void parallel_for(std::size_t begin, std::size_t end, Function && fn, std::size_t n_threads = default_thread_count())
+{
+    if (end <= begin)
+        return;
+
+    n_threads = std::max<std::size_t>(1, std::min(n_threads, end - begin));
+    std::size_t const chunk = (end - begin) / n_threads;
+    std::size_t const remainder = (end - begin) % n_threads;
+
+    auto task = [&fn, resource = details::thread_resource()] (std::size_t first, std::size_t last)
+    {
+        details::ScopedThreadResource scope(resource);
+        for (std::size_t i = first; i < last; ++i)
+            fn(i);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(n_threads - 1);
+    std::size_t first = begin + chunk + (remainder > 0 ? 1 : 0);
+    for (std::size_t t = 1; t < n_threads; ++t)
+    {
+        std::size_t const last = first + chunk + (t < remainder ? 1 : 0);
+        threads.emplace_back(task, first, last);
+        first = last;
+    }
+
+    task(begin, begin + chunk + (remainder > 0 ? 1 : 0));
+
+    for (auto & thread : threads)
+        thread.join();
+}
+
+namespace details
+{
+    /// Range of tasks [begin, end[ owned by a worker, that other workers can steal from
+    struct TaskRange
+    {
+        std::mutex mutex;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+}
+
+/**
+ * Call fn(i) for each i in [0, n_tasks[ using n_threads threads with work stealing
+ *
+ * Each thread starts with a contiguous range of tasks that it processes from the front.
+ * When its range is empty, it steals the second half of the remaining tasks of another thread.
+ * This balances the load when the task durations are uneven.
+ * The workers allocate from the memory resource of the calling thread (see details::CellSetArena).
+ */
+template <
+    typename Function
+>
+void work_stealing_for(std::size_t n_tasks, Function && fn, std::size_t n_threads = default_thread_count())
+{
+    if (n_tasks == 0)
+        return;
+
+    n_threads = std::max<std::size_t>(1, std::min(n_threads, n_tasks));
+    std::vector<details::TaskRange> ranges(n_threads);
+    for (std::size_t t = 0; t < n_threads; ++t)
+    {
+        ranges[t].begin = t * n_tasks / n_threads;
+        ranges[t].end = (t + 1) * n_tasks / n_threads;
+    }
+
+    auto worker = [&ranges, &fn, n_threads, resource = details::thread_resource()] (std::size_t t)
+    {
+        details::ScopedThreadResource scope(resource);
+        auto & own = ranges[t];
+        while (true)
+        {
+            // Process own tasks
+            std::size_t task = std::size_t(-1);
+            {
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (own.begin < own.end)
+                    task = own.begin++;
+            }
+            if (task != std::size_t(-1))
+            {
+                fn(task);
+                continue;
+            }
+
+            // Steal half of the remaining tasks of the first non-empty victim
+            bool stolen = false;
+            for (std::size_t v = 1; v < n_threads && !stolen; ++v)
+            {
+                auto & victim = ranges[(t + v) % n_threads];
+                std::size_t begin, end;
+                {
+                    std::lock_guard<std::mutex> lock(victim.mutex);
+                    if (victim.begin >= victim.end)
+                        continue;
+                    end = victim.end;
+                    begin = victim.end - (victim.end - victim.begin + 1) / 2;
+                    victim.end = begin;
+                }
+                std::lock_guard<std::mutex> lock(own.mutex);
+                own.begin = begin;
+                own.end = end;
+                stolen = true;
+            }
+
+            if (!stolen)
+                return;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(n_threads - 1);
+    for (std::size_t t = 1; t < n_threads; ++t)
+        threads.emplace_back(worker, t);
+
+    worker(0);
+
+    for (auto & thread : threads)
+        thread.join();
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <tuple>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "box.hpp"
+#include "interval.hpp"
+#include "instrumentation.hpp"
+
+/**
+ * Periodic domain
+ *
+ * The domain is given by a box at a reference level and is scaled to the other levels.
+ * Only the periodic directions are wrapped, the other ones remain an infinite lattice.
+ *
+ * @tparam Dim  Dimension of the space
+ */
+template <
+    std::size_t Dim
+>
+struct Periodicity
+{
+    std::size_t level;
+    Box<Dim> box;
+    std::array<bool, Dim> periodic;
+
+    /// First index of the domain along direction d at level l
+    constexpr std::ptrdiff_t min(std::size_t d, std::size_t l) const noexcept
+    {
+        return details::bitwise_shift(box.min_corner[d], static_cast<std::ptrdiff_t>(l) - static_cast<std::ptrdiff_t>(level));
+    }
+
+    /// Number of cells of the domain along direction d at level l
+    constexpr std::ptrdiff_t extent(std::size_t d, std::size_t l) const noexcept
+    {
+        return details::bitwise_shift(box.max_corner[d], static_cast<std::ptrdiff_t>(l) - static_cast<std::ptrdiff_t>(level)) - min(d, l);
+    }
+};
+
+namespace details
+{
+    /// Branchless wrap of an index in [min, min + extent[ (the index must be less than one extent away)
+    constexpr std::ptrdiff_t wrap(std::ptrdiff_t i, std::ptrdiff_t min, std::ptrdiff_t extent) noexcept
+    {
+        return i + extent * (static_cast<std::ptrdiff_t>(i < min) - static_cast<std::ptrdiff_t>(i >= min + extent));
+    }
+
+    /// True if the 1D cell may move a cell of the domain outside of it (the domain being aligned on the coarser level)
+    template <typename Cell>
+    constexpr bool may_leave_domain() noexcept
+    {
+        if constexpr (Cell::levelShift() >= 0)
+            return Cell::indexShift() < 0 || Cell::indexShift() >= (std::ptrdiff_t(1) << Cell::levelShift());
+        else
+            return Cell::indexShift() != 0;
+    }
+}
+
+/** Indices of the cell Cell from the origin cell of given indices, wrapped in the periodic directions
+ *
+ *  The wrap is compile-time removed in the directions where the cell cannot leave the domain.
+ */
+template <
+    typename Cell,
+    std::size_t Dim
+>
+constexpr std::array<std::ptrdiff_t, Dim> periodic_shift(Cell, Periodicity<Dim> const& periodicity, std::size_t level, std::array<std::ptrdiff_t, Dim> indices) noexcept
+{
+    static_assert(Cell::size() == Dim, "Dimension mismatch between the cell and the domain");
+    std::size_t const shifted_level = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(level) + Cell::levelShift());
+    Cell::enumerate(
+        [&] (auto d, auto cell)
+        {
+            indices[d] = cell.shift(indices[d]);
+            if constexpr (details::may_leave_domain<decltype(cell)>())
+                if (periodicity.periodic[d])
+                    indices[d] = details::wrap(indices[d], periodicity.min(d, shifted_level), periodicity.extent(d, shifted_level));
+        }
+    );
+    return indices;
+}
+
+/// Call fn(level, indices...) for each cell of the stencil from the origin cell of given indices, wrapped in the periodic directions
+template <
+    typename Stencil,
+    std::size_t Dim,
+    typename Function,
+    typename... Index
+>
+constexpr void periodic_shift(Stencil stencil, Periodicity<Dim> const& periodicity, Function && fn, std::size_t level, Index... index)
+{
+    static_assert(sizeof...(Index) == Dim, "Invalid number of indices");
+    stencil.foreach(
+        [&] (auto cell)
+        {
+            std::apply(
+                [&] (auto... i) { fn(static_cast<std::size_t>(static_cast<std::ptrdiff_t>(level) + cell.levelShift()), i...); },
+                periodic_shift(cell, periodicity, level, {static_cast<std::ptrdiff_t>(index)...})
+            );
+        }
+    );
+}
+
+/**
+ * Apply a stencil on the cells of an interval of a periodic domain
+ *
+ * Using the stencil footprint (see KCells::haloWidth), the interval is split in an interior part
+ * where the stencil is applied as on an infinite lattice (stencil.shift(fn, level, interval, outer...))
+ * and boundary cells where the shifted indices are wrapped (see periodic_shift).
+ * The rows whose outer indices are close to a periodic boundary are entirely processed cell by cell.
+ *
+ * @param fn    Called as fn(level, i, outer...) where i is an Interval (interior) or an index (boundary)
+ */
+template <
+    typename Stencil,
+    std::size_t Dim,
+    typename Function,
+    typename... Outer
+>
+void periodic_apply(Stencil stencil, Periodicity<Dim> const& periodicity, Function && fn, std::size_t level, Interval const& interval, Outer... outer)
+{
+    static_assert(sizeof...(Outer) + 1 == Dim, "Invalid number of indices");
+    constexpr auto halo = Stencil::haloWidth();
+    KSPACE_COUNT(StencilDriver, Stencil, Stencil::size() * instrumentation::cell_count(interval), instrumentation::cell_count(interval), 0);
+
+    auto const boundary = [&] (std::ptrdiff_t first, std::ptrdiff_t last)
+    {
+        for (std::ptrdiff_t i = first; i < last; i += static_cast<std::ptrdiff_t>(interval.step))
+            periodic_shift(stencil, periodicity, fn, level, i, outer...);
+    };
+
+    // Is the row far enough from the periodic boundaries of the outer directions?
+    std::array<std::ptrdiff_t, Dim> const indices{0, static_cast<std::ptrdiff_t>(outer)...};
+    for (std::size_t d = 1; d < Dim; ++d)
+        if (periodicity.periodic[d]
+            && (indices[d] - halo[0][d] < periodicity.min(d, level)
+                || indices[d] + halo[1][d] >= periodicity.min(d, level) + periodicity.extent(d, level)))
+        {
+            boundary(interval.a, interval.b);
+            return;
+        }
+
+    Interval interior = interval;
+    if (periodicity.periodic[0])
+        interior = clip(interval,
+                        periodicity.min(0, level) + halo[0][0],
+                        periodicity.min(0, level) + periodicity.extent(0, level) - halo[1][0]);
+
+    boundary(interval.a, interior.a);
+    if (interior.a < interior.b)
+        stencil.shift(fn, level, interior, outer...);
+    boundary(interior.b, interval.b);
+}
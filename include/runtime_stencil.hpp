@@ -0,0 +1,349 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "interval.hpp"
+#include "instrumentation.hpp"
+
+/**
+ * Type-erased stencil: the offset and topology table of any KCells
+ *
+ * A runtime stencil can be chosen from an input file without instantiating the code of
+ * every possible KCells type. It is applied by a fixed set of row kernels (see runtime_apply)
+ * that only depend on the value type, so that the number of instantiations does not grow
+ * with the number of operators.
+ *
+ * @tparam Dim  Dimension of the space
+ */
+template <
+    std::size_t Dim
+>
+class RuntimeStencil
+{
+public:
+    /// One cell of the stencil
+    struct Entry
+    {
+        std::ptrdiff_t level_shift;
+        std::array<std::ptrdiff_t, Dim> index_shift;
+        std::size_t topology;
+
+        friend bool operator== (Entry const& lhs, Entry const& rhs) noexcept
+        {
+            return lhs.level_shift == rhs.level_shift && lhs.index_shift == rhs.index_shift && lhs.topology == rhs.topology;
+        }
+    };
+
+    /// Cells of same level shift (as positions in the stencil)
+    struct Group
+    {
+        std::ptrdiff_t level_shift;
+        std::vector<std::size_t> cells;
+    };
+
+    RuntimeStencil() = default;
+
+    /// From the cells of a compile-time stencil (keeps the order)
+    template <typename... T>
+    RuntimeStencil(KCells<T...>)
+        : RuntimeStencil(std::vector<Entry>{Entry{T::levelShift(), T::indexShift(), T::topology()}...})
+    {
+        static_assert(sizeof...(T) == 0 || KCells<T...>::kcell_size() == Dim, "Invalid stencil dimension");
+    }
+
+    /// From a single cell
+    template <typename... T>
+    RuntimeStencil(KCellND<T...>)
+        : RuntimeStencil(KCells<KCellND<T...>>{})
+    {
+    }
+
+    /// From a table of cells
+    explicit RuntimeStencil(std::vector<Entry> entries)
+        : m_entries(std::move(entries))
+    {
+        std::vector<std::ptrdiff_t> shifts;
+        for (auto const& e : m_entries)
+            shifts.push_back(e.level_shift);
+        std::sort(shifts.begin(), shifts.end());
+        shifts.erase(std::unique(shifts.begin(), shifts.end()), shifts.end());
+
+        for (auto s : shifts)
+        {
+            Group group{s, {}};
+            for (std::size_t c = 0; c < m_entries.size(); ++c)
+                if (m_entries[c].level_shift == s)
+                    group.cells.push_back(c);
+            m_groups.push_back(std::move(group));
+        }
+    }
+
+    /// Number of cells
+    std::size_t size() const noexcept { return m_entries.size(); }
+
+    /// Cells of the stencil
+    std::vector<Entry> const& entries() const noexcept { return m_entries; }
+    Entry const& operator[] (std::size_t c) const noexcept { return m_entries[c]; }
+
+    /// Cells grouped by increasing level shift
+    std::vector<Group> const& groups() const noexcept { return m_groups; }
+
+    /// Minimal and maximal level shifts
+    std::ptrdiff_t minLevelShift() const noexcept { return m_groups.empty() ? 0 : m_groups.front().level_shift; }
+    std::ptrdiff_t maxLevelShift() const noexcept { return m_groups.empty() ? 0 : m_groups.back().level_shift; }
+
+    /// Topologies touched by the cells: the t-th element is true if a cell has topology t
+    std::array<bool, (std::size_t(1) << Dim)> topologies() const noexcept
+    {
+        std::array<bool, (std::size_t(1) << Dim)> result{};
+        for (auto const& e : m_entries)
+            result[e.topology] = true;
+        return result;
+    }
+
+    /// Cells of given topology (keeps the order)
+    RuntimeStencil withTopology(std::size_t topology) const
+    {
+        std::vector<Entry> result;
+        for (auto const& e : m_entries)
+            if (e.topology == topology)
+                result.push_back(e);
+        return RuntimeStencil(std::move(result));
+    }
+
+    /// Concatenation
+    friend RuntimeStencil operator+ (RuntimeStencil const& lhs, RuntimeStencil const& rhs)
+    {
+        std::vector<Entry> result(lhs.m_entries);
+        result.insert(result.end(), rhs.m_entries.begin(), rhs.m_entries.end());
+        return RuntimeStencil(std::move(result));
+    }
+
+    friend bool operator== (RuntimeStencil const& lhs, RuntimeStencil const& rhs) noexcept
+    {
+        return lhs.m_entries == rhs.m_entries;
+    }
+
+    friend bool operator!= (RuntimeStencil const& lhs, RuntimeStencil const& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+    /// Call fn(level, index...) for each cell of the stencil shifted from the given cell (or interval)
+    template <
+        typename Function,
+        typename... Index,
+        typename = std::enable_if_t<sizeof...(Index) == Dim>
+    >
+    void shift(Function && fn, std::size_t level, Index const& ... index) const
+    {
+        for (auto const& e : m_entries)
+            shift_entry(e, fn, level, std::make_index_sequence<Dim>{}, index...);
+    }
+
+private:
+    template <
+        typename Function,
+        std::size_t... D,
+        typename... Index
+    >
+    static void shift_entry(Entry const& e, Function && fn, std::size_t level, std::index_sequence<D...>, Index const& ... index)
+    {
+        fn(static_cast<std::size_t>(static_cast<std::ptrdiff_t>(level) + e.level_shift), details::shift(index, e.index_shift[D], e.level_shift)...);
+    }
+
+    std::vector<Entry> m_entries;
+    std::vector<Group> m_groups;
+};
+
+template <
+    std::size_t Dim
+>
+std::ostream& operator<< (std::ostream& out, RuntimeStencil<Dim> const& stencil)
+{
+    out << "RuntimeStencil{";
+    for (std::size_t c = 0; c < stencil.size(); ++c)
+    {
+        auto const& e = stencil[c];
+        out << (c > 0 ? ", " : "") << "(level_shift=" << e.level_shift << ",index_shift=";
+        for (std::size_t d = 0; d < Dim; ++d)
+            out << (d > 0 ? "," : "[") << e.index_shift[d];
+        out << "],topology=" << e.topology << ")";
+    }
+    return out << "}";
+}
+
+/// Runtime stencil of a compile-time stencil
+template <
+    typename Stencil
+>
+auto make_runtime_stencil(Stencil stencil)
+{
+    return RuntimeStencil<Stencil::kcell_size()>(stencil);
+}
+
+namespace details
+{
+    /// Largest number of cells of a row kernel (eg a 3x3x3 neighbourhood)
+    constexpr std::size_t max_runtime_kernel_size = 27;
+
+    /// Row kernel: out[i] (+)= sum_c weights[c] * rows[c][i * stride]
+    template <typename Value>
+    using runtime_row_kernel = void (*)(Value const* const* rows, Value const* weights, std::ptrdiff_t stride, Value * out, std::ptrdiff_t n, bool assign);
+
+    /// Row kernel of N cells: the cell loop is unrolled so that the row loop vectorizes
+    template <
+        typename Value,
+        std::size_t N
+    >
+    void runtime_row_kernel_n(Value const* const* rows, Value const* weights, std::ptrdiff_t stride, Value * out, std::ptrdiff_t n, bool assign)
+    {
+        std::array<Value const*, N> r{};
+        std::array<Value, N> w{};
+        for (std::size_t c = 0; c < N; ++c)
+        {
+            r[c] = rows[c];
+            w[c] = weights[c];
+        }
+
+        if (stride == 1)
+        {
+            for (std::ptrdiff_t i = 0; i < n; ++i)
+            {
+                Value sum = assign ? Value(0) : out[i];
+                for (std::size_t c = 0; c < N; ++c)
+                    sum += w[c] * r[c][i];
+                out[i] = sum;
+            }
+        }
+        else
+        {
+            for (std::ptrdiff_t i = 0; i < n; ++i)
+            {
+                Value sum = assign ? Value(0) : out[i];
+                for (std::size_t c = 0; c < N; ++c)
+                    sum += w[c] * r[c][i * stride];
+                out[i] = sum;
+            }
+        }
+    }
+
+    template <
+        typename Value,
+        std::size_t... N
+    >
+    constexpr auto make_runtime_row_kernels(std::index_sequence<N...>) noexcept
+    {
+        return std::array<runtime_row_kernel<Value>, sizeof...(N)>{&runtime_row_kernel_n<Value, N>...};
+    }
+
+    /// Row kernels of 0 to max_runtime_kernel_size cells, instantiated once per value type
+    template <
+        typename Value
+    >
+    inline constexpr auto runtime_row_kernels = make_runtime_row_kernels<Value>(std::make_index_sequence<max_runtime_kernel_size + 1>{});
+
+    /// Pointer to the storage of cell (level, i, outer...) shifted by the given cell of a runtime stencil
+    template <
+        typename Entry,
+        typename Field,
+        std::size_t N,
+        std::size_t... D
+    >
+    auto cell_pointer(Entry const& e, Field && field, std::size_t level, std::ptrdiff_t i, std::array<std::ptrdiff_t, N> const& outer, std::index_sequence<D...>)
+    {
+        return &field(
+            static_cast<std::size_t>(static_cast<std::ptrdiff_t>(level) + e.level_shift),
+            details::shift(i, e.index_shift[0], e.level_shift),
+            details::shift(outer[D], e.index_shift[D + 1], e.level_shift)...
+        );
+    }
+}
+
+/**
+ * Weighted sum of a runtime stencil on a whole row: out(level, i, outer...) = sum_c weights[c] * field(cell c of the stencil)
+ *
+ * Runtime counterpart of mixed_level_apply: the cells are processed by group of same level shift,
+ * each group by chunks of at most details::max_runtime_kernel_size cells through the kernel of the chunk size.
+ * The kernels are only instantiated per value type, whatever the stencil.
+ *
+ * @param stencil   Runtime stencil (cells of possibly different level shifts)
+ * @param weights   Weight of each cell of the stencil (in stencil order)
+ * @param field     Storage accessor called as field(level, i, outer...) that returns a reference,
+ *                  cells of consecutive first index being contiguous in memory
+ * @param output    Output accessor (same requirements), written at the given level
+ * @param level     Level of the computed cells
+ * @param interval  Computed cells (step 1)
+ * @param outer     Outer indices
+ */
+template <
+    std::size_t Dim,
+    typename Value,
+    typename Field,
+    typename Output,
+    typename... Outer
+>
+void runtime_apply(RuntimeStencil<Dim> const& stencil, std::vector<Value> const& weights, Field && field, Output && output, std::size_t level, Interval const& interval, Outer... outer)
+{
+    static_assert(Dim == sizeof...(Outer) + 1, "Invalid number of indices");
+    static_assert(std::is_same_v<std::decay_t<decltype(output(level, interval.a, outer...))>, Value>, "Weights and output must have the same value type");
+    assert(weights.size() == stencil.size() && "One weight per stencil cell is needed");
+
+    if (interval.b <= interval.a)
+        return;
+    KSPACE_COUNT(StencilDriver, RuntimeStencil<Dim>, stencil.size() * instrumentation::cell_count(interval), instrumentation::cell_count(interval), 0);
+
+    constexpr std::size_t chunk = details::max_runtime_kernel_size;
+    auto const& kernels = details::runtime_row_kernels<Value>;
+    std::array<std::ptrdiff_t, sizeof...(Outer)> const outer_indices{outer...};
+    std::ptrdiff_t const n = interval.b - interval.a;
+    Value * out = &output(level, interval.a, outer...);
+
+    std::array<Value const*, chunk> rows{};
+    std::array<Value, chunk> w{};
+    bool assign = true;
+    for (auto const& group : stencil.groups())
+    {
+        for (std::size_t first = 0; first < group.cells.size(); first += chunk)
+        {
+            std::size_t const count = std::min(chunk, group.cells.size() - first);
+            for (std::size_t c = 0; c < count; ++c)
+            {
+                auto const cell = group.cells[first + c];
+                rows[c] = details::cell_pointer(stencil[cell], field, level, interval.a, outer_indices, std::make_index_sequence<sizeof...(Outer)>{});
+                w[c] = weights[cell];
+            }
+
+            if (group.level_shift >= 0)
+                kernels[count](rows.data(), w.data(), std::ptrdiff_t(1) << group.level_shift, out, n, assign);
+            else
+            {
+                // Coarser cells: repeated reads, no constant stride
+                for (std::ptrdiff_t i = 0; i < n; ++i)
+                {
+                    std::ptrdiff_t const j = ((interval.a + i) >> -group.level_shift) - (interval.a >> -group.level_shift);
+                    Value sum = assign ? Value(0) : out[i];
+                    for (std::size_t c = 0; c < count; ++c)
+                        sum += w[c] * rows[c][j];
+                    out[i] = sum;
+                }
+            }
+            assign = false;
+        }
+    }
+
+    if (assign)
+        std::fill(out, out + n, Value(0));
+}
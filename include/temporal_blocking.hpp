@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "kcells.hpp"
+#include "box.hpp"
+#include "parallel.hpp"
+
+namespace details
+{
+    /// Call fn(level, interval, outer...) for each row of the box in parallel
+    template <
+        std::size_t Dim,
+        typename Function
+    >
+    void parallel_for_each_row(Box<Dim> const& box, Function && fn, std::size_t n_threads)
+    {
+        if (box.empty())
+            return;
+
+        parallel_for(0, box.row_count(),
+            [&] (std::size_t r)
+            {
+                std::apply(
+                    [&] (auto... outer) { fn(box.interval(0), outer...); },
+                    box.row_indices(r)
+                );
+            },
+            n_threads
+        );
+    }
+
+    /// Call fn(interval, outer...) for each row of the box, in order
+    template <
+        std::size_t Dim,
+        typename Function
+    >
+    void for_each_row(Box<Dim> const& box, Function && fn)
+    {
+        if (box.empty())
+            return;
+
+        for (std::size_t r = 0; r < box.row_count(); ++r)
+            std::apply(
+                [&] (auto... outer) { fn(box.interval(0), outer...); },
+                box.row_indices(r)
+            );
+    }
+
+    /// Number of tiled directions: all but the contiguous one (direction 0), except in 1D and 2D where every direction is tiled
+    template <std::size_t Dim>
+    constexpr std::size_t tiled_directions() noexcept
+    {
+        return Dim >= 3 ? Dim - 1 : Dim;
+    }
+}
+
+/**
+ * Tile width (along each tiled direction) so that a tile and its skewed extension fit in the given cache size
+ *
+ * The tiles are cut along the last details::tiled_directions() directions: a tile of width w spans
+ * (w + n_sweeps * radius) cells along each of them, and the whole box along the other ones.
+ *
+ * @param box               Updated cells
+ * @param n_sweeps          Number of sweeps fused in each tile
+ * @param radius            Stencil radius along the tiled directions
+ * @param bytes_per_cell    Bytes accessed per cell and per sweep (eg 2 * sizeof(double) for Jacobi)
+ * @param cache_bytes       Targeted cache size
+ */
+template <
+    std::size_t Dim
+>
+std::size_t default_tile_width(Box<Dim> const& box, std::size_t n_sweeps, std::ptrdiff_t radius, std::size_t bytes_per_cell, std::size_t cache_bytes = std::size_t(1) << 20) noexcept
+{
+    constexpr std::size_t first_tiled = Dim - details::tiled_directions<Dim>();
+
+    std::size_t untiled_bytes = bytes_per_cell;
+    std::size_t largest = 1;
+    for (std::size_t d = 0; d < Dim; ++d)
+        if (d < first_tiled)
+            untiled_bytes *= std::max<std::size_t>(1, box.shape(d));
+        else
+            largest = std::max(largest, box.shape(d));
+
+    auto const skew = n_sweeps * static_cast<std::size_t>(std::max<std::ptrdiff_t>(0, radius));
+    auto fits = [&] (std::size_t width)
+    {
+        std::size_t bytes = untiled_bytes;
+        for (std::size_t d = first_tiled; d < Dim; ++d)
+        {
+            bytes *= width + skew;
+            if (bytes > cache_bytes)
+                return false;
+        }
+        return true;
+    };
+
+    std::size_t width = 1;
+    while (width < largest && fits(width + 1))
+        ++width;
+    return width;
+}
+
+/**
+ * Apply n_sweeps Jacobi-like sweeps of a stencil using temporal blocking
+ *
+ * The box is cut in tiles along its last details::tiled_directions() directions (all but the contiguous one in 3D and above)
+ * and all the sweeps are applied to a tile before it is released. Each sweep is shifted backward by the stencil radius
+ * along the tiled directions (tiles skewed in time), so that every dependency of a tile lies in the tile itself or in tiles
+ * of lower indices along each direction. The tiles are thus processed as a wavefront: one set of n_threads workers claims
+ * the tiles in order of the sum of their indices and a tile only waits for its predecessors along each direction.
+ *
+ * The kernel must read from one buffer and write to another one depending on the sweep parity (double buffering):
+ * with this skewing, two buffers are enough and the result of the last sweep lies in buffer n_sweeps % 2.
+ * The kernel is called concurrently for different tiles (and sweeps).
+ *
+ * @param stencil       Stencil applied by the kernel (only its halo width is used to get the radius)
+ * @param box           Updated cells
+ * @param level         Level passed to the kernel
+ * @param n_sweeps      Number of sweeps
+ * @param fn            Kernel called as fn(sweep, level, interval, outer_indices...) for a whole row
+ * @param tile_width    Number of cells per tile along each tiled direction (see default_tile_width if 0)
+ */
+template <
+    typename Stencil,
+    std::size_t Dim,
+    typename Function
+>
+void temporal_blocking(Stencil, Box<Dim> const& box, std::size_t level, std::size_t n_sweeps, Function && fn, std::size_t tile_width = 0, std::size_t n_threads = default_thread_count())
+{
+    static_assert(Stencil::kcell_size() == Dim, "Dimension mismatch between the stencil and the box");
+    static_assert(Stencil::apply([] (auto... cell) { return ((cell.levelShift() == 0) && ... && true); }), "Temporal blocking needs a stencil with no level shift");
+
+    constexpr std::size_t n_tiled = details::tiled_directions<Dim>();
+    constexpr std::size_t first_tiled = Dim - n_tiled;
+    constexpr auto halo = Stencil::haloWidth();
+
+    if (box.empty() || n_sweeps == 0)
+        return;
+
+    std::array<std::ptrdiff_t, Dim> radius{};
+    std::ptrdiff_t max_radius = 0;
+    for (std::size_t d = first_tiled; d < Dim; ++d)
+    {
+        radius[d] = std::max(halo[0][d], halo[1][d]);
+        max_radius = std::max(max_radius, radius[d]);
+    }
+
+    if (tile_width == 0)
+        tile_width = default_tile_width(box, n_sweeps, max_radius, 2 * sizeof(double));
+    auto const width = static_cast<std::ptrdiff_t>(tile_width);
+
+    // Tiles along each tiled direction (the last ones only hold the end of the skewed sweeps)
+    std::array<std::size_t, Dim> n_tiles{};
+    std::array<std::size_t, Dim> stride{};
+    std::size_t tile_count = 1;
+    for (std::size_t d = first_tiled; d < Dim; ++d)
+    {
+        auto const extent = static_cast<std::ptrdiff_t>(box.shape(d)) + radius[d] * static_cast<std::ptrdiff_t>(n_sweeps - 1);
+        n_tiles[d] = static_cast<std::size_t>((extent + width - 1) / width);
+        stride[d] = tile_count;
+        tile_count *= n_tiles[d];
+    }
+
+    auto tile_indices = [&] (std::size_t t)
+    {
+        std::array<std::size_t, Dim> k{};
+        for (std::size_t d = first_tiled; d < Dim; ++d)
+        {
+            k[d] = t % n_tiles[d];
+            t /= n_tiles[d];
+        }
+        return k;
+    };
+
+    // Tiles sorted by wavefront (sum of the tile indices)
+    std::vector<std::size_t> order(tile_count);
+    {
+        std::vector<std::size_t> wavefront(tile_count);
+        for (std::size_t t = 0; t < tile_count; ++t)
+        {
+            auto const k = tile_indices(t);
+            for (std::size_t d = first_tiled; d < Dim; ++d)
+                wavefront[t] += k[d];
+            order[t] = t;
+        }
+        std::stable_sort(order.begin(), order.end(), [&wavefront] (std::size_t l, std::size_t r) { return wavefront[l] < wavefront[r]; });
+    }
+
+    auto process_tile = [&] (std::size_t t)
+    {
+        auto const k = tile_indices(t);
+        for (std::size_t s = 0; s < n_sweeps; ++s)
+        {
+            Box<Dim> tile = box;
+            for (std::size_t d = first_tiled; d < Dim; ++d)
+            {
+                auto const start = box.min_corner[d] + static_cast<std::ptrdiff_t>(k[d]) * width - radius[d] * static_cast<std::ptrdiff_t>(s);
+                tile.min_corner[d] = std::max(box.min_corner[d], start);
+                tile.max_corner[d] = std::min(box.max_corner[d], start + width);
+            }
+            details::for_each_row(tile, [&] (Interval const& interval, auto... outer) { fn(s, level, interval, outer...); });
+        }
+    };
+
+    std::vector<std::atomic<bool>> done(tile_count);
+    for (auto & d : done)
+        d.store(false, std::memory_order_relaxed);
+    std::atomic<std::size_t> next{0};
+
+    n_threads = std::max<std::size_t>(1, std::min(n_threads, tile_count));
+    parallel_for(0, n_threads,
+        [&] (std::size_t)
+        {
+            // Tiles are claimed in wavefront order: the predecessors of a tile are already claimed
+            for (std::size_t i = next.fetch_add(1, std::memory_order_relaxed); i < tile_count; i = next.fetch_add(1, std::memory_order_relaxed))
+            {
+                std::size_t const t = order[i];
+                auto const k = tile_indices(t);
+                for (std::size_t d = first_tiled; d < Dim; ++d)
+                    if (k[d] > 0)
+                        while (!done[t - stride[d]].load(std::memory_order_acquire))
+                            std::this_thread::yield();
+
+                process_tile(t);
+                done[t].store(true, std::memory_order_release);
+            }
+        },
+        n_threads
+    );
+}
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "interval.hpp"
+#include "cell_set.hpp"
+#include "kcell.hpp"
+#include "topology.hpp"
+#include "runtime_stencil.hpp"
+
+/// Field to write: values are read through fn(level, i, outer...) (see KCell::shift)
+template <
+    typename Function
+>
+struct NamedField
+{
+    std::string name;
+    Function fn;
+};
+
+template <
+    typename Function
+>
+NamedField<Function> named_field(std::string name, Function && fn)
+{
+    return {std::move(name), std::forward<Function>(fn)};
+}
+
+namespace details
+{
+    /// XDMF element of the cells of given dimension
+    inline char const* xdmf_element(std::size_t dimension) noexcept
+    {
+        constexpr char const* elements[] = {"Polyvertex", "Polyline", "Quadrilateral", "Hexahedron"};
+        return elements[dimension];
+    }
+
+    /// Corners of a cell of given dimension in the XDMF order (bit k set: upper side along the k-th open direction)
+    constexpr std::array<std::size_t, 8> xdmf_corners = {0, 1, 3, 2, 4, 5, 7, 6};
+
+    /// XDMF number type of a value type
+    template <
+        typename T
+    >
+    char const* xdmf_number_type() noexcept
+    {
+        if constexpr (std::is_floating_point_v<T>)
+            return "Float";
+        else if constexpr (std::is_signed_v<T>)
+            return "Int";
+        else
+            return "UInt";
+    }
+
+    /// Text escaped to be used in an XML attribute value or element content
+    inline std::string xml_escape(std::string const& text)
+    {
+        std::string escaped;
+        escaped.reserve(text.size());
+        for (char c : text)
+            switch (c)
+            {
+            case '&':  escaped += "&amp;"; break;
+            case '<':  escaped += "&lt;"; break;
+            case '>':  escaped += "&gt;"; break;
+            case '"':  escaped += "&quot;"; break;
+            case '\'': escaped += "&apos;"; break;
+            default:   escaped += c;
+            }
+        return escaped;
+    }
+}
+
+/**
+ * Streaming writer of cells of any topology to XDMF (XML description + raw binary data)
+ *
+ * The cells are written row by row, straight from the cell set to a buffered binary file:
+ * no unstructured mesh is built in memory. Each cell gets its own corners, the geometry
+ * coming from its Khalimsky coordinates: along an open direction, the cell of index i of level l
+ * spans [i, i + 1] * length / 2^l, along a closed direction it lies at i * length / 2^l.
+ *
+ * Sharing the vertices between neighbouring cells would require a map from the vertices to their
+ * indices over the whole grid: the writer trades it for 2^d vertices per cell of dimension d
+ * (up to 8 times the size of the geometry in 3D) and a connectivity that is simply 0, 1, 2...
+ * Readers that need a conforming mesh can merge the coincident points (eg the Clean to Grid filter of ParaView).
+ *
+ * A grid is the set of cells reached from the cells of a CellSet by a stencil (eg the lower incident
+ * edges of the faces), or the cells of a CellSet of a given topology.
+ * Each grid is written as an unstructured grid of points, lines, quadrilaterals or hexahedra
+ * with one attribute per field, and the XML file is written when closing.
+ *
+ * @tparam Dim  Dimension of the space (1 to 3)
+ */
+template <
+    std::size_t Dim
+>
+class XdmfWriter
+{
+    static_assert(Dim >= 1 && Dim <= 3, "XDMF output is only available in dimension 1 to 3");
+
+public:
+    using entry_type = typename RuntimeStencil<Dim>::Entry;
+
+    /**
+     * @param path      Path of the XML file (the binary file is path + ".bin")
+     * @param length    Length of a cell of level 0
+     * @param origin    Position of the vertex of indices 0
+     */
+    explicit XdmfWriter(std::string path, double length = 1., std::array<double, Dim> const& origin = {})
+        : m_path(std::move(path))
+        , m_data(m_path + ".bin", std::ios::binary | std::ios::trunc)
+        , m_length(length)
+        , m_origin(origin)
+    {
+        if (!m_data)
+            throw std::runtime_error("Cannot open file " + m_path + ".bin");
+    }
+
+    XdmfWriter(XdmfWriter const&) = delete;
+    XdmfWriter& operator= (XdmfWriter const&) = delete;
+
+    ~XdmfWriter()
+    {
+        if (m_data.is_open())
+        {
+            try { close(); }
+            catch (...) {}
+        }
+    }
+
+    /// Write the cells of the set of given topology
+    template <
+        typename... Fields
+    >
+    void write_grid(std::string const& name, CellSet<Dim> const& set, std::size_t topology, Fields const&... fields)
+    {
+        write_grid(name, set, RuntimeStencil<Dim>(std::vector<entry_type>{entry_type{0, {}, topology}}), fields...);
+    }
+
+    /// Write the cells reached from the cells of the set by the cells of a KCellND or a KCells (eg the lower incident cells)
+    template <
+        typename Stencil,
+        typename... Fields,
+        typename = decltype(Stencil::topologies())
+    >
+    void write_grid(std::string const& name, CellSet<Dim> const& set, Stencil stencil, Fields const&... fields)
+    {
+        write_grid(name, set, RuntimeStencil<Dim>(stencil), fields...);
+    }
+
+    /**
+     * Write the cells reached from the cells of the set by the cells of a runtime stencil
+     *
+     * The cells of the stencil must be of the same dimension. The cells are written in the stencil order,
+     * each in the set order, and cells reached several times are written several times.
+     */
+    template <
+        typename... Fields
+    >
+    void write_grid(std::string const& name, CellSet<Dim> const& set, RuntimeStencil<Dim> const& stencil, Fields const&... fields)
+    {
+        Grid grid;
+        grid.name = name;
+        grid.dimension = stencil.size() == 0 ? 0 : cell_dimension<Dim>(stencil[0].topology);
+        grid.cell_count = set.size() * stencil.size();
+        for (auto const& cell : stencil.entries())
+            if (cell_dimension<Dim>(cell.topology) != grid.dimension)
+                throw std::invalid_argument("Cells of a grid must be of the same dimension");
+
+        std::size_t const n_corners = std::size_t(1) << grid.dimension;
+        grid.geometry = begin_section();
+        for (auto const& cell : stencil.entries())
+        {
+            // Open directions of the cell, in increasing order
+            std::array<std::size_t, Dim> open{};
+            for (std::size_t d = 0, k = 0; d < Dim; ++d)
+                if (is_open(cell.topology, d))
+                    open[k++] = d;
+
+            double const h = cell_length(static_cast<std::ptrdiff_t>(set.level) + cell.level_shift);
+            for_each_cell(set, cell, [&] (std::size_t, std::array<std::ptrdiff_t, Dim> const& index)
+            {
+                for (std::size_t c = 0; c < n_corners; ++c)
+                {
+                    std::array<double, 3> point{};
+                    for (std::size_t d = 0; d < Dim; ++d)
+                        point[d] = m_origin[d] + h * static_cast<double>(index[d]);
+                    for (std::size_t k = 0; k < grid.dimension; ++k)
+                        if ((details::xdmf_corners[c] >> k) & 1)
+                            point[open[k]] += h;
+                    push(point.data(), 3);
+                }
+            });
+        }
+
+        grid.connectivity = begin_section();
+        for (std::uint64_t k = 0; k < grid.cell_count * n_corners; ++k)
+            push(&k, 1);
+
+        (write_attribute(grid, set, stencil, fields), ...);
+        flush();
+        m_grids.push_back(std::move(grid));
+    }
+
+    /// Write the XML file
+    void close()
+    {
+        flush();
+        m_data.close();
+        if (!m_data)
+            throw std::runtime_error("Cannot write file " + m_path + ".bin");
+
+        std::string data_file = m_path + ".bin";
+        auto const slash = data_file.find_last_of('/');
+        if (slash != std::string::npos)
+            data_file = data_file.substr(slash + 1);
+        data_file = details::xml_escape(data_file);
+
+        std::ofstream xml(m_path);
+        xml << "<?xml version=\"1.0\" ?>\n"
+            << "<Xdmf Version=\"3.0\">\n"
+            << "  <Domain>\n"
+            << "    <Grid Name=\"cells\" GridType=\"Collection\" CollectionType=\"Spatial\">\n";
+        for (auto const& grid : m_grids)
+        {
+            std::size_t const n_corners = std::size_t(1) << grid.dimension;
+            xml << "      <Grid Name=\"" << details::xml_escape(grid.name) << "\" GridType=\"Uniform\">\n"
+                << "        <Topology TopologyType=\"" << details::xdmf_element(grid.dimension) << "\" NumberOfElements=\"" << grid.cell_count << "\"";
+            if (grid.dimension <= 1)
+                xml << " NodesPerElement=\"" << n_corners << "\"";
+            xml << ">\n";
+            data_item(xml, data_file, grid.connectivity, "UInt", 8, std::to_string(grid.cell_count) + " " + std::to_string(n_corners));
+            xml << "        </Topology>\n"
+                << "        <Geometry GeometryType=\"XYZ\">\n";
+            data_item(xml, data_file, grid.geometry, "Float", 8, std::to_string(grid.cell_count * n_corners) + " 3");
+            xml << "        </Geometry>\n";
+            for (auto const& attribute : grid.attributes)
+            {
+                xml << "        <Attribute Name=\"" << details::xml_escape(attribute.name) << "\" AttributeType=\"Scalar\" Center=\"Cell\">\n";
+                data_item(xml, data_file, attribute.offset, attribute.number_type, attribute.precision, std::to_string(grid.cell_count));
+                xml << "        </Attribute>\n";
+            }
+            xml << "      </Grid>\n";
+        }
+        xml << "    </Grid>\n"
+            << "  </Domain>\n"
+            << "</Xdmf>\n";
+        if (!xml)
+            throw std::runtime_error("Cannot write file " + m_path);
+    }
+
+private:
+    struct Attribute
+    {
+        std::string name;
+        char const* number_type;
+        std::size_t precision;
+        std::uint64_t offset;
+    };
+
+    struct Grid
+    {
+        std::string name;
+        std::size_t dimension;
+        std::uint64_t cell_count;
+        std::uint64_t geometry;
+        std::uint64_t connectivity;
+        std::vector<Attribute> attributes;
+    };
+
+    double cell_length(std::ptrdiff_t level) const noexcept
+    {
+        return level >= 0 ? m_length / static_cast<double>(std::uint64_t(1) << level) : m_length * static_cast<double>(std::uint64_t(1) << -level);
+    }
+
+    /// Call fn(level, indices) for each cell of the set shifted by the cell, in the set order
+    template <
+        typename Function
+    >
+    static void for_each_cell(CellSet<Dim> const& set, entry_type const& cell, Function && fn)
+    {
+        auto const level = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(set.level) + cell.level_shift);
+        std::array<std::ptrdiff_t, Dim> index{};
+        for (std::size_t r = 0; r < set.row_count(); ++r)
+        {
+            for (std::size_t d = 1; d < Dim; ++d)
+                index[d] = details::shift(set.rows[r][d - 1], cell.index_shift[d], cell.level_shift);
+            for (auto [it, end] = set.row_intervals(r); it != end; ++it)
+                for (auto i = it->a; i < it->b; ++i)
+                {
+                    index[0] = details::shift(i, cell.index_shift[0], cell.level_shift);
+                    fn(level, index);
+                }
+        }
+    }
+
+    template <
+        typename Function
+    >
+    void write_attribute(Grid & grid, CellSet<Dim> const& set, RuntimeStencil<Dim> const& stencil, NamedField<Function> const& field)
+    {
+        using value_type = std::decay_t<decltype(std::apply(field.fn, std::tuple_cat(std::make_tuple(std::size_t(0)), std::array<std::ptrdiff_t, Dim>{})))>;
+        static_assert(std::is_arithmetic_v<value_type>, "Fields must be of arithmetic type");
+
+        grid.attributes.push_back({field.name, details::xdmf_number_type<value_type>(), sizeof(value_type), begin_section()});
+        for (auto const& cell : stencil.entries())
+            for_each_cell(set, cell, [&] (std::size_t level, std::array<std::ptrdiff_t, Dim> const& index)
+            {
+                value_type const value = std::apply(field.fn, std::tuple_cat(std::make_tuple(level), index));
+                push(&value, 1);
+            });
+    }
+
+    static void data_item(std::ostream & xml, std::string const& file, std::uint64_t offset, char const* number_type, std::size_t precision, std::string const& dimensions)
+    {
+        xml << "          <DataItem Format=\"Binary\" Endian=\"Native\" Seek=\"" << offset << "\" NumberType=\"" << number_type
+            << "\" Precision=\"" << precision << "\" Dimensions=\"" << dimensions << "\">" << file << "</DataItem>\n";
+    }
+
+    /// Offset of the next section (aligned on 8 bytes)
+    std::uint64_t begin_section()
+    {
+        static constexpr char padding[8] = {};
+        std::size_t const n = (8 - m_offset % 8) % 8;
+        m_buffer.insert(m_buffer.end(), padding, padding + n);
+        m_offset += n;
+        return m_offset;
+    }
+
+    template <
+        typename T
+    >
+    void push(T const* values, std::size_t count)
+    {
+        auto const bytes = reinterpret_cast<char const*>(values);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + count * sizeof(T));
+        m_offset += count * sizeof(T);
+        if (m_buffer.size() >= buffer_size)
+            flush();
+    }
+
+    void flush()
+    {
+        m_data.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        if (!m_data)
+            throw std::runtime_error("Cannot write file " + m_path + ".bin");
+        m_buffer.clear();
+    }
+
+    static constexpr std::size_t buffer_size = std::size_t(1) << 20;
+
+    std::string m_path;
+    std::ofstream m_data;
+    double m_length;
+    std::array<double, Dim> m_origin;
+    std::vector<char> m_buffer;
+    std::uint64_t m_offset = 0;
+    std::vector<Grid> m_grids;
+};
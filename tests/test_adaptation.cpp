@@ -0,0 +1,98 @@
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "cell_set.hpp"
+#include "adaptation.hpp"
+#include "tools.hpp"
+
+/// Area of the mesh in number of cells of level max_level
+std::size_t area(std::vector<CellSet<2>> const& mesh, std::size_t max_level)
+{
+    std::size_t a = 0;
+    for (std::size_t l = 0; l < mesh.size(); ++l)
+        a += mesh[l].size() << (2 * (max_level - l));
+    return a;
+}
+
+/// Union of the leaves, projected on the level max_level
+CellSet<2> covering(std::vector<CellSet<2>> const& mesh, std::size_t max_level)
+{
+    CellSet<2> result(max_level);
+    for (std::size_t l = 0; l < mesh.size(); ++l)
+        result = set_union(result, refine(mesh[l], max_level - l));
+    return result;
+}
+
+int main()
+{
+    // Smoothed disk of radius 0.15 in [0, 1[^2
+    auto field = [] (std::size_t level, std::ptrdiff_t i, std::ptrdiff_t j)
+    {
+        double const h = 1. / static_cast<double>(std::size_t(1) << level);
+        double const x = (static_cast<double>(i) + 0.5) * h - 0.5;
+        double const y = (static_cast<double>(j) + 0.5) * h - 0.5;
+        return std::tanh((std::sqrt(x * x + y * y) - 0.15) / 0.01);
+    };
+
+    constexpr auto c2d = make_KCellND<2>();
+    auto const stencil = c2d.neighborhood();
+    AdaptationCriterion const criterion{0.1, 0.01, 1, 6};
+
+    std::cout << "Testing mesh adaptation:" << std::endl;
+    std::vector<CellSet<2>> mesh(4);
+    for (std::size_t l = 0; l < mesh.size(); ++l)
+        mesh[l].level = l;
+    mesh[3] = CellSet<2>::from_box(3, Box<2>{{0, 0}, {8, 8}});
+    auto const domain = covering(mesh, criterion.max_level);
+
+    for (std::size_t step = 0; step < 6; ++step)
+    {
+        mesh = adapt(mesh, stencil, field, criterion, 3);
+        std::cout << "step " << step << ": ";
+        for (auto const& set : mesh)
+            std::cout << set.size() << " ";
+        std::cout << std::endl;
+
+        CHECK(mesh.size() == criterion.max_level + 1);
+        CHECK(area(mesh, criterion.max_level) == domain.size());
+        CHECK(covering(mesh, criterion.max_level) == domain);
+        CHECK(mesh[0].empty() && mesh[1].empty());
+    }
+
+    // The front is at the finest level and the constant regions are coarsened
+    CHECK(!mesh[criterion.max_level].empty());
+    CHECK(mesh[criterion.max_level].contains({41, 32}));
+    CHECK(mesh[2].contains({0, 0}) && mesh[2].size() == 4); // Level 1 cells all intersect the disk
+
+    // Same result with a single thread
+    std::vector<CellSet<2>> serial(4);
+    for (std::size_t l = 0; l < serial.size(); ++l)
+        serial[l].level = l;
+    serial[3] = CellSet<2>::from_box(3, Box<2>{{0, 0}, {8, 8}});
+    for (std::size_t step = 0; step < 6; ++step)
+        serial = adapt(serial, stencil, field, criterion, 1);
+    CHECK(serial == mesh);
+    std::cout << std::endl;
+
+    std::cout << "Testing marking of a sparse level:" << std::endl;
+    {
+        // Two small boxes very far apart: the marks must not depend on the bounding box
+        constexpr std::ptrdiff_t far = std::ptrdiff_t(1) << 40;
+        auto const sparse = set_union(
+            CellSet<2>::from_box(45, Box<2>{{-2, 0}, {2, 2}}),
+            CellSet<2>::from_box(45, Box<2>{{far, far}, {far + 3, far + 1}})
+        );
+        auto step = [] (std::size_t, std::ptrdiff_t i, std::ptrdiff_t) { return i > 0 ? 1. : 0.; };
+        auto const marks = mark_cells(sparse, stencil, step, AdaptationCriterion{0.5, 0.1, 0, 50}, 3);
+        CHECK(marks.refine == CellSet<2>::from_box(45, Box<2>{{0, 0}, {2, 2}}));
+        CHECK(marks.coarsen == set_difference(sparse, marks.refine));
+    }
+    std::cout << std::endl;
+
+    return return_code();
+}
@@ -0,0 +1,136 @@
+#include <iostream>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "cell_set.hpp"
+#include "balance.hpp"
+#include "tools.hpp"
+
+/// Level of the leaf containing the cell of given level and indices (-1 if none)
+int leaf_level(std::vector<CellSet<2>> const& mesh, std::size_t level, std::array<std::ptrdiff_t, 2> const& indices)
+{
+    for (std::size_t l = 0; l < mesh.size(); ++l)
+    {
+        std::array<std::ptrdiff_t, 2> idx = indices;
+        for (auto & i : idx)
+            i = (l <= level) ? (i >> (level - l)) : (i * (std::ptrdiff_t(1) << (l - level)));
+        if (mesh[l].contains(idx))
+            return static_cast<int>(l);
+    }
+    return -1;
+}
+
+/// Area of the mesh in number of cells of the finest level
+std::size_t area(std::vector<CellSet<2>> const& mesh)
+{
+    std::size_t a = 0;
+    for (std::size_t l = 0; l < mesh.size(); ++l)
+        a += mesh[l].size() << (2 * (mesh.size() - 1 - l));
+    return a;
+}
+
+template <typename Stencil>
+bool is_balanced(std::vector<CellSet<2>> const& mesh, Stencil stencil)
+{
+    bool balanced = true;
+    for (std::size_t l = 0; l < mesh.size(); ++l)
+        mesh[l].for_each_interval(
+            [&] (std::size_t level, Interval const& interval, std::ptrdiff_t j)
+            {
+                for (auto i = interval.a; i < interval.b; ++i)
+                    for (auto const& s : stencil.indexShift())
+                    {
+                        int const neighbour = leaf_level(mesh, level, {i + s[0], j + s[1]});
+                        balanced = balanced && (neighbour == -1 || neighbour + 1 >= static_cast<int>(level));
+                    }
+            }
+        );
+    return balanced;
+}
+
+int main()
+{
+    std::cout << "Testing set operations:" << std::endl;
+    CellSet<2> a(1), b(1);
+    a.push_back({0}, {0, 10});
+    a.push_back({1}, {2, 4});
+    a.push_back({1}, {6, 8});
+    b.push_back({0}, {3, 5});
+    b.push_back({0}, {7, 12});
+    b.push_back({2}, {0, 1});
+    std::cout << "a = " << a << std::endl;
+    std::cout << "b = " << b << std::endl;
+    std::cout << "a | b = " << set_union(a, b) << std::endl;
+    std::cout << "a & b = " << set_intersection(a, b) << std::endl;
+    std::cout << "a - b = " << set_difference(a, b) << std::endl;
+    CHECK(set_union(a, b).size() == 17);
+    CHECK(set_intersection(a, b).size() == 5);
+    CHECK(set_difference(a, b).size() == 9);
+    CHECK(set_difference(a, b).interval_count() == 4);
+    CHECK(translate(b, {1, -2}).contains({1, 0}));
+    std::cout << "coarsen(a) = " << coarsen(a) << std::endl;
+    std::cout << "refine(b) = " << refine(b) << std::endl;
+    CHECK(coarsen(a).size() == 5 && coarsen(a).row_count() == 1);
+    CHECK(refine(b).size() == 4 * b.size() && refine(b).row_count() == 4);
+    CHECK(coarsen(refine(a, 2), 2) == a);
+    std::cout << std::endl;
+
+    std::cout << "Testing dilation:" << std::endl;
+    constexpr auto c2d = make_KCellND<2>();
+    CellSet<2> point(0);
+    point.push_back({0}, {0, 1});
+    CHECK(dilate(point, c2d.neighborhood()).size() == 5);
+    CHECK(dilate(point, c2d.neighborhood<2>(), 3).size() == 13);
+    std::cout << std::endl;
+
+    std::cout << "Testing 2:1 balance:" << std::endl;
+    auto const vertex_stencil = c2d.enumerate_cartesian([] (auto, auto cell) { return cell.neighborhood(); });
+    auto const face_stencil = c2d.neighborhood();
+
+    for (bool vertex : {false, true})
+    {
+        // Level 0 everywhere except one cell refined 4 times, and a cell of level 1 refined 3 times
+        std::vector<CellSet<2>> mesh(5);
+        for (std::size_t l = 0; l < 5; ++l)
+            mesh[l].level = l;
+        mesh[0] = CellSet<2>::from_box(0, Box<2>{{0, 0}, {6, 5}});
+        CellSet<2> cell(0);
+        cell.push_back({2}, {2, 3});
+        mesh[0] = set_difference(mesh[0], cell);
+        mesh[4] = refine(cell, 4);
+        cell.clear();
+        cell.push_back({0}, {5, 6});
+        mesh[0] = set_difference(mesh[0], cell);
+        mesh[1] = refine(cell);
+        cell = CellSet<2>(1);
+        cell.push_back({1}, {10, 11});
+        mesh[1] = set_difference(mesh[1], cell);
+        mesh[4] = set_union(mesh[4], refine(cell, 3));
+        std::size_t const initial_area = area(mesh);
+
+        if (vertex)
+        {
+            CHECK(!is_balanced(mesh, vertex_stencil));
+            balance(mesh, vertex_stencil, 2);
+            CHECK(is_balanced(mesh, vertex_stencil));
+        }
+        else
+        {
+            CHECK(!is_balanced(mesh, face_stencil));
+            balance(mesh, face_stencil, 2);
+            CHECK(is_balanced(mesh, face_stencil));
+        }
+        CHECK(area(mesh) == initial_area);
+
+        std::cout << (vertex ? "vertex" : "face") << " balanced mesh: ";
+        for (auto const& set : mesh)
+            std::cout << set.size() << " ";
+        std::cout << std::endl;
+    }
+    std::cout << std::endl;
+
+    return return_code();
+}
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <type_traits>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "interval.hpp"
+#include "topology.hpp"
+#include "boundary_split.hpp"
+#include "tools.hpp"
+
+/// Sums and counts of the cells passed to the stencil function and to the boundary callback
+struct Result
+{
+    std::ptrdiff_t inside_sum = 0, outside_sum = 0;
+    std::size_t inside_count = 0, outside_count = 0;
+};
+
+bool operator== (Result const& lhs, Result const& rhs)
+{
+    return lhs.inside_sum == rhs.inside_sum && lhs.outside_sum == rhs.outside_sum
+        && lhs.inside_count == rhs.inside_count && lhs.outside_count == rhs.outside_count;
+}
+
+std::ptrdiff_t hash(std::size_t l, std::ptrdiff_t i, std::ptrdiff_t j)
+{
+    return static_cast<std::ptrdiff_t>(l) * 1000003 + i * 1009 + j;
+}
+
+template <typename Stencil, typename Boundary>
+bool check_split(Stencil stencil, Box<2> const& domain, Boundary, std::size_t level, Interval const& interval, std::ptrdiff_t j)
+{
+    constexpr bool truncate = std::is_same_v<Boundary, TruncateBoundary>;
+
+    // Reference: check every shifted cell against the domain
+    Result expected;
+    for (std::ptrdiff_t i = interval.a; i < interval.b; i += static_cast<std::ptrdiff_t>(interval.step))
+        if (domain.contains({i, j}))
+            stencil.foreach(
+                [&] (auto cell)
+                {
+                    auto const ls = static_cast<std::size_t>(cell.levelShift());
+                    auto const idx = cell.shift(std::array<std::ptrdiff_t, 2>{i, j});
+                    // The domain includes the closing cells at max_corner along the closed directions of the cell
+                    auto const closing = [&] (std::size_t d) { return is_open(cell.topology(), d) ? 0 : 1; };
+                    Box<2> const fine{{domain.min_corner[0] << ls, domain.min_corner[1] << ls}, {(domain.max_corner[0] << ls) + closing(0), (domain.max_corner[1] << ls) + closing(1)}};
+                    if (fine.contains(idx))
+                    {
+                        expected.inside_sum += hash(level + ls, idx[0], idx[1]);
+                        ++expected.inside_count;
+                    }
+                    else if (!truncate)
+                    {
+                        expected.outside_sum += hash(level + ls, idx[0], idx[1]);
+                        ++expected.outside_count;
+                    }
+                }
+            );
+
+    Result result;
+    auto fn = [&] (std::size_t l, auto i, std::ptrdiff_t k)
+    {
+        if constexpr (std::is_same_v<decltype(i), Interval>)
+            for (std::ptrdiff_t ii = i.a; ii < i.b; ii += static_cast<std::ptrdiff_t>(i.step))
+            {
+                result.inside_sum += hash(l, ii, k);
+                ++result.inside_count;
+            }
+        else
+        {
+            result.inside_sum += hash(l, i, k);
+            ++result.inside_count;
+        }
+    };
+    auto bc = [&] (std::size_t l, std::ptrdiff_t i, std::ptrdiff_t k)
+    {
+        result.outside_sum += hash(l, i, k);
+        ++result.outside_count;
+    };
+
+    if constexpr (truncate)
+        split_apply(stencil, domain, fn, TruncateBoundary{}, level, interval, j);
+    else
+        split_apply(stencil, domain, fn, bc, level, interval, j);
+
+    return result == expected;
+}
+
+int main()
+{
+    constexpr auto c2d = make_KCellND<2>();
+
+    std::cout << "Testing compile-time truncated stencils:" << std::endl;
+    auto const stencil = c2d.neighborhood<2>();
+    constexpr auto inside = details::filter_offset<0, -1, 2, true>(decltype(stencil){});
+    constexpr auto outside = details::filter_offset<0, -1, 2, false>(decltype(stencil){});
+    CHECK(inside.size() + outside.size() == stencil.size());
+    CHECK(outside.size() == 1);
+    std::cout << "inside = " << inside << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "Testing interior/boundary split:" << std::endl;
+    Box<2> const domain{{0, 0}, {12, 6}};
+    auto const up_stencil = c2d.next<0, 2>().up() + c2d.prev<1>().up() + c2d.neighborhood();
+    auto const faces_stencil = c2d.lowerIncident() + c2d.next<1>().lowerIncident() + c2d.prev<0>().lowerIncident();
+    auto const fine_faces_stencil = c2d.up().lowerIncident() + c2d.next<0>().up().upperIncident();
+    for (std::ptrdiff_t j = -1; j < 7; ++j)
+        for (std::size_t step : {1, 2, 3})
+        {
+            Interval const interval{-2, 14, step};
+            CHECK(check_split(stencil, domain, TruncateBoundary{}, 3, interval, j));
+            CHECK(check_split(stencil, domain, 0, 3, interval, j));
+            CHECK(check_split(up_stencil, domain, TruncateBoundary{}, 3, interval, j));
+            CHECK(check_split(up_stencil, domain, 0, 3, interval, j));
+            CHECK(check_split(faces_stencil, domain, TruncateBoundary{}, 3, interval, j));
+            CHECK(check_split(faces_stencil, domain, 0, 3, interval, j));
+            CHECK(check_split(fine_faces_stencil, domain, TruncateBoundary{}, 3, interval, j));
+            CHECK(check_split(fine_faces_stencil, domain, 0, 3, interval, j));
+        }
+    std::cout << std::endl;
+
+    return return_code();
+}
@@ -0,0 +1,211 @@
+#include <iostream>
+#include <atomic>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "cell_set.hpp"
+#include "arena.hpp"
+#include "balance.hpp"
+#include "tools.hpp"
+
+/// 2D set with very uneven rows in [0, 64[x[0, 32[
+CellSet<2> make_uneven_set()
+{
+    CellSet<2> set(5);
+    for (std::ptrdiff_t j = 0; j < 32; ++j)
+    {
+        if (j % 7 == 0)
+            set.push_back({j}, {0, 64}); // Long row
+        else if (j % 3 != 0)
+            for (std::ptrdiff_t i = j % 4; i < 64; i += 9)
+                set.push_back({j}, {i, std::min<std::ptrdiff_t>(64, i + 1 + j % 3)});
+    }
+    return set;
+}
+
+int main()
+{
+    std::cout << "Testing CellSet:" << std::endl;
+    CellSet<2> set(3);
+    set.push_back({1}, {0, 4});
+    set.push_back({1}, {4, 6});   // Adjacent: merged
+    set.push_back({1}, {8, 10});
+    set.push_back({2}, {-3, -1});
+    set.push_back({2}, {5, 5});   // Empty: ignored
+    std::cout << "set = " << set << std::endl;
+    CHECK(set.row_count() == 2);
+    CHECK(set.interval_count() == 3);
+    CHECK(set.size() == 10);
+    CHECK(set.contains({5, 1}) && !set.contains({6, 1}) && set.contains({-2, 2}) && !set.contains({0, 0}));
+
+    auto box_set = CellSet<3>::from_box(2, Box<3>{{0, 1, 2}, {4, 3, 5}});
+    CHECK(box_set.row_count() == 6 && box_set.size() == 24);
+    std::cout << std::endl;
+
+    std::cout << "Testing parallel traversal:" << std::endl;
+    auto uneven = make_uneven_set();
+    std::cout << "uneven: " << uneven.row_count() << " rows, " << uneven.interval_count() << " intervals, " << uneven.size() << " cells" << std::endl;
+
+    for (std::size_t grain : {1ul, 7ul, 50ul, 0ul, 10000ul})
+    {
+        std::vector<std::atomic<int>> visits(64 * 32);
+        for (auto & v : visits)
+            v = 0;
+
+        parallel_for_each_interval(uneven,
+            [&visits] (std::size_t level, Interval const& interval, std::ptrdiff_t j)
+            {
+                if (level != 5)
+                    return;
+                for (auto i = interval.a; i < interval.b; ++i)
+                    ++visits[static_cast<std::size_t>(j * 64 + i)];
+            },
+            grain, 4
+        );
+
+        bool valid = true;
+        for (std::ptrdiff_t j = 0; j < 32; ++j)
+            for (std::ptrdiff_t i = 0; i < 64; ++i)
+                valid = valid && visits[static_cast<std::size_t>(j * 64 + i)] == (uneven.contains({i, j}) ? 1 : 0);
+        CHECK(valid);
+    }
+
+    std::cout << "Testing parallel traversal with a stencil:" << std::endl;
+    constexpr auto c2d = make_KCellND<2>();
+    std::atomic<std::size_t> n_cells{0};
+    parallel_for_each_interval(uneven, c2d.neighborhood(),
+        [&n_cells] (std::size_t, Interval const& interval, std::ptrdiff_t)
+        {
+            n_cells += static_cast<std::size_t>(interval.b - interval.a);
+        },
+        13, 3
+    );
+    std::cout << "n_cells = " << n_cells << std::endl;
+    CHECK(n_cells == 5 * uneven.size());
+
+    std::cout << "Testing bulk refine and coarsen:" << std::endl;
+    {
+        // Irregular 3D set
+        CellSet<3> set3d(3);
+        for (std::ptrdiff_t k = -5; k < 6; ++k)
+            for (std::ptrdiff_t j = -7; j < 8; ++j)
+                if ((j * j + k * k) % 5 != 1)
+                    for (std::ptrdiff_t i = -9 + (j & 3); i < 9; i += 4 + (k & 1))
+                        set3d.push_back({j, k}, {i, i + 1 + ((i + j) & 1)});
+
+        for (std::size_t levels : {1ul, 2ul})
+        {
+            auto const coarse = coarsen(set3d, levels, 3);
+            auto const fine = refine(set3d, levels, 3);
+            CHECK(coarse.level == 3 - levels && fine.level == 3 + levels);
+            CHECK(fine.size() == set3d.size() << (3 * levels));
+
+            // Brute force check of the coarse set
+            bool valid = true;
+            std::size_t n_coarse = 0;
+            for (std::ptrdiff_t k = -8; k < 8; ++k)
+                for (std::ptrdiff_t j = -8; j < 8; ++j)
+                    for (std::ptrdiff_t i = -16; i < 16; ++i)
+                    {
+                        bool has_child = false;
+                        auto const ratio = std::ptrdiff_t(1) << levels;
+                        for (std::ptrdiff_t c = 0; c < ratio * ratio * ratio; ++c)
+                            has_child = has_child || set3d.contains({i * ratio + c % ratio, j * ratio + (c / ratio) % ratio, k * ratio + c / (ratio * ratio)});
+                        valid = valid && coarse.contains({i, j, k}) == has_child;
+                        n_coarse += has_child ? 1 : 0;
+                    }
+            CHECK(valid && n_coarse == coarse.size());
+            CHECK(coarsen(fine, levels) == set3d);
+
+            // Rows must be sorted and intervals not adjacent
+            bool sorted = true;
+            for (std::size_t r = 0; r < coarse.row_count(); ++r)
+            {
+                sorted = sorted && (r == 0 || details::row_less(coarse.rows[r - 1], coarse.rows[r]));
+                for (std::size_t k = coarse.row_offsets[r] + 1; k < coarse.row_offsets[r + 1]; ++k)
+                    sorted = sorted && coarse.intervals[k - 1].b < coarse.intervals[k].a;
+            }
+            CHECK(sorted);
+        }
+
+        CellSet<1> set1d(2);
+        set1d.push_back({}, {-5, -3});
+        set1d.push_back({}, {0, 1});
+        set1d.push_back({}, {2, 3});
+        std::cout << "coarsen(" << set1d << ") = " << coarsen(set1d) << std::endl;
+        CHECK(coarsen(set1d).size() == 4 && coarsen(set1d).interval_count() == 2);
+        CHECK(refine(set1d, 3).size() == 32);
+    }
+    std::cout << std::endl;
+
+    std::cout << "Testing work stealing:" << std::endl;
+    std::vector<std::atomic<int>> done(1000);
+    for (auto & v : done)
+        v = 0;
+    work_stealing_for(done.size(), [&done] (std::size_t i) { ++done[i]; }, 5);
+    CHECK(std::all_of(done.begin(), done.end(), [] (auto const& v) { return v == 1; }));
+    std::cout << std::endl;
+
+    std::cout << "Testing arena:" << std::endl;
+    {
+        auto const box_set = CellSet<2>::from_box(3, Box<2>{{0, 0}, {40, 30}});
+        CellSet<2> kept(3);
+        CellSet<2> expected = set_difference(box_set, translate(box_set, {5, 7}));
+        {
+            details::CellSetArena arena(1024);
+            auto const shifted = translate(box_set, {5, 7});
+            auto const difference = set_difference(box_set, shifted);
+            CHECK(shifted.get_allocator().resource() == arena.resource());
+            CHECK(difference.get_allocator().resource() == arena.resource());
+            CHECK(coarsen(refine(difference, 2, 3), 2, 3).get_allocator().resource() == arena.resource());
+            {
+                details::CellSetArena nested;
+                CHECK(CellSet<2>(0).get_allocator().resource() == nested.resource());
+            }
+            CHECK(CellSet<2>(0).get_allocator().resource() == arena.resource());
+            kept = difference;
+            CHECK(kept.get_allocator().resource() != arena.resource());
+
+            // Worker threads allocate from the arena of the calling thread
+            std::vector<std::pmr::memory_resource*> resources(8, nullptr);
+            parallel_for(0, resources.size(), [&] (std::size_t i) { resources[i] = details::thread_resource(); }, 4);
+            CHECK(std::all_of(resources.begin(), resources.end(), [&] (auto r) { return r == arena.resource(); }));
+            std::fill(resources.begin(), resources.end(), nullptr);
+            work_stealing_for(resources.size(), [&] (std::size_t i) { resources[i] = details::thread_resource(); }, 4);
+            CHECK(std::all_of(resources.begin(), resources.end(), [&] (auto r) { return r == arena.resource(); }));
+            {
+                auto const dilated = dilate(difference, make_KCellND<2>().neighborhood(), 4);
+                CHECK(dilated.get_allocator().resource() == arena.resource());
+                CHECK(dilated == dilate(expected, make_KCellND<2>().neighborhood(), 1));
+            }
+
+            // Worker threads growing a set of the calling thread bump-allocate from their own buffers
+            {
+                auto parts = details::make_sets<2>(8, 3);
+                parallel_for(0, parts.size(), [&] (std::size_t p) { parts[p] = translate(box_set, {static_cast<std::ptrdiff_t>(p), 0}); }, 4);
+                bool all_translated = true;
+                for (std::size_t p = 0; p < parts.size(); ++p)
+                    all_translated = all_translated && parts[p] == translate(box_set, {static_cast<std::ptrdiff_t>(p), 0});
+                CHECK(all_translated);
+            }
+
+#ifndef NDEBUG
+            // Live bytes are counted in debug builds
+            std::size_t const allocated = arena.allocated();
+            {
+                auto const refined = refine(difference, 2, 4);
+                CHECK(arena.allocated() > allocated);
+            }
+            CHECK(arena.allocated() == allocated);
+#endif
+        }
+        CHECK(CellSet<2>(0).get_allocator().resource() == std::pmr::new_delete_resource());
+        CHECK(kept == expected);
+    }
+    std::cout << std::endl;
+
+    return return_code();
+}
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "box.hpp"
+#include "cell_set.hpp"
+#include "cell_set_builder.hpp"
+#include "packed_key.hpp"
+#include "parallel.hpp"
+#include "tools.hpp"
+
+/// Marking criterion: a ring
+bool is_marked(std::ptrdiff_t i, std::ptrdiff_t j)
+{
+    auto const r2 = (i - 70) * (i - 70) + (j - 40) * (j - 40);
+    return r2 >= 400 && r2 < 900;
+}
+
+int main()
+{
+    std::cout << "Testing concurrent marking:" << std::endl;
+    Box<2> const box{{-3, 0}, {150, 90}};
+
+    CellSet<2> expected(4);
+    for (std::size_t r = 0; r < box.row_count(); ++r)
+    {
+        auto const row = box.row_indices(r);
+        for (auto i = box.min_corner[0]; i < box.max_corner[0]; ++i)
+            if (is_marked(i, row[0]))
+                expected.push_back(row, {i, i + 1});
+    }
+
+    for (std::size_t n_threads : {1, 2, 4, 7})
+    {
+        ConcurrentCellSetBuilder<2> builder(4, box);
+        // Each cell is marked twice, by different threads
+        parallel_for(0, 2 * box.size(),
+            [&] (std::size_t n)
+            {
+                auto const k = n % box.size();
+                std::ptrdiff_t const i = box.min_corner[0] + static_cast<std::ptrdiff_t>(k % box.shape(0));
+                std::ptrdiff_t const j = box.min_corner[1] + static_cast<std::ptrdiff_t>(k / box.shape(0));
+                if (is_marked(i, j))
+                    builder.insert({i, j});
+            },
+            n_threads
+        );
+        auto const set = builder.finalize(n_threads);
+        CHECK(set == expected);
+    }
+    std::cout << std::endl;
+
+    std::cout << "Testing interval fragments and packed keys:" << std::endl;
+    ConcurrentCellSetBuilder<2> builder(2, box);
+    std::vector<std::thread> threads;
+    for (std::ptrdiff_t t = 0; t < 3; ++t)
+        threads.emplace_back(
+            [&builder, t]
+            {
+                // Overlapping fragments crossing the word boundaries
+                builder.insert({5}, {10 + 40 * t, 70 + 40 * t});
+                builder.insert({7 + t}, {-3, 150});
+            }
+        );
+    for (auto & thread : threads)
+        thread.join();
+    CHECK(builder.insert(PackedKCellKey<2>::from_indices(2, 0b11, {0, 20})));
+    CHECK(!builder.insert(PackedKCellKey<2>::from_indices(2, 0b11, {0, 20})));
+    CHECK(!builder.insert({64, 5}));
+
+    auto const set = builder.finalize();
+    std::cout << "set = " << set << std::endl;
+    CHECK(set.row_count() == 5 && set.interval_count() == 5);
+    CHECK(set.size() == 140 + 3 * 153 + 1);
+    CHECK(set.contains({149, 8}) && !set.contains({150, 5}) && !set.contains({9, 5}));
+    std::cout << std::endl;
+
+    std::cout << "Testing 1D builder:" << std::endl;
+    ConcurrentCellSetBuilder<1> builder1d(0, Box<1>{{0}, {128}});
+    builder1d.insert({}, {0, 64});
+    builder1d.insert({}, {64, 128});
+    CHECK(builder1d.finalize(2).interval_count() == 1);
+    CHECK(builder1d.finalize(2).size() == 128);
+    std::cout << std::endl;
+
+    return return_code();
+}
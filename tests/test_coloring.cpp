@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "coloring.hpp"
+#include "tools.hpp"
+
+/// Colouring that records, per thread, the colour being swept when the parity of a row is queried
+template <
+    typename Coloring
+>
+struct TracedColoring : Coloring
+{
+    static inline thread_local std::size_t current_color = 0;
+
+    static std::ptrdiff_t row_parity(std::size_t c, typename Coloring::row_indices_type const& row) noexcept
+    {
+        current_color = c;
+        return Coloring::row_parity(c, row);
+    }
+};
+
+int main()
+{
+    constexpr auto c2d = make_KCellND<2>();
+    using center_type = std::decay_t<decltype(c2d)>;
+
+    std::cout << "Testing colouring validity:" << std::endl;
+    using star_type = decltype(c2d.neighborhood());
+    auto box_stencil = c2d.enumerate_cartesian([] (auto, auto cell) { return cell.neighborhood(); });
+    using box_type = decltype(box_stencil);
+    using wide_type = decltype(c2d.neighborhood<2>());
+    using edges_type = decltype(c2d.lowerIncident());
+
+    CHECK((is_valid_coloring<RedBlackColoring<2>, center_type, star_type>()));
+    CHECK((not is_valid_coloring<RedBlackColoring<2>, center_type, box_type>()));
+    CHECK((is_valid_coloring<ParityColoring<2>, center_type, box_type>()));
+    CHECK((not is_valid_coloring<ParityColoring<2>, center_type, wide_type>()));
+    CHECK((is_valid_coloring<RedBlackColoring<2>, center_type, edges_type>())); // Other topology: no coupling
+
+    CHECK((std::is_same_v<decltype(make_coloring(c2d, star_type{})), RedBlackColoring<2>>));
+    CHECK((std::is_same_v<decltype(make_coloring(c2d, box_type{})), ParityColoring<2>>));
+    std::cout << std::endl;
+
+    std::cout << "Testing multicolour sweep:" << std::endl;
+    Box<2> box{{-3, 2}, {6, 7}};
+    std::vector<int> visits(box.size(), 0);
+    std::vector<int> colors(box.size(), -1);
+    auto offset = [&box] (std::ptrdiff_t i, std::ptrdiff_t j)
+    {
+        return static_cast<std::size_t>((j - box.min_corner[1]) * static_cast<std::ptrdiff_t>(box.shape(0)) + (i - box.min_corner[0]));
+    };
+
+    std::vector<std::size_t> levels(box.size(), 0);
+    using coloring_type = TracedColoring<ParityColoring<2>>;
+    multicolor_sweep(coloring_type{}, box, 3,
+        [&] (std::size_t level, Interval const& interval, std::ptrdiff_t j)
+        {
+            for (std::ptrdiff_t i = interval.a; i < interval.b; i += static_cast<std::ptrdiff_t>(interval.step))
+            {
+                levels[offset(i, j)] = level;
+                colors[offset(i, j)] = static_cast<int>(coloring_type::current_color);
+                ++visits[offset(i, j)];
+            }
+        },
+        2
+    );
+    CHECK(std::all_of(levels.begin(), levels.end(), [] (std::size_t l) { return l == 3; }));
+    CHECK(std::all_of(visits.begin(), visits.end(), [] (int v) { return v == 1; }));
+
+    // Each visited cell must have been visited while sweeping its own colour
+    bool all_colored = true;
+    for (std::ptrdiff_t j = box.min_corner[1]; j < box.max_corner[1]; ++j)
+        for (std::ptrdiff_t i = box.min_corner[0]; i < box.max_corner[0]; ++i)
+            all_colored = all_colored && colors[offset(i, j)] == static_cast<int>(coloring_type::color({i, j}));
+    CHECK(all_colored);
+
+    std::fill(visits.begin(), visits.end(), 0);
+    std::size_t n_sweeps = 3;
+    multicolor_smooth(c2d, star_type{}, box, 0,
+        [&] (std::size_t, Interval const& interval, std::ptrdiff_t j)
+        {
+            for (std::ptrdiff_t i = interval.a; i < interval.b; i += static_cast<std::ptrdiff_t>(interval.step))
+                ++visits[offset(i, j)];
+        },
+        n_sweeps,
+        3
+    );
+    CHECK(std::all_of(visits.begin(), visits.end(), [n_sweeps] (int v) { return v == static_cast<int>(n_sweeps); }));
+
+    std::cout << "Testing 3D red-black colouring:" << std::endl;
+    constexpr auto c3d = make_KCellND<3>();
+    Box<3> box3d{{0, 0, 0}, {5, 4, 3}};
+    std::size_t n_cells = 0;
+    bool valid_color = true;
+    std::size_t sweep_color = 0;
+    RedBlackColoring<3> rb;
+    std::vector<std::size_t> per_color(2, 0);
+    for (sweep_color = 0; sweep_color < 2; ++sweep_color)
+        for (std::size_t r = 0; r < box3d.row_count(); ++r)
+        {
+            auto row = box3d.row_indices(r);
+            auto parity = rb.row_parity(sweep_color, row);
+            for (auto i = details::first_with_parity(0, parity); i < 5; i += 2)
+            {
+                valid_color = valid_color && rb.color({i, row[0], row[1]}) == sweep_color;
+                ++per_color[sweep_color];
+            }
+        }
+    multicolor_smooth(c3d, c3d.neighborhood(), box3d, 0,
+        [&n_cells] (std::size_t, Interval const& interval, std::ptrdiff_t, std::ptrdiff_t)
+        {
+            for (std::ptrdiff_t i = interval.a; i < interval.b; i += 2)
+                ++n_cells;
+        },
+        1, 1
+    );
+    CHECK(valid_color);
+    CHECK(per_color[0] + per_color[1] == box3d.size());
+    CHECK(n_cells == box3d.size());
+    std::cout << std::endl;
+
+    return return_code();
+}
@@ -0,0 +1,139 @@
+#include <iostream>
+#include <atomic>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "cell_set.hpp"
+#include "compressed_cell_set.hpp"
+#include "tools.hpp"
+
+/// 2D set with very uneven rows in [0, 64[x[0, 32[
+CellSet<2> make_uneven_set()
+{
+    CellSet<2> set(5);
+    for (std::ptrdiff_t j = 0; j < 32; ++j)
+    {
+        if (j % 7 == 0)
+            set.push_back({j}, {0, 64}); // Long row
+        else if (j % 3 != 0)
+            for (std::ptrdiff_t i = j % 4; i < 64; i += 9)
+                set.push_back({j}, {i, std::min<std::ptrdiff_t>(64, i + 1 + j % 3)});
+    }
+    return set;
+}
+
+/// Set of disk of given center and radius (in cells)
+CellSet<2> make_disk(std::size_t level, std::ptrdiff_t x, std::ptrdiff_t y, std::ptrdiff_t radius)
+{
+    CellSet<2> set(level);
+    for (std::ptrdiff_t j = -radius; j <= radius; ++j)
+    {
+        std::ptrdiff_t w = 0;
+        while ((w + 1) * (w + 1) + j * j <= radius * radius)
+            ++w;
+        set.push_back({y + j}, {x - w, x + w + 1});
+    }
+    return set;
+}
+
+int main()
+{
+    std::cout << "Testing varints:" << std::endl;
+    {
+        std::vector<std::uint8_t> bytes;
+        std::vector<std::ptrdiff_t> const values{0, -1, 1, 63, -64, 64, 1000000, -(std::ptrdiff_t(1) << 40)};
+        for (auto v : values)
+            details::put_varint(bytes, details::zigzag_encode(v));
+        CHECK(bytes.size() == 5 + 2 + 3 + 6);
+        std::uint8_t const* p = bytes.data();
+        bool valid = true;
+        for (auto v : values)
+            valid = valid && details::zigzag_decode(details::get_varint(p)) == v;
+        CHECK(valid);
+        CHECK(p == bytes.data() + bytes.size());
+    }
+    std::cout << std::endl;
+
+    std::cout << "Testing compression:" << std::endl;
+    auto const uneven = make_uneven_set();
+    auto const compressed = compress(uneven);
+    std::cout << "plain size = " << uneven.rows.size() * sizeof(uneven.rows[0]) + uneven.row_offsets.size() * sizeof(std::size_t) + uneven.intervals.size() * sizeof(Interval)
+              << " bytes, compressed size = " << compressed.byte_size() << " bytes" << std::endl;
+    CHECK(compressed.row_count() == uneven.row_count());
+    CHECK(compressed.interval_count() == uneven.interval_count());
+    CHECK(compressed.size() == uneven.size());
+    CHECK(compressed.byte_size() * 8 < uneven.intervals.size() * sizeof(Interval));
+    CHECK(compressed.decompress() == uneven);
+    CHECK(compress(CellSet<2>(3)).empty() && compress(CellSet<2>(3)).decompress() == CellSet<2>(3));
+
+    // Rows far apart and negative indices (multi-bytes varints), several blocks
+    CellSet<3> sparse(10);
+    for (std::ptrdiff_t k = -300; k < 300; k += 3)
+        for (std::ptrdiff_t j = -5000; j < 5000; j += 1717)
+            sparse.push_back({j, k}, {-100000 + k * j, -100000 + k * j + 5 + (k & 7)});
+    auto const compressed_sparse = compress(sparse);
+    CHECK(compressed_sparse.blocks().size() == (sparse.row_count() + 63) / 64);
+    CHECK(compressed_sparse.decompress() == sparse);
+
+    // Streaming builder merges as CellSet::push_back
+    CompressedCellSetBuilder<2> builder(3);
+    builder.push_back({1}, {0, 4});
+    builder.push_back({1}, {4, 6});
+    builder.push_back({1}, {8, 10});
+    builder.push_back({2}, {-3, -1});
+    builder.push_back({2}, {5, 5});
+    auto const small = builder.finish();
+    CHECK(small.row_count() == 2 && small.interval_count() == 3 && small.size() == 10);
+    CellSet<2> expected(3);
+    expected.push_back({1}, {0, 6});
+    expected.push_back({1}, {8, 10});
+    expected.push_back({2}, {-3, -1});
+    CHECK(small.decompress() == expected);
+    std::cout << std::endl;
+
+    std::cout << "Testing set operations:" << std::endl;
+    auto const disk1 = make_disk(5, 20, 16, 12);
+    auto const disk2 = make_disk(5, 36, 12, 15);
+    for (auto const& [lhs, rhs] : {std::pair{disk1, disk2}, std::pair{uneven, disk2}, std::pair{disk1, CellSet<2>(5)}})
+    {
+        auto const clhs = compress(lhs);
+        auto const crhs = compress(rhs);
+        CHECK(set_union(clhs, crhs).decompress() == set_union(lhs, rhs));
+        CHECK(set_intersection(clhs, crhs).decompress() == set_intersection(lhs, rhs));
+        CHECK(set_difference(clhs, crhs).decompress() == set_difference(lhs, rhs));
+        CHECK(set_difference(crhs, clhs).decompress() == set_difference(rhs, lhs));
+    }
+    std::cout << std::endl;
+
+    std::cout << "Testing stencil application:" << std::endl;
+    {
+        constexpr auto c3d = make_KCellND<3>();
+        auto const stencil = c3d.neighborhood();
+        std::atomic<std::size_t> cells{0}, shifted{0};
+        parallel_for_each_interval(compressed_sparse, [&cells] (std::size_t level, Interval const& i, std::ptrdiff_t, std::ptrdiff_t) { if (level == 10) cells += cell_count(i); }, 4);
+        CHECK(cells == sparse.size());
+
+        std::atomic<bool> valid{true};
+        parallel_for_each_interval(compressed_sparse, stencil,
+            [&] (std::size_t, Interval const& i, std::ptrdiff_t j, std::ptrdiff_t k)
+            {
+                shifted += cell_count(i);
+                if (!sparse.contains({i.a + 1, j, k}) && !sparse.contains({i.a - 1, j, k}) && !sparse.contains({i.a, j + 1, k}) && !sparse.contains({i.a, j - 1, k}) && !sparse.contains({i.a, j, k - 1}) && !sparse.contains({i.a, j, k + 1}) && !sparse.contains({i.a, j, k}))
+                    valid = false;
+            },
+            4
+        );
+        CHECK(shifted == stencil.size() * sparse.size());
+        CHECK(valid);
+
+        std::size_t serial = 0;
+        compressed.for_each_interval([&serial] (std::size_t, Interval const& i, std::ptrdiff_t) { serial += cell_count(i); });
+        CHECK(serial == uneven.size());
+    }
+    std::cout << std::endl;
+
+    return return_code();
+}
@@ -0,0 +1,139 @@
+#include <iostream>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "decomposition.hpp"
+#include "tools.hpp"
+
+/// Global value of a cell of given topology
+double global_value(std::size_t topology, std::array<std::ptrdiff_t, 2> const& indices)
+{
+    return static_cast<double>(topology * 10000 + static_cast<std::size_t>(indices[1] * 100 + indices[0]));
+}
+
+int main()
+{
+    constexpr auto c2d = make_KCellND<2>();
+    auto stencil = c2d.neighborhood<2>() + c2d.lowerIncident() + c2d.lowerIncident().lowerIncident().unique();
+    std::cout << "stencil = " << stencil.indexShift() << std::endl;
+
+    Box<2> domain{{-5, 0}, {37, 20}};
+    Decomposition<2> decomposition(domain, 6, stencil);
+    std::cout << "grid = " << decomposition.grid() << std::endl;
+    CHECK(decomposition.size() == 6);
+    CHECK((decomposition.grid() == std::array<std::size_t, 2>{3, 2}));
+
+    std::cout << "Testing halos:" << std::endl;
+    for (std::size_t topology = 0; topology < 4; ++topology)
+        std::cout << "halo(" << topology_as_string<2>(topology) << ") = " << decomposition.halo(topology)[0] << " " << decomposition.halo(topology)[1] << std::endl;
+    CHECK((decomposition.halo(3)[0] == std::array<std::ptrdiff_t, 2>{2, 2}));
+    CHECK((decomposition.halo(3)[1] == std::array<std::ptrdiff_t, 2>{2, 2}));
+    CHECK((decomposition.halo(1)[0] == std::array<std::ptrdiff_t, 2>{0, 0}));
+    CHECK((decomposition.halo(1)[1] == std::array<std::ptrdiff_t, 2>{0, 1}));
+    CHECK((decomposition.halo(0)[1] == std::array<std::ptrdiff_t, 2>{1, 1}));
+    std::cout << std::endl;
+
+    std::cout << "Testing ownership:" << std::endl;
+    for (std::size_t topology = 0; topology < 4; ++topology)
+    {
+        Box<2> global = domain;
+        for (std::size_t d = 0; d < 2; ++d)
+            if (!is_open(topology, d))
+                ++global.max_corner[d];
+
+        std::vector<int> owners(global.size(), 0);
+        for (std::size_t part = 0; part < decomposition.size(); ++part)
+        {
+            auto owned = decomposition.owned_box(part, topology);
+            for (auto j = owned.min_corner[1]; j < owned.max_corner[1]; ++j)
+                for (auto i = owned.min_corner[0]; i < owned.max_corner[0]; ++i)
+                    ++owners[global.offset({i, j})];
+        }
+        CHECK(std::all_of(owners.begin(), owners.end(), [] (int n) { return n == 1; }));
+    }
+    std::cout << std::endl;
+
+    std::cout << "Testing halo exchange:" << std::endl;
+    for (std::size_t topology = 0; topology < 4; ++topology)
+    {
+        // Owned cells initialized to the global value, ghost cells to -1
+        std::vector<std::vector<double>> data(decomposition.size());
+        std::vector<double*> storages;
+        auto initialize = [&]
+        {
+            for (std::size_t part = 0; part < decomposition.size(); ++part)
+            {
+                auto storage = decomposition.storage_box(part, topology);
+                auto owned = decomposition.owned_box(part, topology);
+                data[part].assign(storage.size(), -1.);
+                for (auto j = owned.min_corner[1]; j < owned.max_corner[1]; ++j)
+                    for (auto i = owned.min_corner[0]; i < owned.max_corner[0]; ++i)
+                        data[part][storage.offset({i, j})] = global_value(topology, {i, j});
+            }
+        };
+
+        // Ghost cells (and owned cells if check_owned) have their global value, the others -1
+        std::size_t n_ghosts = 0;
+        auto is_valid = [&] (bool check_owned)
+        {
+            bool valid = true;
+            n_ghosts = 0;
+            for (std::size_t part = 0; part < decomposition.size(); ++part)
+            {
+                auto storage = decomposition.storage_box(part, topology);
+                auto owned = decomposition.owned_box(part, topology);
+                for (auto j = storage.min_corner[1]; j < storage.max_corner[1]; ++j)
+                    for (auto i = storage.min_corner[0]; i < storage.max_corner[0]; ++i)
+                    {
+                        if (!check_owned && owned.contains({i, j}))
+                            continue;
+                        bool const in_domain = i >= domain.min_corner[0] && j >= domain.min_corner[1]
+                            && i < domain.max_corner[0] + (is_open(topology, 0) ? 0 : 1)
+                            && j < domain.max_corner[1] + (is_open(topology, 1) ? 0 : 1);
+                        double const expected = in_domain ? global_value(topology, {i, j}) : -1.;
+                        valid = valid && data[part][storage.offset({i, j})] == expected;
+                        n_ghosts += (in_domain && !owned.contains({i, j})) ? 1 : 0;
+                    }
+            }
+            return valid;
+        };
+
+        initialize();
+        for (auto & d : data)
+            storages.push_back(d.data());
+        decomposition.exchange(topology, storages, 3);
+        CHECK(is_valid(true));
+
+        std::cout << "topology " << topology_as_string<2>(topology) << ": "
+                  << decomposition.messages(topology).size() << " messages, "
+                  << n_ghosts << " ghost cells" << std::endl;
+
+        // Two-phase exchange, the owned cells being overwritten in between
+        auto exchange = decomposition.make_exchange<double>(topology);
+        for (std::size_t step = 0; step < 2; ++step)
+        {
+            initialize();
+            exchange.begin(storages, 3);
+            for (std::size_t part = 0; part < decomposition.size(); ++part)
+            {
+                auto storage = decomposition.storage_box(part, topology);
+                auto owned = decomposition.owned_box(part, topology);
+                for (auto j = owned.min_corner[1]; j < owned.max_corner[1]; ++j)
+                    for (auto i = owned.min_corner[0]; i < owned.max_corner[0]; ++i)
+                        data[part][storage.offset({i, j})] = 0.;
+            }
+            exchange.finish(storages, 3);
+            CHECK(is_valid(false));
+        }
+    }
+
+    auto interior = decomposition.interior_box(4, 3);
+    std::cout << "box(4) = " << decomposition.box(4) << ", interior_box(4) = " << interior << std::endl;
+    CHECK((interior == decomposition.box(4).grow(-2)));
+    std::cout << std::endl;
+
+    return return_code();
+}
@@ -0,0 +1,121 @@
+#include <iostream>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "cell_set.hpp"
+#include "packed_key.hpp"
+#include "hash_cell_set.hpp"
+#include "tools.hpp"
+
+int main()
+{
+    std::cout << "Testing packed keys:" << std::endl;
+    using Key = PackedKCellKey<3>;
+    std::cout << "coordinate_bits = " << Key::coordinate_bits() << ", bias = " << Key::bias() << std::endl;
+    auto const key = Key::from_indices(5, 0b101, {-3, 4, 7});
+    std::cout << "key = " << key << std::endl;
+    CHECK(key.level() == 5);
+    CHECK(key.topology() == 0b101);
+    CHECK(key.indices()[0] == -3 && key.indices()[1] == 4 && key.indices()[2] == 7);
+    CHECK(key.khalimsky()[0] == -5 && key.khalimsky()[1] == 8 && key.khalimsky()[2] == 15);
+    CHECK((key + Key::delta({-2, 3, 0})).khalimsky()[1] == 11);
+    CHECK((key + Key::delta({-2, 3, 0})).level() == 5);
+
+    constexpr auto c3d = make_KCellND<3, 0b101>();
+    c3d.lowerIncident().foreach(
+        [&] (auto cell)
+        {
+            auto const k = key.shift(c3d, cell);
+            CHECK(k.level() == 5 && k.topology() == cell.topology());
+            CHECK(k == Key::from_indices(5, cell.topology(), cell.shift(key.indices())));
+        }
+    );
+    c3d.up().foreach(
+        [&] (auto cell)
+        {
+            auto const k = key.shift(c3d, cell);
+            CHECK(k.level() == 6);
+            CHECK(k == Key::from_indices(6, cell.topology(), cell.shift(key.indices())));
+        }
+    );
+
+    // Centers with a non-zero level shift: the origin cell is recovered from the center key
+    auto const check_center = [] (auto center, std::size_t origin_level, std::array<std::ptrdiff_t, 3> const& origin)
+    {
+        auto const center_key = Key::from_indices(static_cast<std::size_t>(static_cast<std::ptrdiff_t>(origin_level) + center.levelShift()), center.topology(), center.shift(origin));
+        bool valid = true;
+        c3d.lowerIncident().foreach(
+            [&] (auto cell)
+            {
+                auto const expected = Key::from_indices(origin_level, cell.topology(), cell.shift(origin));
+                valid = valid && center_key.shift(center, cell) == expected;
+            }
+        );
+        return valid;
+    };
+    CHECK(check_center(std::decay_t<decltype(c3d.up().next<0>())>::kcell_type<0>{}, 5, {-3, 4, 7}));
+    CHECK(check_center(std::decay_t<decltype(c3d.up().prev<2>())>::kcell_type<1>{}, 5, {-3, -4, 7}));
+    CHECK(check_center(std::decay_t<decltype(c3d.down().next<0>())>::kcell_type<0>{}, 5, {-4, 4, 6}));
+
+#if defined(__SIZEOF_INT128__)
+    using WideKey = PackedKCellKey<3, uint128_type>;
+    auto const wide = WideKey::from_indices(40, 0b010, {-100000000, 123456789, 0});
+    std::cout << "wide = " << wide << std::endl;
+    CHECK(wide.level() == 40 && wide.topology() == 0b010 && wide.indices()[1] == 123456789);
+    make_KCellND<3, 0b010>().next<0>().foreach(
+        [&] (auto cell) { CHECK(wide.shift(make_KCellND<3, 0b010>(), cell).indices()[0] == -99999999); }
+    );
+#endif
+    std::cout << std::endl;
+
+    std::cout << "Testing hash set:" << std::endl;
+    using Key2 = PackedKCellKey<2>;
+    KCellHashSet<Key2> set;
+    for (std::ptrdiff_t i = 0; i < 100; ++i)
+        CHECK(set.insert(Key2::from_indices(3, 0b11, {i, 2 * i})).second);
+    CHECK(!set.insert(Key2::from_indices(3, 0b11, {10, 20})).second);
+    CHECK(set.size() == 100);
+    CHECK(set.contains(Key2::from_indices(3, 0b11, {42, 84})));
+    CHECK(!set.contains(Key2::from_indices(3, 0b11, {42, 85})));
+    CHECK(!set.contains(Key2::from_indices(4, 0b11, {42, 84})));
+    CHECK(!set.contains(Key2::from_indices(3, 0b01, {42, 84})));
+    std::cout << "size = " << set.size() << ", capacity = " << set.capacity() << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "Testing hash map and neighbours lookup:" << std::endl;
+    CellSet<2> cells = CellSet<2>::from_box(2, Box<2>{{0, 0}, {4, 3}});
+    KCellHashMap<Key2, double> map;
+    insert_cells(map, cells, 0b11);
+    CHECK(map.size() == 12);
+    map.for_each([&] (Key2 const& k, double) { *map.find(k) = static_cast<double>(k.indices()[0] + 10 * k.indices()[1]); });
+
+    constexpr auto c2d = make_KCellND<2>();
+    auto const values = map.neighbours(Key2::from_indices(2, 0b11, {0, 1}), c2d, c2d.neighborhood());
+    std::size_t found = 0;
+    double sum = 0.;
+    for (auto const* v : values)
+        if (v != nullptr)
+        {
+            ++found;
+            sum += *v;
+        }
+    CHECK(found == 4); // (-1, 1) is outside
+    CHECK(sum == 10. + 11. + 0. + 20.);
+
+    std::vector<std::pair<Key2, double>> elements{{Key2::from_indices(2, 0b11, {10, 10}), 1.}, {Key2::from_indices(2, 0b11, {0, 0}), -1.}};
+    map.insert(elements.begin(), elements.end());
+    CHECK(map.size() == 13);
+    CHECK(*map.find(Key2::from_indices(2, 0b11, {10, 10})) == 1.);
+    CHECK(*map.find(Key2::from_indices(2, 0b11, {0, 0})) == 0.);
+    CHECK(map.find(Key2::invalid()) == nullptr);
+    CHECK(!map.contains(Key2::invalid()));
+    CHECK(Key2::from_khalimsky(2, {Key2::bias() - 1, 0}).can_move({-1, 3}));
+    CHECK(!Key2::from_khalimsky(2, {Key2::bias() - 1, 0}).can_move({1, 0}));
+    CHECK(!Key2::from_khalimsky(2, {0, -Key2::bias()}).can_move({0, -1}));
+    std::cout << std::endl;
+
+    return return_code();
+}
@@ -0,0 +1,83 @@
+#define KSPACE_INSTRUMENTATION
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "interval.hpp"
+#include "cell_set.hpp"
+#include "boundary_split.hpp"
+#include "instrumentation.hpp"
+#include "tools.hpp"
+
+/// Totals of the entries of given kind
+instrumentation::Counters totals(std::string const& kind)
+{
+    instrumentation::Counters result;
+    for (auto const& [entry, c] : instrumentation::registry().totals())
+        if (entry.kind == kind)
+        {
+            result.calls += c.calls;
+            result.shifts += c.shifts;
+            result.cells += c.cells;
+            result.bytes += c.bytes;
+        }
+    return result;
+}
+
+int main()
+{
+    constexpr auto c2d = make_KCellND<2>();
+    auto const stencil = c2d.neighborhood();
+    double value = 1.;
+    auto field = [&value] (std::size_t, auto, std::ptrdiff_t) -> double& { return value; };
+
+    std::cout << "Testing shift counters:" << std::endl;
+    stencil.shift(field, 3, 4, 5);
+    stencil.shift(field, 3, Interval{0, 10}, 5);
+    c2d.shift(field, 3, Interval{0, 10, 2}, 5);
+
+    auto const kcells = totals("KCells::shift");
+    CHECK(kcells.calls == 2);
+    CHECK(kcells.cells == 11);
+    CHECK(kcells.shifts == 11 * stencil.size());
+
+    auto const kcellnd = totals("KCellND::shift");
+    CHECK(kcellnd.calls == 2 * stencil.size() + 1);
+    CHECK(kcellnd.cells == 11 * stencil.size() + 5);
+    CHECK(kcellnd.bytes == kcellnd.cells * sizeof(double));
+    std::cout << std::endl;
+
+    std::cout << "Testing driver counters (per-thread tables):" << std::endl;
+    instrumentation::registry().reset();
+    CHECK(totals("KCells::shift").calls == 0);
+
+    auto const set = CellSet<2>::from_box(0, Box<2>{{0, 0}, {100, 30}});
+    auto noop = [] (std::size_t, auto, std::ptrdiff_t) {};
+    parallel_for_each_interval(set, stencil, noop, 16, 4);
+    CHECK(totals("stencil driver").cells == set.size());
+    CHECK(totals("stencil driver").shifts == set.size() * stencil.size());
+    CHECK(totals("KCells::shift").cells == set.size());
+    CHECK(totals("KCellND::shift").bytes == 0);
+
+    split_apply(stencil, Box<2>{{0, 0}, {100, 30}}, noop, TruncateBoundary{}, 0, Interval{0, 100}, 10);
+    CHECK(totals("stencil driver").cells == set.size() + 100);
+    std::cout << std::endl;
+
+    std::cout << "Testing reports:" << std::endl;
+    std::ostringstream table, json;
+    instrumentation::report(table);
+    instrumentation::write_json(json);
+    std::cout << table.str() << json.str();
+    CHECK(table.str().find("KCellND::shift") != std::string::npos);
+    CHECK(json.str().find("\"kind\": \"stencil driver\"") != std::string::npos);
+    CHECK(json.str().find("\"topologies\": [3]") != std::string::npos);
+    std::cout << std::endl;
+
+    return return_code();
+}
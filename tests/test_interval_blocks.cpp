@@ -0,0 +1,113 @@
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "interval.hpp"
+#include "interval_blocks.hpp"
+#include "tools.hpp"
+
+/// Indices of the interval, one by one
+std::vector<std::ptrdiff_t> scalar_indices(Interval const& interval)
+{
+    std::vector<std::ptrdiff_t> result;
+    for (auto i = interval.a; i < interval.b; i += static_cast<std::ptrdiff_t>(interval.step))
+        result.push_back(i);
+    return result;
+}
+
+/// Indices of the interval, block by block, and number of blocks of each kind
+template <
+    std::size_t Width,
+    std::ptrdiff_t Step = 0
+>
+std::vector<std::ptrdiff_t> block_indices(Interval const& interval, std::array<std::size_t, 4> & counts)
+{
+    std::vector<std::ptrdiff_t> result;
+    counts = {};
+    for_each_block<Width, Step>(interval,
+        [&] (auto block)
+        {
+            counts[(block.size() == Width ? 0 : 2) + (block.contiguous() ? 0 : 1)] += 1;
+            for (auto i : block.indices())
+                result.push_back(i);
+        }
+    );
+    return result;
+}
+
+int main()
+{
+    std::cout << "Testing element count:" << std::endl;
+    CHECK(cell_count(Interval{3, 20}) == 17);
+    CHECK(cell_count(Interval{3, 20} << 2) == 17);
+    CHECK(cell_count(Interval{3, 3}) == 0);
+    CHECK(cell_count(Interval{0, 9, 3}) == 3 && cell_count(Interval{0, 10, 3}) == 4);
+    std::cout << std::endl;
+
+    std::cout << "Testing blocks:" << std::endl;
+    std::array<std::size_t, 4> counts;
+    Interval const contiguous{-5, 20};
+    CHECK(block_indices<8>(contiguous, counts) == scalar_indices(contiguous));
+    CHECK((counts == std::array<std::size_t, 4>{3, 0, 1, 0}));
+    CHECK((block_indices<8, 1>(contiguous, counts) == scalar_indices(contiguous)));
+    CHECK((counts == std::array<std::size_t, 4>{3, 0, 1, 0}));
+
+    Interval const strided = Interval{-5, 20} << 2;
+    std::cout << "strided = " << strided << std::endl;
+    CHECK(block_indices<4>(strided, counts) == scalar_indices(strided));
+    CHECK((counts == std::array<std::size_t, 4>{0, 6, 0, 1}));
+    CHECK(block_indices<4>(Interval{0, 0}, counts).empty());
+
+    IndexBlock<4, false> const block{3, 2};
+    CHECK((block.indices() == std::array<std::ptrdiff_t, 4>{3, 5, 7, 9}));
+    std::vector<double> row(12);
+    for (std::size_t k = 0; k < row.size(); ++k)
+        row[k] = static_cast<double>(k);
+    CHECK((block.load(&row[3]) == std::array<double, 4>{3., 5., 7., 9.}));
+    block.store(&row[3], {-1., -2., -3., -4.});
+    CHECK(row[3] == -1. && row[4] == 4. && row[9] == -4.);
+    CHECK((IndexBlock<4, true>{2, 5}.load(&row[2]) == std::array<double, 4>{2., -1., 4., -2.}));
+    std::cout << std::endl;
+
+    std::cout << "Testing restriction from fine strided intervals:" << std::endl;
+    {
+        std::vector<double> fine(64), coarse(32, 0.);
+        for (std::size_t k = 0; k < fine.size(); ++k)
+            fine[k] = static_cast<double>(k * k);
+
+        Interval const interval{3, 20};
+        KCell<true, 0, 0>::up().foreach(
+            [&] (auto child)
+            {
+                Interval const children = child.shift(interval);
+                CHECK(children.step == 2);
+                for_each_block(children,
+                    [&] (auto b)
+                    {
+                        constexpr std::size_t width = decltype(b)::size();
+                        std::ptrdiff_t const i = (b.first >> 1);
+                        IndexBlock<width, true> const parents{i, 1};
+                        auto values = parents.load(&coarse[static_cast<std::size_t>(i)]);
+                        auto const children_values = b.load(&fine[static_cast<std::size_t>(b.first)]);
+                        for (std::size_t k = 0; k < width; ++k)
+                            values[k] += 0.5 * children_values[k];
+                        parents.store(&coarse[static_cast<std::size_t>(i)], values);
+                    }
+                );
+            }
+        );
+
+        bool valid = true;
+        for (std::size_t i = 0; i < coarse.size(); ++i)
+        {
+            double const expected = (i >= 3 && i < 20) ? 0.5 * (fine[2 * i] + fine[2 * i + 1]) : 0.;
+            valid = valid && coarse[i] == expected;
+        }
+        CHECK(valid);
+    }
+    std::cout << std::endl;
+
+    return return_code();
+}
@@ -290,6 +290,36 @@ int main()
     std::cout << "c3d5.direction<1>() = " << c3d5.direction<1>() << std::endl;
     std::cout << "c3d5.ortho_direction<0>() = " << c3d5.ortho_direction<0>() << std::endl;
     std::cout << std::endl;
-    
-    return 0;
+
+    std::cout << "Testing footprint:" << std::endl;
+    constexpr auto c2d_star2 = c2d.neighborhood<2>();
+    std::cout << "c2d.neighborhood<2>().minIndexShift() = " << c2d_star2.minIndexShift() << std::endl;
+    std::cout << "c2d.neighborhood<2>().maxIndexShift() = " << c2d_star2.maxIndexShift() << std::endl;
+    std::cout << "c2d.neighborhood<2>().footprintSize() = " << c2d_star2.footprintSize() << std::endl;
+    CHECK((c2d_star2.minIndexShift() == std::array<std::ptrdiff_t, 2>{-2, -2}));
+    CHECK((c2d_star2.maxIndexShift() == std::array<std::ptrdiff_t, 2>{2, 2}));
+    CHECK(c2d_star2.footprintSize() == 13);
+    CHECK((c2d.neighborhood() + c2d.next<0>()).footprintSize() == 5);
+
+    constexpr auto f3d_ui_halo = f3d_ui.haloWidth();
+    std::cout << "f3d.upperIncident().haloWidth() = " << f3d_ui_halo[0] << " " << f3d_ui_halo[1] << std::endl;
+    CHECK((f3d_ui_halo[0] == std::array<std::ptrdiff_t, 3>{0, 1, 0}));
+    CHECK((f3d_ui_halo[1] == std::array<std::ptrdiff_t, 3>{0, 0, 0}));
+
+    constexpr auto c3d_li_topo = c3d.lowerIncident().topologies();
+    std::cout << "c3d.lowerIncident().topologies() = " << c3d_li_topo << std::endl;
+    CHECK((c3d_li_topo == std::array<bool, 8>{false, false, false, true, false, true, true, false}));
+    CHECK(c3d.topologies()[7] && c3d.footprintSize() == 1);
+
+    constexpr auto c2d_multi = c2d.neighborhood() + c2d.up().next<0>() + c2d.down().prev<1>();
+    std::cout << "levels of c2d_multi = [" << c2d_multi.minLevelShift() << ", " << c2d_multi.maxLevelShift() << "]" << std::endl;
+    std::cout << "c2d_multi.haloWidth() = " << c2d_multi.haloWidth()[0] << " " << c2d_multi.haloWidth()[1] << std::endl;
+    CHECK(c2d_multi.minLevelShift() == -1 && c2d_multi.maxLevelShift() == 1);
+    // Coarse cell at index -1 along y covers the origin level cells [-3, -1]
+    CHECK((c2d_multi.haloWidth()[0] == std::array<std::ptrdiff_t, 2>{1, 3}));
+    CHECK((c2d_multi.haloWidth()[1] == std::array<std::ptrdiff_t, 2>{1, 1}));
+    std::cout << "First value of the lower halo of c2d_multi = " << std::integral_constant<std::ptrdiff_t, c2d_multi.haloWidth()[0][0]>{} << std::endl;
+    std::cout << std::endl;
+
+    return return_code();
 }
\ No newline at end of file
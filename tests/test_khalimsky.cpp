@@ -0,0 +1,104 @@
+#include <iostream>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "topology.hpp"
+#include "khalimsky.hpp"
+#include "tools.hpp"
+
+/// Index at a level shifted of level_shift, then shifted of index_shift (multiplying as left-shifting negative indices is undefined)
+std::ptrdiff_t reference_shift(std::ptrdiff_t index, std::ptrdiff_t index_shift, std::ptrdiff_t level_shift)
+{
+    return (level_shift >= 0 ? index * (std::ptrdiff_t(1) << level_shift) : index >> -level_shift) + index_shift;
+}
+
+/// Khalimsky coordinate of a cell at a level shifted of level_shift, one element at a time
+std::ptrdiff_t scalar_khalimsky(std::ptrdiff_t index, bool open, std::ptrdiff_t level_shift)
+{
+    return 2 * reference_shift(index, 0, level_shift) + (open ? 1 : 0);
+}
+
+/// Check the 2D kernels of a given level shift on all the topologies
+template <
+    std::ptrdiff_t LevelShift
+>
+bool check_level_shift(std::vector<std::ptrdiff_t> const& indices)
+{
+    std::size_t const n = indices.size() / 2;
+    std::vector<std::ptrdiff_t> khalimsky(2 * n), shifted(2 * n), expected(2 * n), back(2 * n);
+    bool valid = true;
+    for (std::size_t topology = 0; topology < 4; ++topology)
+    {
+        for (std::size_t k = 0; k < 2 * n; ++k)
+            expected[k] = scalar_khalimsky(indices[k], is_open(topology, k % 2), LevelShift);
+
+        batch_to_khalimsky<2, LevelShift>(topology, indices.data(), shifted.data(), n);
+        valid = valid && shifted == expected;
+
+        // Same level then change of level
+        batch_to_khalimsky<2>(topology, indices.data(), khalimsky.data(), n);
+        batch_khalimsky_shift<LevelShift>(khalimsky.data(), shifted.data(), 2 * n);
+        valid = valid && shifted == expected;
+        batch_khalimsky_shift(LevelShift, khalimsky.data(), shifted.data(), 2 * n);
+        valid = valid && shifted == expected;
+
+        // Back to the indices
+        batch_from_khalimsky<2, -LevelShift>(expected.data(), back.data(), n);
+        for (std::size_t k = 0; k < 2 * n; ++k)
+            valid = valid && back[k] == (LevelShift >= 0 ? indices[k] : reference_shift(reference_shift(indices[k], 0, LevelShift), 0, -LevelShift));
+    }
+    return valid;
+}
+
+int main()
+{
+    std::vector<std::ptrdiff_t> indices;
+    for (std::ptrdiff_t i = -1000; i < 1000; i += 7)
+        indices.push_back(i);
+
+    std::cout << "Testing index shift:" << std::endl;
+    std::vector<std::ptrdiff_t> shifted(indices.size());
+    batch_shift<3, 2>(indices.data(), shifted.data(), indices.size());
+    bool valid = true;
+    for (std::size_t k = 0; k < indices.size(); ++k)
+        valid = valid && shifted[k] == reference_shift(indices[k], 3, 2);
+    CHECK(valid);
+
+    batch_shift<-1, -1>(indices.data(), shifted.data(), indices.size());
+    valid = true;
+    for (std::size_t k = 0; k < indices.size(); ++k)
+        valid = valid && shifted[k] == reference_shift(indices[k], -1, -1);
+    CHECK(valid);
+    std::cout << std::endl;
+
+    std::cout << "Testing Khalimsky coordinates across levels:" << std::endl;
+    CHECK(check_level_shift<0>(indices));
+    CHECK(check_level_shift<1>(indices));
+    CHECK(check_level_shift<3>(indices));
+    CHECK(check_level_shift<-1>(indices));
+    CHECK(check_level_shift<-4>(indices));
+
+    // Consistency with KCell::up and KCell::down
+    std::ptrdiff_t const k = 2 * 5 + 1;
+    std::ptrdiff_t out = 0;
+    batch_khalimsky_shift<1>(&k, &out, 1);
+    CHECK((out == 2 * KCell<true, 0, 0>::up().get<0>().shift(std::ptrdiff_t(5)) + 1));
+    batch_khalimsky_shift<-1>(&k, &out, 1);
+    CHECK((out == 2 * KCell<true, 0, 0>::down().get<0>().shift(std::ptrdiff_t(5)) + 1));
+
+    // Level shifts without pre-instantiated kernel
+    std::vector<std::ptrdiff_t> const khalimsky{-7, -2, 0, 3, 8, 11};
+    std::vector<std::ptrdiff_t> result(khalimsky.size());
+    batch_khalimsky_shift(20, khalimsky.data(), result.data(), khalimsky.size());
+    valid = true;
+    for (std::size_t c = 0; c < khalimsky.size(); ++c)
+        valid = valid && result[c] == scalar_khalimsky(khalimsky[c] >> 1, khalimsky[c] & 1, 20);
+    CHECK(valid);
+    batch_khalimsky_shift(-20, result.data(), result.data(), result.size());
+    CHECK(result == khalimsky);
+    std::cout << std::endl;
+
+    return return_code();
+}
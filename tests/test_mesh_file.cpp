@@ -0,0 +1,164 @@
+#include <iostream>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "box.hpp"
+#include "cell_set.hpp"
+#include "mesh_file.hpp"
+#include "tools.hpp"
+
+/// 2D set with very uneven rows in [0, 64[x[0, 32[
+CellSet<2> make_uneven_set()
+{
+    CellSet<2> set(5);
+    for (std::ptrdiff_t j = 0; j < 32; ++j)
+    {
+        if (j % 7 == 0)
+            set.push_back({j}, {0, 64});
+        else if (j % 3 != 0)
+            for (std::ptrdiff_t i = j % 4; i < 64; i += 9)
+                set.push_back({j}, {i, std::min<std::ptrdiff_t>(64, i + 1 + j % 3)});
+    }
+    return set;
+}
+
+/// True if opening the file throws
+template <
+    std::size_t Dim
+>
+bool open_fails(std::string const& path)
+{
+    try { MappedMeshFile<Dim> file(path); }
+    catch (std::runtime_error const& e)
+    {
+        std::cout << "expected error: " << e.what() << std::endl;
+        return true;
+    }
+    return false;
+}
+
+/// Overwrite a 64 bits integer of the file
+void overwrite(std::string const& path, std::uint64_t offset, std::uint64_t value)
+{
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.write(reinterpret_cast<char const*>(&value), sizeof(value));
+}
+
+int main()
+{
+    std::string const path = "test_mesh_file.kmf";
+
+    std::vector<CellSet<2>> mesh{CellSet<2>(0), CellSet<2>::from_box(1, Box<2>{{0, 0}, {3, 2}}), make_uneven_set()};
+    std::vector<double> values(mesh[2].size());
+    for (std::size_t k = 0; k < values.size(); ++k)
+        values[k] = 0.5 * static_cast<double>(k);
+    std::vector<std::int32_t> flags(mesh[1].size(), 7);
+
+    std::cout << "Testing writer:" << std::endl;
+    {
+        MeshFileWriter<2> writer(path);
+        for (auto const& set : mesh)
+            writer.write_level(set);
+        writer.write_field("u", 5, 3, values);
+        writer.write_field("flags", 1, 0, flags);
+        writer.close();
+    }
+    CHECK(!open_fails<2>(path));
+    std::cout << std::endl;
+
+    std::cout << "Testing mapped reader:" << std::endl;
+    {
+        MappedMeshFile<2> file(path);
+        CHECK(file.level_count() == 3);
+        CHECK(file.field_count() == 2);
+        CHECK(file.header().file_size % mesh_file::alignment == 0);
+
+        auto const view = file.level(2);
+        file.prefetch_level(2);
+        CHECK(view.level == 5);
+        CHECK(view.row_count() == mesh[2].row_count());
+        CHECK(view.interval_count() == mesh[2].interval_count());
+        CHECK(view.size() == mesh[2].size());
+        CHECK(reinterpret_cast<std::uintptr_t>(view.intervals) % mesh_file::alignment == 0);
+        CHECK(file.level_record(2).cell_count == mesh[2].size());
+        CHECK(view.to_cell_set() == mesh[2]);
+        CHECK(file.level(0).empty() && file.level(0).to_cell_set() == mesh[0]);
+        CHECK(file.load_mesh() == mesh);
+
+        // Lazy loading of a range of rows
+        std::size_t const first = view.lower_row({10});
+        std::size_t const last = view.lower_row({20});
+        auto const part = view.row_range(first, last).to_cell_set();
+        CellSet<2> expected(5);
+        for (std::size_t r = 0; r < mesh[2].row_count(); ++r)
+            if (mesh[2].rows[r][0] >= 10 && mesh[2].rows[r][0] < 20)
+                for (auto [i, end] = mesh[2].row_intervals(r); i != end; ++i)
+                    expected.push_back(mesh[2].rows[r], *i);
+        std::cout << "part = " << part << std::endl;
+        CHECK(part == expected);
+        CHECK(view.row_range(first, last).size() == expected.size());
+
+        auto const k = file.find_field("u", 5, 3);
+        CHECK(k == 0);
+        auto const u = file.field<double>(k);
+        CHECK(u.level == 5 && u.topology == 3 && u.size() == values.size());
+        CHECK(std::equal(u.begin(), u.end(), values.begin(), values.end()));
+        auto const f = file.field<std::int32_t>(file.find_field("flags", 1, 0));
+        CHECK(std::equal(f.begin(), f.end(), flags.begin(), flags.end()));
+        CHECK(file.find_field("u", 5, 0) == file.field_count());
+
+        bool bad_type = false;
+        try { file.field<float>(k); }
+        catch (std::runtime_error const&) { bad_type = true; }
+        CHECK(bad_type);
+
+        MappedMeshFile<2> moved(std::move(file));
+        CHECK(moved.level(2).to_cell_set() == mesh[2]);
+    }
+    std::cout << std::endl;
+
+    std::cout << "Testing invalid files:" << std::endl;
+    CHECK(open_fails<3>(path));
+    CHECK(open_fails<2>("does_not_exist.kmf"));
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(0);
+        file.write("XX", 2);
+    }
+    CHECK(open_fails<2>(path));
+    save_mesh(path, mesh);
+    CHECK(MappedMeshFile<2>(path).load_mesh() == mesh);
+
+    std::uint64_t row_offsets, record;
+    {
+        MappedMeshFile<2> file(path);
+        row_offsets = file.level_record(2).row_offsets;
+        record = file.header().level_table + 2 * sizeof(mesh_file::LevelRecord);
+    }
+    overwrite(path, row_offsets, 1); // Not starting at 0
+    CHECK(open_fails<2>(path));
+    save_mesh(path, mesh);
+    overwrite(path, row_offsets + sizeof(std::size_t), 1000000); // Decreasing
+    CHECK(open_fails<2>(path));
+    save_mesh(path, mesh);
+    overwrite(path, record + offsetof(mesh_file::LevelRecord, interval_count), mesh[2].intervals.size() - 1); // Not ending at interval_count
+    CHECK(open_fails<2>(path));
+    save_mesh(path, mesh);
+    overwrite(path, record + offsetof(mesh_file::LevelRecord, interval_count), std::uint64_t(1) << 60); // Byte count overflowing to 0
+    CHECK(open_fails<2>(path));
+    save_mesh(path, mesh);
+    overwrite(path, record + offsetof(mesh_file::LevelRecord, row_count), ~std::uint64_t(0)); // row_count + 1 overflowing
+    CHECK(open_fails<2>(path));
+    save_mesh(path, mesh);
+    CHECK(MappedMeshFile<2>(path).load_mesh() == mesh);
+    std::remove(path.c_str());
+    std::cout << std::endl;
+
+    return return_code();
+}
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "mixed_level.hpp"
+#include "tools.hpp"
+
+/// Field on levels 0 to 2 of the box [-8, 8[^2 at level 1, with ghost cells
+struct Field
+{
+    std::array<Box<2>, 3> boxes{Box<2>{{-6, -6}, {6, 6}}, Box<2>{{-10, -10}, {10, 10}}, Box<2>{{-20, -20}, {20, 20}}};
+    std::array<std::vector<double>, 3> data;
+
+    Field()
+    {
+        for (std::size_t l = 0; l < 3; ++l)
+        {
+            data[l].resize(boxes[l].size());
+            for (std::size_t k = 0; k < data[l].size(); ++k)
+                data[l][k] = std::sin(static_cast<double>(k + 100 * l));
+        }
+    }
+
+    double & operator() (std::size_t level, std::ptrdiff_t i, std::ptrdiff_t j)
+    {
+        return data[level][boxes[level].offset({i, j})];
+    }
+};
+
+int main()
+{
+    constexpr auto c2d = make_KCellND<2>();
+    constexpr auto stencil = c2d.up().next<0>() + c2d.neighborhood() + c2d.down().prev<1>() + c2d.up() + c2d.down();
+    using stencil_type = std::decay_t<decltype(stencil)>;
+
+    std::cout << "Testing group_by_level:" << std::endl;
+    std::cout << "stencil.levelShifts() = " << stencil.levelShifts() << std::endl;
+    std::cout << "stencil.distinctLevelShifts() = " << stencil.distinctLevelShifts() << std::endl;
+    CHECK(stencil.levelCount() == 3);
+    CHECK((stencil.distinctLevelShifts() == std::array<std::ptrdiff_t, 3>{-1, 0, 1}));
+
+    constexpr auto groups = stencil.group_by_level();
+    std::cout << "coarse group = " << std::get<0>(groups) << std::endl;
+    std::cout << "fine group = " << std::get<2>(groups).indexShift() << std::endl;
+    CHECK(std::tuple_size_v<std::decay_t<decltype(groups)>> == 3);
+    CHECK(std::get<0>(groups).size() == 2 && std::get<1>(groups).size() == 5 && std::get<2>(groups).size() == 8);
+    CHECK((std::is_same_v<std::decay_t<decltype(std::get<0>(groups))>, decltype(c2d.down().prev<1>() + c2d.down())>));
+    CHECK((details::group_indices<stencil_type, std::decay_t<decltype(std::get<0>(groups))>>() == std::array<std::size_t, 2>{9, 14}));
+    CHECK(std::tuple_size_v<decltype(c2d.neighborhood().group_by_level())> == 1);
+    std::cout << std::endl;
+
+    std::cout << "Testing mixed level evaluation:" << std::endl;
+    Field field;
+    std::vector<double> out(20 * 20, 0.);
+    auto output = [&out] (std::size_t, std::ptrdiff_t i, std::ptrdiff_t j) -> double & { return out[static_cast<std::size_t>((j + 10) * 20 + i + 10)]; };
+
+    std::array<double, stencil.size()> weights;
+    for (std::size_t c = 0; c < weights.size(); ++c)
+        weights[c] = 1. + 0.25 * static_cast<double>(c);
+
+    bool valid = true;
+    for (std::ptrdiff_t j = -7; j < 7; ++j)
+    {
+        Interval const interval{-7 + (j & 1), 6};
+        mixed_level_apply(stencil, weights, field, output, 1, interval, j);
+        for (auto i = interval.a; i < interval.b; ++i)
+        {
+            // Reference: one stencil cell at a time
+            auto const values = stencil.shift(field, 1, i, j);
+            double expected = 0.;
+            std::size_t c = 0;
+            std::apply([&] (auto... v) { ((expected += weights[c++] * v), ...); }, values);
+            valid = valid && std::abs(output(1, i, j) - expected) < 1e-12;
+        }
+    }
+    CHECK(valid);
+    std::cout << std::endl;
+
+    return return_code();
+}
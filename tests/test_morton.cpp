@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "cell_set.hpp"
+#include "morton.hpp"
+#include "tools.hpp"
+
+int main()
+{
+    std::cout << "Testing Morton encoding:" << std::endl;
+    CHECK(morton_encode<2>({0b11, 0b01}) == 0b0111);
+    CHECK(morton_encode<3>({1, 1, 1}) == 0b111);
+    CHECK(morton_encode<3>({0b10, 0, 0b1}) == 0b001100);
+    CHECK(details::deposit_bits(0b101, 0b111000) == 0b101000);
+    CHECK(details::extract_bits(0b101000, 0b111000) == 0b101);
+    for (std::uint64_t x : {0ull, 1ull, 12345ull, 987654ull})
+    {
+        auto const code = morton_encode<3>({x, 2 * x + 1, x / 3});
+        auto const coords = morton_decode<3>(code);
+        CHECK(coords[0] == x && coords[1] == 2 * x + 1 && coords[2] == x / 3);
+    }
+    std::cout << std::endl;
+
+    std::cout << "Testing dilated integer addition:" << std::endl;
+    {
+        constexpr auto mask = morton_mask<2>(1);
+        auto const code = morton_encode<2>({5, 7});
+        CHECK(dilated_add(code, details::deposit_bits(3, mask), mask) == morton_encode<2>({5, 10}));
+        CHECK(dilated_add(code, details::deposit_bits(static_cast<std::uint64_t>(-4), mask), mask) == morton_encode<2>({5, 3}));
+    }
+    std::cout << std::endl;
+
+    std::cout << "Testing Morton keys:" << std::endl;
+    using Key = MortonKCellKey<3>;
+    auto const key = Key::from_indices(4, 0b011, {-3, 4, 7});
+    std::cout << "key = " << key << std::endl;
+    CHECK(key.level() == 4 && key.topology() == 0b011);
+    CHECK(key.indices()[0] == -3 && key.indices()[1] == 4 && key.indices()[2] == 7);
+
+    constexpr auto c3d = make_KCellND<3, 0b011>();
+    auto const check_shift = [&] (auto cell)
+    {
+        auto const k = key.shift(c3d, cell);
+        CHECK(k.topology() == cell.topology());
+        CHECK(k == Key::from_indices(k.level(), cell.topology(), cell.shift(key.indices())));
+    };
+    c3d.lowerIncident().foreach(check_shift);
+    c3d.neighborhood<2>().foreach(check_shift);
+    c3d.up().foreach(check_shift);
+
+    // Center with a level shift: the origin cell is recovered from the center key
+    auto const center = std::decay_t<decltype(c3d.up().next<1>())>::kcell_type<0>{};
+    std::array<std::ptrdiff_t, 3> const origin{-3, 4, 7};
+    auto const center_key = Key::from_indices(5, center.topology(), center.shift(origin));
+    c3d.lowerIncident().foreach(
+        [&] (auto cell) { CHECK(center_key.shift(center, cell) == Key::from_indices(4, cell.topology(), cell.shift(origin))); }
+    );
+    std::cout << std::endl;
+
+    std::cout << "Testing Morton order traversal:" << std::endl;
+    auto const set = CellSet<2>::from_box(1, Box<2>{{0, 0}, {4, 4}});
+    std::vector<std::array<std::ptrdiff_t, 2>> cells;
+    for_each_cell_morton(set, 0b11, [&] (std::size_t, auto indices) { cells.push_back(indices); });
+    CHECK(cells.size() == 16);
+    // First quadrant is visited before moving on
+    CHECK(cells[1][0] == 1 && cells[1][1] == 0);
+    CHECK(cells[2][0] == 0 && cells[2][1] == 1);
+    CHECK(cells[3][0] == 1 && cells[3][1] == 1);
+    CHECK(cells[4][0] == 2 && cells[4][1] == 0);
+
+    // Same order as sorting all the keys, for any block size
+    auto const wide = CellSet<2>::from_box(2, Box<2>{{-9, -5}, {13, 11}});
+    auto sorted = std::vector<MortonKCellKey<2>>{};
+    wide.for_each_interval(
+        [&] (std::size_t level, Interval const& interval, std::ptrdiff_t j)
+        {
+            for (auto i = interval.a; i < interval.b; ++i)
+                sorted.push_back(MortonKCellKey<2>::from_indices(level, 0b01, {i, j}));
+        }
+    );
+    std::sort(sorted.begin(), sorted.end());
+    CHECK(morton_order(wide, 0b01) == sorted);
+    for (std::size_t block_bits : {0, 1, 2, 5})
+    {
+        std::vector<MortonKCellKey<2>> keys;
+        for_each_morton_block(wide, 0b01, [&] (auto first, auto last) { keys.insert(keys.end(), first, last); }, block_bits);
+        CHECK(keys == sorted);
+    }
+
+    for (std::size_t n = 0; n < cells.size(); ++n)
+        std::cout << "(" << cells[n][0] << "," << cells[n][1] << ") ";
+    std::cout << std::endl;
+
+    return return_code();
+}
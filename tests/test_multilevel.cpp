@@ -0,0 +1,130 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "multilevel.hpp"
+#include "tools.hpp"
+
+/// Field of one topology on two levels (level 0 and 1) of a 2D box, with ghost cells
+struct Field
+{
+    std::array<Box<2>, 2> boxes;
+    std::array<std::vector<double>, 2> data;
+
+    explicit Field(Box<2> const& coarse)
+        : boxes{coarse.grow(1), Box<2>{{2 * coarse.min_corner[0] - 2, 2 * coarse.min_corner[1] - 2}, {2 * coarse.max_corner[0] + 2, 2 * coarse.max_corner[1] + 2}}}
+        , data{std::vector<double>(boxes[0].size(), 0.), std::vector<double>(boxes[1].size(), 0.)}
+    {}
+
+    double & operator() (std::size_t level, std::ptrdiff_t i, std::ptrdiff_t j)
+    {
+        return data[level][boxes[level].offset({i, j})];
+    }
+};
+
+/// Linear function of the position of the cell center
+double linear(std::size_t topology, std::size_t level, std::ptrdiff_t i, std::ptrdiff_t j)
+{
+    double const h = 1. / static_cast<double>(1 << level);
+    double const x = (static_cast<double>(i) + (is_open(topology, 0) ? 0.5 : 0.)) * h;
+    double const y = (static_cast<double>(j) + (is_open(topology, 1) ? 0.5 : 0.)) * h;
+    return 3. * x - 5. * y + 1.;
+}
+
+template <std::size_t Topology>
+void test_topology(Box<2> const& coarse)
+{
+    constexpr auto cell = make_KCellND<2, Topology>();
+    std::cout << "cell = " << cell << std::endl;
+    std::cout << "coplanar children = " << details::coplanar_children<decltype(cell)>().indexShift() << std::endl;
+    CHECK(details::coplanar_children<decltype(cell)>().size() == (std::size_t(1) << cell.dimension()));
+
+    Field field(coarse);
+
+    // Restriction of a linear function is exact
+    for (auto j = field.boxes[1].min_corner[1]; j < field.boxes[1].max_corner[1]; ++j)
+        for (auto i = field.boxes[1].min_corner[0]; i < field.boxes[1].max_corner[0]; ++i)
+            field(1, i, j) = linear(Topology, 1, i, j);
+    for (auto j = coarse.min_corner[1]; j < coarse.max_corner[1]; ++j)
+        restriction(cell, field, 0, coarse.interval(0), j);
+
+    bool exact = true;
+    for (auto j = coarse.min_corner[1]; j < coarse.max_corner[1]; ++j)
+        for (auto i = coarse.min_corner[0]; i < coarse.max_corner[0]; ++i)
+            exact = exact && std::abs(field(0, i, j) - linear(Topology, 0, i, j)) < 1e-12;
+    CHECK(exact);
+
+    // Prediction of a linear function is exact
+    for (auto j = field.boxes[0].min_corner[1]; j < field.boxes[0].max_corner[1]; ++j)
+        for (auto i = field.boxes[0].min_corner[0]; i < field.boxes[0].max_corner[0]; ++i)
+            field(0, i, j) = linear(Topology, 0, i, j);
+    std::fill(field.data[1].begin(), field.data[1].end(), 0.);
+    for (auto j = coarse.min_corner[1]; j < coarse.max_corner[1]; ++j)
+        prediction(cell, field, 0, coarse.interval(0), j);
+
+    exact = true;
+    for (auto j = 2 * coarse.min_corner[1]; j < 2 * coarse.max_corner[1]; ++j)
+        for (auto i = 2 * coarse.min_corner[0]; i < 2 * coarse.max_corner[0]; ++i)
+            exact = exact && std::abs(field(1, i, j) - linear(Topology, 1, i, j)) < 1e-12;
+    CHECK(exact);
+
+    // Restriction of the prediction gives back the coarse values
+    for (std::size_t k = 0; k < field.data[0].size(); ++k)
+        field.data[0][k] = std::cos(static_cast<double>(k * k));
+    auto const reference = field.data[0];
+    for (auto j = coarse.min_corner[1]; j < coarse.max_corner[1]; ++j)
+        prediction(cell, field, 0, coarse.interval(0), j);
+    for (auto j = coarse.min_corner[1]; j < coarse.max_corner[1]; ++j)
+        restriction(cell, field, 0, coarse.interval(0), j);
+
+    exact = true;
+    for (auto j = coarse.min_corner[1]; j < coarse.max_corner[1]; ++j)
+        for (auto i = coarse.min_corner[0]; i < coarse.max_corner[0]; ++i)
+            exact = exact && std::abs(field(0, i, j) - reference[field.boxes[0].offset({i, j})]) < 1e-12;
+    CHECK(exact);
+    std::cout << std::endl;
+}
+
+int main()
+{
+    std::cout << "Testing restriction and prediction:" << std::endl;
+    Box<2> const coarse{{-2, 1}, {6, 5}};
+    test_topology<0>(coarse);
+    test_topology<1>(coarse);
+    test_topology<2>(coarse);
+    test_topology<3>(coarse);
+
+    std::cout << "Testing prediction of rows longer than a chunk:" << std::endl;
+    Box<2> const long_rows{{-3, 0}, {static_cast<std::ptrdiff_t>(2 * details::prediction_chunk_size) + 5, 2}};
+    test_topology<0>(long_rows);
+    test_topology<3>(long_rows);
+
+    std::cout << "Testing 1D and 3D restriction:" << std::endl;
+    std::vector<double> fine1d(16), coarse1d(8, 0.);
+    for (std::size_t i = 0; i < fine1d.size(); ++i)
+        fine1d[i] = static_cast<double>(i);
+    auto field1d = [&] (std::size_t level, std::ptrdiff_t i) -> double & { return level == 0 ? coarse1d[static_cast<std::size_t>(i)] : fine1d[static_cast<std::size_t>(i)]; };
+    restriction(make_KCellND<1>(), field1d, 0, Interval{0, 8});
+    CHECK(coarse1d[3] == 6.5);
+    restriction(make_KCellND<1, 0>(), field1d, 0, Interval{0, 8});
+    CHECK(coarse1d[3] == 6.);
+
+    std::vector<double> fine3d(8 * 8 * 8), coarse3d(4 * 4 * 4, 0.);
+    for (std::size_t i = 0; i < fine3d.size(); ++i)
+        fine3d[i] = static_cast<double>(i % 8);
+    auto field3d = [&] (std::size_t level, std::ptrdiff_t i, std::ptrdiff_t j, std::ptrdiff_t k) -> double &
+    {
+        return level == 0 ? coarse3d[static_cast<std::size_t>((k * 4 + j) * 4 + i)] : fine3d[static_cast<std::size_t>((k * 8 + j) * 8 + i)];
+    };
+    restriction(make_KCellND<3, 6>(), field3d, 0, Interval{0, 4}, 1, 2);
+    CHECK(coarse3d[(2 * 4 + 1) * 4 + 3] == 6.);
+    restriction(make_KCellND<3>(), field3d, 0, Interval{0, 4}, 1, 2);
+    CHECK(coarse3d[(2 * 4 + 1) * 4 + 3] == 6.5);
+    std::cout << std::endl;
+
+    return return_code();
+}
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "interval.hpp"
+#include "periodic.hpp"
+#include "tools.hpp"
+
+/// Wrap with modulo arithmetic (reference)
+std::ptrdiff_t modulo(std::ptrdiff_t i, std::ptrdiff_t min, std::ptrdiff_t extent)
+{
+    return min + (((i - min) % extent) + extent) % extent;
+}
+
+template <typename Stencil>
+bool check_stencil(Stencil stencil, Periodicity<2> const& periodicity, std::size_t level, Interval const& interval, std::ptrdiff_t j)
+{
+    // Reference: sum of a hash of the wrapped indices of every (cell, stencil cell) pair
+    auto hash = [] (std::size_t l, std::ptrdiff_t i, std::ptrdiff_t k) { return static_cast<std::ptrdiff_t>(l) * 1000003 + i * 1009 + k; };
+
+    std::ptrdiff_t expected = 0;
+    std::size_t expected_count = 0;
+    for (std::ptrdiff_t i = interval.a; i < interval.b; i += static_cast<std::ptrdiff_t>(interval.step))
+        stencil.foreach(
+            [&] (auto cell)
+            {
+                auto const l = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(level) + cell.levelShift());
+                auto const idx = cell.shift(std::array<std::ptrdiff_t, 2>{i, j});
+                expected += hash(l, modulo(idx[0], periodicity.min(0, l), periodicity.extent(0, l)),
+                                    periodicity.periodic[1] ? modulo(idx[1], periodicity.min(1, l), periodicity.extent(1, l)) : idx[1]);
+                ++expected_count;
+            }
+        );
+
+    std::ptrdiff_t sum = 0;
+    std::size_t count = 0;
+    bool inside = true;
+    auto fn = [&] (std::size_t l, auto i, std::ptrdiff_t k)
+    {
+        auto visit = [&] (std::ptrdiff_t ii)
+        {
+            inside = inside && ii >= periodicity.min(0, l) && ii < periodicity.min(0, l) + periodicity.extent(0, l);
+            sum += hash(l, ii, k);
+            ++count;
+        };
+        if constexpr (std::is_same_v<decltype(i), Interval>)
+            for (std::ptrdiff_t ii = i.a; ii < i.b; ii += static_cast<std::ptrdiff_t>(i.step))
+                visit(ii);
+        else
+            visit(i);
+    };
+    periodic_apply(stencil, periodicity, fn, level, interval, j);
+
+    return inside && sum == expected && count == expected_count;
+}
+
+int main()
+{
+    std::cout << "Testing branchless wrap:" << std::endl;
+    for (std::ptrdiff_t i = -5; i < 17; ++i)
+        CHECK(details::wrap(i, 3, 9) == modulo(i, 3, 9));
+    std::cout << std::endl;
+
+    std::cout << "Testing periodic shifts:" << std::endl;
+    Periodicity<2> const periodicity{1, Box<2>{{2, 0}, {10, 6}}, {true, true}};
+    CHECK(periodicity.min(0, 3) == 8 && periodicity.extent(0, 3) == 32);
+    CHECK(periodicity.min(0, 0) == 1 && periodicity.extent(0, 0) == 4);
+
+    constexpr auto c2d = make_KCellND<2>();
+    static_assert(!details::may_leave_domain<KCell<true, 1, 1>>(), "Children stay in the domain");
+    static_assert(details::may_leave_domain<KCell<true, 2, 1>>(), "Shifted children may leave the domain");
+    static_assert(!details::may_leave_domain<KCell<true, 0, -1>>(), "Parent stays in the domain");
+
+    c2d.neighborhood().foreach(
+        [&] (auto cell)
+        {
+            auto const idx = periodic_shift(cell, periodicity, 1, {2, 5});
+            CHECK(idx[0] >= 2 && idx[0] < 10 && idx[1] >= 0 && idx[1] < 6);
+        }
+    );
+    auto const idx = periodic_shift(c2d.next<0, -1>().template get<0>(), periodicity, 1, {2, 5});
+    CHECK(idx[0] == 9 && idx[1] == 5);
+    std::cout << std::endl;
+
+    std::cout << "Testing periodic stencil application:" << std::endl;
+    auto const up_stencil = c2d.next<0>().up() + c2d.prev<1, 2>().up();
+    Periodicity<2> const semi{1, Box<2>{{2, 0}, {10, 6}}, {true, false}};
+    for (std::ptrdiff_t j = 0; j < 6; ++j)
+        for (std::size_t step : {1, 2, 3})
+        {
+            Interval const interval{2, 10, step};
+            CHECK(check_stencil(c2d.neighborhood<2>(), periodicity, 1, interval, j));
+            CHECK(check_stencil(up_stencil, periodicity, 1, interval, j));
+            CHECK(check_stencil(c2d.neighborhood(), semi, 1, interval, j));
+            CHECK(check_stencil(c2d.neighborhood<2>(), periodicity, 2, Interval{4, 20, step}, 2 * j));
+        }
+    std::cout << std::endl;
+
+    return return_code();
+}
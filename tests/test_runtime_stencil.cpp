@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "mixed_level.hpp"
+#include "runtime_stencil.hpp"
+#include "tools.hpp"
+
+/// Field on levels 0 to 2 of the box [-8, 8[^2 at level 1, with ghost cells
+struct Field
+{
+    std::array<Box<2>, 3> boxes{Box<2>{{-6, -6}, {6, 6}}, Box<2>{{-10, -10}, {10, 10}}, Box<2>{{-20, -20}, {20, 20}}};
+    std::array<std::vector<double>, 3> data;
+
+    Field()
+    {
+        for (std::size_t l = 0; l < 3; ++l)
+        {
+            data[l].resize(boxes[l].size());
+            for (std::size_t k = 0; k < data[l].size(); ++k)
+                data[l][k] = std::sin(static_cast<double>(k + 100 * l));
+        }
+    }
+
+    double & operator() (std::size_t level, std::ptrdiff_t i, std::ptrdiff_t j)
+    {
+        return data[level][boxes[level].offset({i, j})];
+    }
+};
+
+/// Compare runtime_apply to mixed_level_apply on the rows of the level 1
+template <
+    typename Stencil
+>
+bool same_as_compile_time(Stencil stencil)
+{
+    Field field;
+    std::vector<double> out(20 * 20, 0.), expected(20 * 20, 0.);
+    auto output = [&out] (std::size_t, std::ptrdiff_t i, std::ptrdiff_t j) -> double & { return out[static_cast<std::size_t>((j + 10) * 20 + i + 10)]; };
+    auto reference = [&expected] (std::size_t, std::ptrdiff_t i, std::ptrdiff_t j) -> double & { return expected[static_cast<std::size_t>((j + 10) * 20 + i + 10)]; };
+
+    std::array<double, Stencil::size()> weights;
+    for (std::size_t c = 0; c < weights.size(); ++c)
+        weights[c] = 1. + 0.25 * static_cast<double>(c);
+    std::vector<double> const runtime_weights(weights.begin(), weights.end());
+
+    auto const runtime = make_runtime_stencil(stencil);
+    bool valid = runtime.size() == stencil.size();
+    for (std::ptrdiff_t j = -7; j < 7; ++j)
+    {
+        Interval const interval{-7 + (j & 1), 6};
+        mixed_level_apply(stencil, weights, field, reference, 1, interval, j);
+        runtime_apply(runtime, runtime_weights, field, output, 1, interval, j);
+        for (auto i = interval.a; i < interval.b; ++i)
+            valid = valid && std::abs(output(1, i, j) - reference(1, i, j)) < 1e-12;
+    }
+    return valid;
+}
+
+int main()
+{
+    constexpr auto c2d = make_KCellND<2>();
+
+    std::cout << "Testing conversion:" << std::endl;
+    auto const stencil = c2d.neighborhood() + c2d.up().next<0>() + c2d.down();
+    RuntimeStencil<2> const runtime(stencil);
+    std::cout << "runtime = " << runtime << std::endl;
+    CHECK(runtime.size() == stencil.size());
+    CHECK(runtime.minLevelShift() == -1 && runtime.maxLevelShift() == 1);
+    CHECK(runtime.groups().size() == 3);
+    CHECK((runtime.groups()[0].cells == std::vector<std::size_t>{9}));
+    CHECK((runtime.groups()[1].level_shift == 0 && runtime.groups()[1].cells.size() == 5));
+    CHECK(runtime.topologies() == stencil.topologies());
+    CHECK(RuntimeStencil<2>(c2d) == RuntimeStencil<2>(KCells<std::decay_t<decltype(c2d)>>{}));
+    CHECK(RuntimeStencil<2>(c2d.neighborhood()) + RuntimeStencil<2>(c2d.down()) == RuntimeStencil<2>(c2d.neighborhood() + c2d.down()));
+
+    auto const edges = make_runtime_stencil(c2d.lowerIncident() + c2d);
+    CHECK(edges.withTopology(1).size() == 2 && edges.withTopology(2).size() == 2 && edges.withTopology(3).size() == 1);
+    CHECK(edges.withTopology(0).size() == 0);
+    std::cout << std::endl;
+
+    std::cout << "Testing shift:" << std::endl;
+    std::vector<std::array<std::ptrdiff_t, 3>> expected, shifted;
+    stencil.shift([&expected] (std::size_t level, std::ptrdiff_t i, std::ptrdiff_t j) { expected.push_back({std::ptrdiff_t(level), i, j}); }, 4, 3, -5);
+    runtime.shift([&shifted] (std::size_t level, std::ptrdiff_t i, std::ptrdiff_t j) { shifted.push_back({std::ptrdiff_t(level), i, j}); }, 4, 3, -5);
+    // Evaluation order of the compile-time shift is unspecified
+    CHECK(shifted.size() == expected.size() && std::is_permutation(shifted.begin(), shifted.end(), expected.begin()));
+
+    Interval row{};
+    RuntimeStencil<2>(c2d.next<0>()).shift([&row] (std::size_t, Interval i, std::ptrdiff_t) { row = i; }, 4, Interval{2, 6}, 1);
+    CHECK(row.a == 3 && row.b == 7);
+    std::cout << std::endl;
+
+    std::cout << "Testing evaluation:" << std::endl;
+    CHECK(same_as_compile_time(c2d.neighborhood()));
+    CHECK(same_as_compile_time(c2d.up().next<0>() + c2d.neighborhood() + c2d.down().prev<1>() + c2d.up() + c2d.down()));
+    CHECK(same_as_compile_time(c2d.neighborhood<3>())); // More cells than the largest kernel
+    CHECK(same_as_compile_time(c2d.up()));
+    std::cout << std::endl;
+
+    return return_code();
+}
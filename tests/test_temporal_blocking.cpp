@@ -0,0 +1,95 @@
+#include <iostream>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "temporal_blocking.hpp"
+#include "tools.hpp"
+
+/// Dense field on a box (including ghost cells)
+template <std::size_t Dim>
+struct Field
+{
+    Box<Dim> box;
+    std::vector<double> data;
+
+    explicit Field(Box<Dim> const& b) : box(b), data(b.size(), 0.) {}
+
+    template <typename... Index>
+    double & operator() (std::size_t, Index... index)
+    {
+        std::array<std::ptrdiff_t, Dim> idx{index...};
+        std::size_t offset = 0;
+        for (std::size_t d = Dim; d-- > 0;)
+            offset = offset * box.shape(d) + static_cast<std::size_t>(idx[d] - box.min_corner[d]);
+        return data[offset];
+    }
+};
+
+template <
+    typename Stencil,
+    std::size_t Dim
+>
+bool check_against_naive(Stencil stencil, Box<Dim> const& box, std::size_t n_sweeps, std::size_t tile_width)
+{
+    constexpr std::ptrdiff_t radius = 2;
+    Box<Dim> const ghost_box = box.grow(radius);
+    std::array<Field<Dim>, 2> naive{Field<Dim>(ghost_box), Field<Dim>(ghost_box)};
+    for (std::size_t i = 0; i < ghost_box.size(); ++i)
+        naive[0].data[i] = naive[1].data[i] = static_cast<double>((i * 7919) % 101);
+    auto blocked = naive;
+
+    auto make_kernel = [&stencil] (std::array<Field<Dim>, 2> & fields)
+    {
+        return [&fields, stencil] (std::size_t sweep, std::size_t level, Interval const& interval, auto... outer)
+        {
+            auto & src = fields[sweep % 2];
+            auto & dst = fields[(sweep + 1) % 2];
+            for (std::ptrdiff_t i = interval.a; i < interval.b; ++i)
+            {
+                double sum = 0.;
+                stencil.apply([&] (auto... cell) { ((sum += cell.shift(src, level, i, outer...)), ...); });
+                dst(level, i, outer...) = sum / static_cast<double>(stencil.size());
+            }
+        };
+    };
+
+    auto naive_kernel = make_kernel(naive);
+    for (std::size_t s = 0; s < n_sweeps; ++s)
+        details::parallel_for_each_row(box,
+            [&] (Interval const& interval, auto... outer) { naive_kernel(s, 0, interval, outer...); },
+            1
+        );
+
+    temporal_blocking(stencil, box, 0, n_sweeps, make_kernel(blocked), tile_width, 2);
+
+    return naive[n_sweeps % 2].data == blocked[n_sweeps % 2].data;
+}
+
+int main()
+{
+    constexpr auto c2d = make_KCellND<2>();
+    constexpr auto c3d = make_KCellND<3>();
+
+    std::cout << "Testing temporal blocking against naive sweeps:" << std::endl;
+    CHECK(check_against_naive(make_KCellND<1>().neighborhood(), Box<1>{{0}, {40}}, 5, 3));
+    CHECK(check_against_naive(c2d.neighborhood(), Box<2>{{-2, 1}, {9, 17}}, 4, 3));
+    CHECK(check_against_naive(c2d.neighborhood<2>(), Box<2>{{0, 0}, {6, 23}}, 3, 1));
+    CHECK(check_against_naive(c3d.neighborhood(), Box<3>{{0, 0, 0}, {5, 6, 13}}, 6, 4));
+    CHECK(check_against_naive(c3d.neighborhood(), Box<3>{{0, 0, 0}, {4, 4, 7}}, 3, 0));
+    CHECK(check_against_naive(c3d.neighborhood<2>(), Box<3>{{0, -3, 2}, {5, 9, 13}}, 4, 1)); // Tiles narrower than the radius
+    std::cout << std::endl;
+
+    std::cout << "Testing default tile width:" << std::endl;
+    Box<3> const large{{0, 0, 0}, {256, 256, 256}};
+    std::size_t const width = default_tile_width(large, 4, 1, 16, std::size_t(1) << 20);
+    CHECK(width > 1);
+    CHECK(256 * 16 * (width + 4) * (width + 4) <= (std::size_t(1) << 20));
+    CHECK(256 * 16 * (width + 5) * (width + 5) > (std::size_t(1) << 20));
+    CHECK(default_tile_width(Box<2>{{0, 0}, {8, 8}}, 2, 1, 16) == 8);
+    std::cout << std::endl;
+
+    return return_code();
+}
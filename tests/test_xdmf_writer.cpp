@@ -0,0 +1,102 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "kcell.hpp"
+#include "kcells.hpp"
+#include "kcellnd.hpp"
+#include "box.hpp"
+#include "cell_set.hpp"
+#include "xdmf_writer.hpp"
+#include "tools.hpp"
+
+/// Read n values of type T at given offset of a binary file
+template <
+    typename T
+>
+std::vector<T> read_values(std::string const& path, std::size_t offset, std::size_t n)
+{
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(offset));
+    std::vector<T> values(n);
+    file.read(reinterpret_cast<char *>(values.data()), static_cast<std::streamsize>(n * sizeof(T)));
+    return values;
+}
+
+/// Value of the attribute Seek of the n-th DataItem of the XML file
+std::size_t seek(std::string const& xml, std::size_t n)
+{
+    std::size_t pos = 0;
+    for (std::size_t k = 0; k <= n; ++k)
+        pos = xml.find("Seek=\"", pos) + 6;
+    return std::stoul(xml.substr(pos));
+}
+
+int main()
+{
+    constexpr auto c2d = make_KCellND<2>();
+    std::string const path = "test_xdmf_writer.xmf";
+
+    // 2x1 faces of level 1 in a domain of length 1
+    auto const set = CellSet<2>::from_box(1, Box<2>{{0, 0}, {2, 1}});
+    auto u = [] (std::size_t level, std::ptrdiff_t i, std::ptrdiff_t j) { return static_cast<double>(100 * level + 10 * i + j); };
+    auto t = [] (std::size_t, std::ptrdiff_t i, std::ptrdiff_t) { return static_cast<std::int32_t>(i); };
+
+    std::cout << "Testing writer:" << std::endl;
+    {
+        XdmfWriter<2> writer(path, 1., {-1., 0.});
+        writer.write_grid("faces", set, c2d.topology(), named_field("u", u), named_field("t", t));
+        writer.write_grid("edges", set, c2d.lowerIncident(), named_field("u", u));
+        writer.write_grid("vertices", set, 0);
+        writer.write_grid("fine faces", set, std::decay_t<decltype(c2d.up().next<0>())>::kcell_type<0>{}, named_field("u", u));
+        writer.write_grid("a<b & \"c\"", set, 0, named_field("t'", t));
+
+        bool invalid = false;
+        try { writer.write_grid("mixed", set, c2d.lowerIncident() + c2d); }
+        catch (std::invalid_argument const&) { invalid = true; }
+        CHECK(invalid);
+        writer.close();
+    }
+
+    std::ifstream file(path);
+    std::string const xml{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    std::cout << xml;
+    CHECK(xml.find("<Grid Name=\"faces\" GridType=\"Uniform\">") != std::string::npos);
+    CHECK(xml.find("TopologyType=\"Quadrilateral\" NumberOfElements=\"2\"") != std::string::npos);
+    CHECK(xml.find("TopologyType=\"Polyline\" NumberOfElements=\"8\" NodesPerElement=\"2\"") != std::string::npos);
+    CHECK(xml.find("TopologyType=\"Polyvertex\" NumberOfElements=\"2\" NodesPerElement=\"1\"") != std::string::npos);
+    CHECK(xml.find("NumberType=\"Int\" Precision=\"4\"") != std::string::npos);
+    CHECK(xml.find(">test_xdmf_writer.xmf.bin</DataItem>") != std::string::npos);
+    CHECK(xml.find("<Grid Name=\"a&lt;b &amp; &quot;c&quot;\" GridType=\"Uniform\">") != std::string::npos);
+    CHECK(xml.find("<Attribute Name=\"t&apos;\"") != std::string::npos);
+    std::cout << std::endl;
+
+    std::cout << "Testing binary data:" << std::endl;
+    std::string const data = path + ".bin";
+
+    // Faces: topology, geometry, u, t
+    auto const faces = read_values<double>(data, seek(xml, 1), 2 * 4 * 3);
+    CHECK((std::vector<double>(faces.begin() + 12, faces.end()) == std::vector<double>{-0.5, 0, 0, 0, 0, 0, 0, 0.5, 0, -0.5, 0.5, 0}));
+    CHECK((read_values<std::uint64_t>(data, seek(xml, 0), 8) == std::vector<std::uint64_t>{0, 1, 2, 3, 4, 5, 6, 7}));
+    CHECK((read_values<double>(data, seek(xml, 2), 2) == std::vector<double>{100, 110}));
+    CHECK((read_values<std::int32_t>(data, seek(xml, 3), 2) == std::vector<std::int32_t>{0, 1}));
+
+    // Edges: first the left edges (vertical), the values being read at the edge indices
+    auto const edges = read_values<double>(data, seek(xml, 5), 2 * 3);
+    CHECK((edges == std::vector<double>{-1, 0, 0, -1, 0.5, 0}));
+    CHECK((read_values<double>(data, seek(xml, 6), 8) == std::vector<double>{100, 110, 110, 120, 100, 110, 101, 111}));
+
+    // Fine faces: one child per face at level 2
+    auto const fine = read_values<double>(data, seek(xml, 10), 3);
+    CHECK((fine == std::vector<double>{-0.75, 0, 0}));
+    CHECK((read_values<double>(data, seek(xml, 11), 2) == std::vector<double>{210, 230}));
+    std::cout << std::endl;
+
+    std::remove(path.c_str());
+    std::remove(data.c_str());
+    return return_code();
+}